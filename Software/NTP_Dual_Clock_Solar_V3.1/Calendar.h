@@ -0,0 +1,94 @@
+#ifndef	_CALENDAR_H_					// Prevent double include
+#define	_CALENDAR_H_
+
+
+/*
+ *	Breaking down the time; added in Version 3.2.
+ *
+ *	It's in here rather than in the main program so 'host_bench.sh' (in the
+ *	'Software' folder) can build it on a computer, time it and check it against
+ *	the computer's own 'gmtime'.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+
+/*
+ *	A 'calendar' is a time broken down into its date and time fields (see 'Breakdown')
+ *	along with flags saying which of them changed since it was last broken down.
+ */
+
+struct calendar
+{
+	time_t		t;						// The time it's for
+	int16_t		year;					// 4 digit year
+	int8_t		month;					// 1 - 12
+	int8_t		day;					// 1 - 31
+	int8_t		weekday;				// 1 - 7; Sunday is 1
+	int8_t		hour;					// 0 - 23
+	int8_t		minute;					// 0 - 59
+	int8_t		second;					// 0 - 59
+	bool		newMinute;				// Minute changed
+	bool		newHour;				// Hour changed
+	bool		newDay;					// Date changed
+};
+
+
+/*
+ *	'Breakdown' splits time 't' into the date and time fields of 'c' and sets the
+ *	flags for those that changed since 'c' was last used; added in Version 3.2.
+ *
+ *	The ezTime 'hour ()', 'minute ()', 'day ()' etc. functions each do the whole
+ *	conversion from scratch, and the display used to call them a couple of dozen
+ *	times a second. Now the UTC and local times are broken down once a second and
+ *	everything that needs the fields reads them from 'utcCal' and 'localCal'.
+ *
+ *	The date uses Howard Hinnant's "civil from days" algorithm, which needs no
+ *	tables or loops (http://howardhinnant.github.io/date_algorithms.html).
+ */
+
+void Breakdown ( time_t t, calendar& c )
+{
+	int32_t		days = t / 86400;						// Days since 1/1/1970
+	int32_t		secs = t % 86400;						// Seconds into the day
+	int32_t		z;										// Days since 3/1/0000
+	int32_t		era;									// 400 year cycle
+	uint32_t	doe;									// Day of the era
+	uint32_t	yoe;									// Year of the era
+	uint32_t	doy;									// Day of the year (from March 1)
+	uint32_t	mp;										// Month (from March)
+	calendar	old = c;								// To see what changed
+
+	if (( t == c.t ) && t )								// Already done
+		return;
+
+	if ( secs < 0 )										// Shouldn't happen
+	{
+		secs += 86400;
+		days--;
+	}
+
+	z   = days + 719468;
+	era = ( z >= 0 ? z : z - 146096 ) / 146097;
+	doe = z - era * 146097;
+	yoe = ( doe - doe / 1460 + doe / 36524 - doe / 146096 ) / 365;
+	doy = doe - ( 365 * yoe + yoe / 4 - yoe / 100 );
+	mp  = ( 5 * doy + 2 ) / 153;
+
+	c.t       = t;
+	c.day     = doy - ( 153 * mp + 2 ) / 5 + 1;
+	c.month   = mp < 10 ? mp + 3 : mp - 9;
+	c.year    = yoe + era * 400 + ( c.month <= 2 );
+	c.weekday = (( days % 7 ) + 11 ) % 7 + 1;			// 1/1/1970 was a Thursday
+	c.hour    = secs / 3600;
+	c.minute  = ( secs / 60 ) % 60;
+	c.second  = secs % 60;
+
+	c.newDay    = ( c.day != old.day ) || ( c.month != old.month ) || ( c.year != old.year );
+	c.newHour   = c.newDay || ( c.hour != old.hour );
+	c.newMinute = c.newHour || ( c.minute != old.minute );
+}
+
+#endif
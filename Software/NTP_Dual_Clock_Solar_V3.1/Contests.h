@@ -0,0 +1,277 @@
+#ifndef	_CONTESTS_H_					// Prevent double include
+#define	_CONTESTS_H_
+
+
+/*
+ *	Contest calendar parser; added in Version 3.2.
+ *
+ *	A contest calendar is an iCalendar ('.ics') file with a 'VEVENT' block for each
+ *	contest; a year's worth is a few hundred K bytes, far too much to hold. So
+ *	'ConFeed' takes it a piece at a time as it comes in and keeps just the contests
+ *	that haven't finished and start in the next 'CON_DAYS' days, the 'CON_MAX'
+ *	soonest, in order of their start times. 'ConNext' then finds the next one to
+ *	start with a binary search. Nothing is allocated; 'conParser' is all of it.
+ *
+ *	It's in here rather than in the main program so 'contest_bench.sh' (in the
+ *	'Software' folder) can build it on a computer and feed it a whole calendar.
+ *
+ *	Only the start, end and name ('SUMMARY') are kept. The times are taken as UTC,
+ *	which is what the ham radio calendars use; a 'TZID' on one is ignored. Lines
+ *	longer than 'CON_LINE' are cut short, which only matters for long names and
+ *	descriptions.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define CON_MAX			   32					// Most contests kept
+#define CON_NAME		   24					// Longest name kept (plus 1)
+#define CON_LINE		   96					// Longest line looked at (plus 1)
+#define CON_DAYS		   14					// How far ahead to look
+
+struct contest
+{
+	uint32_t	start;					// UTC
+	uint32_t	end;					// First second after it
+	char		name[CON_NAME];
+};
+
+struct conParser
+{
+	uint32_t	now;					// Keep what hasn't ended by this time
+	contest		list[CON_MAX];			// What's kept, soonest first
+	uint8_t		count;					// How many
+	contest		event;					// The one being read
+	bool		inEvent;				// Inside a 'VEVENT'
+	bool		done;					// Got to 'END:VCALENDAR'
+	bool		lineEnded;				// 'line' is whole unless the next one continues it
+	uint16_t	used;					// Characters in 'line'
+	uint16_t	length;					// and in the whole line
+	char		line[CON_LINE];			// Line being put together
+	uint32_t	events;					// 'VEVENT's seen
+	uint16_t	longest;				// Longest line seen
+};
+
+
+/*
+ *	'ConTime' turns an iCalendar date ("20261024") or date and time
+ *	("20261024T120000Z") into seconds since 1970, or 0 if it isn't one. The days
+ *	are counted the way Howard Hinnant's 'days_from_civil' does it, with the year
+ *	starting in March so February's odd length comes last.
+ */
+
+uint32_t ConTime ( const char* text )
+{
+	const uint8_t	digits[6] = { 4, 2, 2, 2, 2, 2 };	// Year, month, day, hour, minute, second
+	uint16_t		f[6] = {};
+
+	for ( uint8_t i = 0; i < 6; i++ )
+	{
+		if ( i == 3 )									// Just a date?
+		{
+			if ( *text != 'T' )
+				break;
+
+			text++;
+		}
+
+		for ( uint8_t k = 0; k < digits[i]; k++, text++ )
+		{
+			if (( *text < '0' ) || ( *text > '9' ))
+				return 0;
+
+			f[i] = f[i] * 10 + *text - '0';
+		}
+	}
+
+	if (( f[0] < 1970 ) || ( f[1] < 1 ) || ( f[1] > 12 ) || ( f[2] < 1 ) || ( f[2] > 31 )
+			|| ( f[3] > 23 ) || ( f[4] > 59 ) || ( f[5] > 60 ))
+		return 0;
+
+	uint32_t	y   = f[0] - ( f[1] <= 2 );				// Year starting in March
+	uint32_t	era = y / 400;
+	uint32_t	yoe = y - era * 400;					// Year of the era
+	uint32_t	doy = ( 153 * ( f[1] > 2 ? f[1] - 3 : f[1] + 9 ) + 2 ) / 5 + f[2] - 1;
+	uint32_t	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;	// Day of the era
+	uint32_t	day = era * 146097 + doe - 719468;		// Since 1/1/1970
+
+	return day * 86400UL + f[3] * 3600UL + f[4] * 60UL + f[5];
+}
+
+
+/*
+ *	'ConKeep' puts the event just read in its place in the list if it's one we
+ *	want. When the list is full, the one that starts last is dropped for it.
+ */
+
+void ConKeep ( conParser& p )
+{
+	contest&	e = p.event;
+	uint8_t		i;
+
+	if ( !e.start || ( e.end <= p.now ) || ( e.start >= p.now + CON_DAYS * 86400UL ))
+		return;
+
+	if ( p.count == CON_MAX )
+	{
+		if ( e.start >= p.list[CON_MAX - 1].start )		// After all of them
+			return;
+
+		p.count--;										// Make room
+	}
+
+	for ( i = p.count; ( i > 0 ) && ( p.list[i - 1].start > e.start ); i-- )
+		p.list[i] = p.list[i - 1];
+
+	p.list[i] = e;
+	p.count++;
+}
+
+
+/*
+ *	'ConLine' does one whole line: "NAME;PARAMETERS:VALUE".
+ */
+
+void ConLine ( conParser& p )
+{
+	char*	value = strchr ( p.line, ':' );
+
+	p.longest = ( p.length > p.longest ) ? p.length : p.longest;
+
+	if ( !value )
+		return;
+
+	*value++ = 0;
+	p.line[strcspn ( p.line, ";" )] = 0;				// Just the name
+
+	if ( !strcmp ( p.line, "BEGIN" ) && !strcmp ( value, "VEVENT" ))
+	{
+		memset ( &p.event, 0, sizeof ( p.event ));
+		p.inEvent = true;
+	}
+
+	else if ( !strcmp ( p.line, "END" ) && !strcmp ( value, "VEVENT" ) && p.inEvent )
+	{
+		if ( !p.event.end )								// No end; just a moment
+			p.event.end = p.event.start + 1;
+
+		p.events++;
+		p.inEvent = false;
+		ConKeep ( p );
+	}
+
+	else if ( !strcmp ( p.line, "END" ) && !strcmp ( value, "VCALENDAR" ))
+		p.done = true;
+
+	else if ( !p.inEvent )
+		return;
+
+	else if ( !strcmp ( p.line, "DTSTART" ))
+		p.event.start = ConTime ( value );
+
+	else if ( !strcmp ( p.line, "DTEND" ))
+		p.event.end = ConTime ( value );
+
+	else if ( !strcmp ( p.line, "SUMMARY" ))			// Without the '\' escapes
+	{
+		uint8_t	n = 0;
+
+		for ( ; *value && ( n < CON_NAME - 1 ); value++ )
+		{
+			if (( *value == '\\' ) && value[1] )		// "\," is ","
+				value++;
+
+			p.event.name[n++] = *value;
+		}
+
+		p.event.name[n] = 0;
+	}
+}
+
+
+/*
+ *	'ConBegin' gets ready for a new calendar, keeping the contests that haven't
+ *	ended by 'now'. 'ConFeed' takes the next 'len' bytes of it. A line that starts
+ *	with a space or tab continues the one before, so a line is only done once the
+ *	first character of the next is in. 'ConEnd' finishes the last line and says if
+ *	the whole calendar was there.
+ */
+
+void ConBegin ( conParser& p, uint32_t now )
+{
+	memset ( &p, 0, sizeof ( p ));
+	p.now = now;
+}
+
+
+void ConFeed ( conParser& p, const char* data, size_t len )
+{
+	for ( size_t i = 0; i < len; i++ )
+	{
+		char	ch = data[i];
+
+		if ( ch == '\r' )
+			continue;
+
+		if ( p.lineEnded )
+		{
+			p.lineEnded = false;
+
+			if (( ch == ' ' ) || ( ch == '\t' ))		// Folded; carry on with it
+				continue;
+
+			ConLine ( p );
+			p.used = p.length = 0;
+		}
+
+		if ( ch == '\n' )
+		{
+			p.line[p.used] = 0;
+			p.lineEnded = true;
+			continue;
+		}
+
+		p.length++;
+
+		if ( p.used < CON_LINE - 1 )
+			p.line[p.used++] = ch;
+	}
+}
+
+
+bool ConEnd ( conParser& p )
+{
+	if ( p.lineEnded || p.used )
+	{
+		p.line[p.used] = 0;
+		ConLine ( p );
+	}
+
+	return p.done;
+}
+
+
+/*
+ *	'ConNext' gives the index of the first contest in 'list' that starts after
+ *	'now', or 'count' if there isn't one.
+ */
+
+uint8_t ConNext ( const contest* list, uint8_t count, uint32_t now )
+{
+	uint8_t	lo = 0;
+	uint8_t	hi = count;
+
+	while ( lo < hi )
+	{
+		uint8_t	mid = ( lo + hi ) / 2;
+
+		if ( list[mid].start <= now )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef	_LANSYNC_H_						// Prevent double include
+#define	_LANSYNC_H_
+
+
+/*
+ *	LAN clock synchronization protocol; added in Version 3.2.
+ *
+ *	Every clock broadcasts a 'hello' packet every couple of seconds. The clock with
+ *	the lowest chip ID that has been heard from recently is the leader; all the
+ *	others are followers. A follower periodically sends the leader a request
+ *	stamped with its own time (T1). The leader stamps the arrival (T2) and its
+ *	reply (T3), and the follower stamps the arrival of the reply (T4). Just like
+ *	NTP, the offset to the leader is ((T2 - T1) + (T3 - T4)) / 2 and the round trip
+ *	time is (T4 - T1) - (T3 - T2).
+ *
+ *	Network jitter is dealt with by keeping the last 'LAN_SAMPLES' results and
+ *	only believing the one with the shortest round trip, as that's the one least
+ *	likely to have been held up in one direction only.
+ *
+ *	It's in here rather than in the main program so 'sync_sim.sh' (in the
+ *	'Software' folder) can build it on a computer and run several clocks against
+ *	each other over the loopback network with jitter added. Nothing in here sends,
+ *	receives or reads a clock; the caller stamps the packets, sends them and passes
+ *	in its 'millis ()'. All the times in the packets are milliseconds since
+ *	1/1/1970 UTC.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LAN_MAGIC		0x4B434257				// "WBCK" identifies our packets
+#define LAN_HELLO		1						// Announce ourselves
+#define LAN_REQUEST		2						// Follower asks for leader's time
+#define LAN_REPLY		3						// Leader answers
+
+#define LAN_HELLO_MS	 2000					// How often we announce ourselves
+#define LAN_POLL_MS		 4000					// How often a follower polls the leader
+#define LAN_TIMEOUT_MS	10000					// Leader is gone if not heard for this long
+#define LAN_STEP_MS		  500					// Bigger errors are stepped, not slewed
+#define LAN_SAMPLES		    8					// Size of the round trip filter
+
+
+/*
+ *	The 'lanPacket' is what the clocks send each other. 'lanSample' is one result
+ *	of a request/reply exchange with the leader, and 'lanSync' is everything one
+ *	clock knows about the others.
+ */
+
+struct lanPacket
+{
+	uint32_t	magic;					// Always 'LAN_MAGIC'
+	uint8_t		type;					// 'LAN_HELLO', 'LAN_REQUEST' or 'LAN_REPLY'
+	uint8_t		spare;					// Not used
+	uint16_t	seq;					// Matches replies to requests
+	uint32_t	id;						// Sender's chip ID
+	int32_t		skew;					// Follower's measured skew (ms)
+	int64_t		t1;						// Follower's time when request sent
+	int64_t		t2;						// Leader's time when request received
+	int64_t		t3;						// Leader's time when reply sent
+} __attribute__ (( packed ));
+
+struct lanSample
+{
+	int32_t		offset;					// Leader's time minus ours
+	int32_t		rtt;					// Round trip time
+};
+
+struct lanSync
+{
+	uint32_t	myId;					// Our chip ID
+	uint32_t	leaderId;				// Chip ID of the current leader
+	uint32_t	leaderAddr;				// and where to find it (IPv4 address)
+	uint32_t	leaderSeen;				// 'millis ()' when last heard from it
+	uint32_t	followerSeen;			// 'millis ()' when a follower last polled us
+	uint16_t	seq;					// Sequence number of our last request
+
+	lanSample	samples[LAN_SAMPLES];	// Recent exchanges with the leader
+	uint8_t		count;					// How many are valid
+	uint8_t		index;					// Where the next one goes
+
+	int32_t		offset;					// Added to our time to get the leader's (ms)
+	int32_t		rtt;					// Round trip time of best sample (ms)
+	int32_t		skew;					// Measured inter-clock skew (ms)
+};
+
+
+/*
+ *	'LanBegin' starts a clock off as its own leader until it hears from one with a
+ *	lower ID.
+ */
+
+void LanBegin ( lanSync& s, uint32_t id )
+{
+	memset ( &s, 0, sizeof ( s ));
+	s.myId     = id;
+	s.leaderId = id;
+}
+
+
+/*
+ *	'LanFollow' gets called with the four time stamps of a completed exchange.
+ *	The best (shortest round trip) of the recent samples is the one we steer to.
+ *	Small errors are slewed halfway each time so the display never jumps by more
+ *	than a fraction of the error; big ones (a new leader or our own NTP update)
+ *	are stepped.
+ */
+
+void LanFollow ( lanSync& s, int64_t t1, int64_t t2, int64_t t3, int64_t t4 )
+{
+	lanSample	best;									// Best sample in the filter
+	int32_t		error;									// Difference from current offset
+
+	s.samples[s.index].offset = (( t2 - t1 ) + ( t3 - t4 )) / 2;
+	s.samples[s.index].rtt    =  ( t4 - t1 ) - ( t3 - t2 );
+
+	s.index = ( s.index + 1 ) % LAN_SAMPLES;
+	if ( s.count < LAN_SAMPLES )
+		s.count++;
+
+	best = s.samples[0];
+
+	for ( int16_t i = 1; i < s.count; i++ )				// Find the shortest round trip
+		if ( s.samples[i].rtt < best.rtt )
+			best = s.samples[i];
+
+	error  = best.offset - s.offset;					// How far off are we?
+	s.rtt  = best.rtt;
+
+	if ( abs ( error ) > LAN_STEP_MS )					// Way off; just jump
+		s.offset = best.offset;
+
+	else												// Otherwise creep up on it
+		s.offset += error / 2;
+
+	s.skew = ( 3 * s.skew + abs ( error )) / 4;			// Smoothed skew
+}
+
+
+/*
+ *	'LanStamp' fills in the common part of a packet before it's sent.
+ */
+
+void LanStamp ( lanSync& s, lanPacket& pkt, uint8_t type )
+{
+	pkt.magic = LAN_MAGIC;
+	pkt.type  = type;
+	pkt.spare = 0;
+	pkt.id    = s.myId;
+}
+
+
+/*
+ *	'LanReceive' deals with a packet that arrived from 'from' at our time
+ *	'arrival' ('ms' is 'millis ()'). It returns 'true' if 'pkt' is now a reply
+ *	that should go back to 'from' once the caller has put the time it's sent in
+ *	't3'.
+ */
+
+bool LanReceive ( lanSync& s, lanPacket& pkt, int64_t arrival, uint32_t from, uint32_t ms )
+{
+	if (( pkt.magic != LAN_MAGIC ) || ( pkt.id == s.myId ))
+		return false;									// Not for us or our own broadcast
+
+	switch ( pkt.type )
+	{
+		case LAN_HELLO:									// Another clock is out there
+			if ( pkt.id <= s.leaderId )					// Lowest ID wins
+			{
+				if ( pkt.id != s.leaderId )				// New leader; old samples
+					s.count = 0;						// are meaningless
+
+				s.leaderId   = pkt.id;
+				s.leaderAddr = from;
+				s.leaderSeen = ms;
+			}
+			return false;
+
+		case LAN_REQUEST:								// A follower wants our time
+			s.followerSeen = ms;
+			pkt.t2 = arrival;
+
+			if ( abs ( pkt.skew ) > s.skew )			// Leader reports the worst
+				s.skew = abs ( pkt.skew );				// follower's skew
+
+			LanStamp ( s, pkt, LAN_REPLY );
+			return true;
+
+		case LAN_REPLY:									// Answer to our request
+			if (( pkt.id == s.leaderId ) && ( pkt.seq == s.seq ))
+				LanFollow ( s, pkt.t1, pkt.t2, pkt.t3, arrival );
+			return false;
+	}
+
+	return false;
+}
+
+
+/*
+ *	'LanLeaderLost' takes over as leader if the leader hasn't been heard from for
+ *	'LAN_TIMEOUT_MS' and says if it did.
+ */
+
+bool LanLeaderLost ( lanSync& s, uint32_t ms )
+{
+	if (( s.leaderId == s.myId ) || (( ms - s.leaderSeen ) <= LAN_TIMEOUT_MS ))
+		return false;
+
+	s.leaderId = s.myId;
+	s.offset   = 0;
+	s.count    = 0;
+	s.skew     = 0;
+	return true;
+}
+
+
+/*
+ *	'LanRequest' makes 'pkt' a request to the leader sent at our time 't1'.
+ */
+
+void LanRequest ( lanSync& s, lanPacket& pkt, int64_t t1 )
+{
+	memset ( &pkt, 0, sizeof ( pkt ));
+	pkt.seq  = ++s.seq;
+	pkt.skew = s.skew;
+	pkt.t1   = t1;
+	LanStamp ( s, pkt, LAN_REQUEST );
+}
+
+#endif
@@ -47,6 +47,87 @@
  *
  *				11/01/25	Version 3.1 added the capability to display a repeating
  *							sequence of local timezones. 
+ *
+ *				10/18/26	Version 3.2 lets several clocks on the same LAN elect
+ *							a leader and flip their seconds together.
+ *
+ *							Roam to a stronger access point with the same SSID
+ *							instead of waiting for the connection to drop.
+ *
+ *							Added a network health monitor that probes the gateway
+ *							and DNS server and shows the result next to the status.
+ *
+ *							Let the WiFi radio sleep between network activity.
+ *
+ *							Run the processor at 80 MHz except when it's busy.
+ *
+ *							Dim the backlight at night (following the local sunrise
+ *							and sunset), in a dark room and turn it off at night.
+ *
+ *							Added a night color scheme. On the ESP32 the screen is
+ *							drawn in a 16 color sprite so switching is just a
+ *							palette swap.
+ *
+ *							Added an optional analog face for the local time.
+ *
+ *							The solar data fetch uses memory set aside at startup
+ *							instead of the heap and keeps only the values shown.
+ *
+ *							Moved the time zone rules, month names and screen text
+ *							to flash memory to save RAM on the ESP8266.
+ *
+ *							The UTC and local times are broken down into date and
+ *							time once a second and shared by everything.
+ *
+ *							Added a benchmark of the busiest code.
+ *
+ *							The XML data is scanned once for all the values we
+ *							show instead of twice for each of them.
+ *
+ *							Solar data that's incomplete or not what we expected
+ *							is thrown away and the old values kept.
+ *
+ *							Added 'chaos.py' and some test settings for trying
+ *							the network code with bad connections.
+ *
+ *							The startup times (screen on, WiFi, NTP, first paint
+ *							and first solar data) are printed on the serial monitor.
+ *							'qemu.sh' checks the ESP32 build boots under emulation.
+ *
+ *							The WiFi networks, timezones, solar data items and
+ *							color breakpoints can be changed with a 'clock.cfg'
+ *							file, from a browser or on the serial monitor without
+ *							rebuilding or restarting.
+ *
+ *							A serial console for checking on and poking the clock;
+ *							type "help" on the serial monitor.
+ *
+ *							Firmware updates from a local web server, gzipped, in
+ *							the background; on the ESP32 new firmware that doesn't
+ *							show the time within 2 minutes is rolled back.
+ *
+ *							Startups, restarts, WiFi roams, NTP syncs, fetches,
+ *							settings changes and firmware updates are kept in a
+ *							log in flash; type "log" on the serial monitor or go to
+ *							"http://<clock address>/events" to see it.
+ *
+ *							A loop watchdog counts the times the clock gets held up
+ *							and logs where; it can restart the clock if it's stuck.
+ *
+ *							The screen layout follows the display's size, with
+ *							bigger digits on 480 x 320 displays; the benchmark
+ *							checks the drawing times against a budget for each.
+ *
+ *							A thumbnail of the latest picture of the sun can be
+ *							one of the solar data items ('SHOW_SUN'); it's decoded
+ *							as it comes in and kept in flash.
+ *
+ *							The time to the next contest from a contest calendar
+ *							('SHOW_CON' and 'CONTEST_URL').
+ *
+ *							The solar data connection is kept open between fetches
+ *							when the server allows it; type "pool" on the serial
+ *							monitor to see how much that saves.
  */
 
 
@@ -57,8 +138,20 @@
 #include <TFT_eSPI.h>			// https://github.com/Bodmer/TFT_eSPI
 #include <ezTime.h>				// https://github.com/ropg/ezTime
 #include <WiFiClientSecure.h>	// Actually different versions for the two processors
+#include <WiFiUdp.h>			// For talking to other clocks on the LAN
+#include <LittleFS.h>			// For the configuration file
+#include <TJpg_Decoder.h>		// https://github.com/Bodmer/TJpg_Decoder (for its 'tjpgd')
+#include <new>					// Placement 'new' for the fetch arena
 #include "UserSettings.h"		// User customizable settings
 #include "Certificate.h"		// The hamqsl SSL certificate
+#include "Calendar.h"			// Breaking down the time
+#include "SolarXml.h"			// Solar data parser
+#include "SolarSample.h"		// Solar data for the benchmark
+#include "Contests.h"			// Contest calendar parser
+#include "SunPack.h"			// Packing the picture of the sun
+#include "LanSync.h"			// LAN clock synchronization protocol
+#include "PowerModel.h"			// Power estimates
+#include "Roam.h"				// WiFi roaming decisions
 
 
 /*
@@ -78,17 +171,56 @@
 
 	#include <HTTPClient.h>
 	#include <WiFi.h>
+	#include <esp_wifi.h>				// For the listen interval
+	#include <WebServer.h>				// For changing the settings
+	#include <Update.h>					// For firmware updates
+	#include <esp_ota_ops.h>			// and trying them out
+	#include <Ticker.h>
+	#include <rom/miniz.h>				// Decompressor in the ROM
+	#include <mbedtls/sha256.h>
+
+	#if !defined ( printf_P )			// Format strings are in flash anyway
+		#define printf_P	printf
+	#endif
 
 #elif defined(ESP8266)
 
 	#include <ESP8266HTTPClient.h>
 	#include <ESP8266WiFi.h>
+	#include <ESP8266WebServer.h>		// For changing the settings
+	#include <Updater.h>				// For firmware updates
+	#include <bearssl/bearssl_hash.h>	// For checking them
+	#include <Ticker.h>					// For the loop watchdog
+	extern "C" {
+		#include <user_interface.h>		// For 'system_update_cpu_freq'
+	}
 	X509List cert ( HQSL_Root_Cert );	// Make certificate a list for the API
 
 #endif
 
 #define NTP_SERVER "pool.ntp.org"						// Where we get the time information
 #define SW_URL "https://www.hamqsl.com/solarxml.php"	// hamqsl provides the solar data
+#define SUN_URL "https://sdo.gsfc.nasa.gov/assets/img/latest/latest_256_0193.jpg"	// and NASA's SDO the sun
+
+
+/*
+ *	For testing the network code with 'chaos.py' (in the 'Software' folder), set
+ *	'TEST_HOST' to the address of the computer running it. The clock then gets its
+ *	time, solar data, sun picture and contests from there (without checking the
+ *	certificate)
+ *	and prints a "Test:" line after each fetch. 'TEST_FLAP_SECONDS' drops the WiFi
+ *	connection that often to see how the clock copes. Leave them as "" and 0
+ *	normally.
+ */
+
+#define TEST_HOST			""							// Test server address
+#define TEST_FLAP_SECONDS	 0							// Time between WiFi drops
+#define TESTING				( sizeof ( TEST_HOST ) > 1 )
+#define TEST_URL			"https://" TEST_HOST ":8443/solarxml.php"
+#define TEST_SUN_URL		"https://" TEST_HOST ":8443/sun.jpg"
+#define TEST_CON_URL		"https://" TEST_HOST ":8443/contests.ics"
+
+#define STALL_MS		 1500							// A second later than this is a stall
 
 
 /*
@@ -105,968 +237,6919 @@
  *	The numbers are in seconds:
  */
 
+#define NTP_INTERVAL	 1800					// Seconds between NTP updates
 #define SYNC_MARGINAL	 3600					// Orange status if no sync for 1 hour
 #define SYNC_LOST		86400					// Red status if no sync for 1 day
 
 
 /*
- *	The following 'typedef' is used in building the list of functions that
- *	will display the different data items in the UTC header block. All the
- *	display functions have to be of the form 'void fcn ()'. The elements of
- *	the list are built by looking at settings in the 'UserSettings.h' file
- *	by the 'BuildDataItemList' function.
+ *	These control the network health monitor (see 'NetHealth'). The latency
+ *	histograms have 'NH_BUCKETS' buckets; the upper edges (in milliseconds) of all
+ *	but the last one are in the 'nhEdges' array.
  */
 
-typedef void (*function) ();
+#define NH_PORT			 4124					// Local UDP port for the probes
+#define NH_PROBE_MS		 5000					// Time between probes
+#define NH_TIMEOUT_MS	 1000					// A probe not answered by then is lost
+#define NH_WINDOW_MS   600000					// Each window covers 10 minutes
+#define NH_WINDOWS			6					// and we keep an hour's worth
+#define NH_BUCKETS		   10					// Latency histogram buckets
+#define NH_GATEWAY			0					// Probe targets
+#define NH_DNS				1
 
-function dataItems[DATA_ITEMS];			// List of pointers to display functions
-int16_t dataIndex = 0;					// Index into 'dataItems' array
+#define NH_MARGINAL_LOSS   20					// Percent loss for an orange dot
+#define NH_BAD_LOSS		   50					// and for a red one
+#define NH_MARGINAL_P90	  200					// 90th percentile latency for orange
 
-TFT_eSPI tft = TFT_eSPI();				// Create the display object
-Timezone local;							// Local timezone variable
 
-uint8_t tzIndex = 0;					// Index to local timezone to display
+/*
+ *	These control the radio power management (see 'RadioPower'). The wake times
+ *	and the currents used for the estimate are in 'PowerModel.h'.
+ */
 
-time_t t,  oldT;						// Current & displayed UTC time
-time_t lt, oldLt;						// Current & displayed local time
+#define LAN_LEAD_MS		10000					// Leader with followers stays awake
 
-bool useLocalTime = false;				// Temp flag used for display updates
 
-String xmlData = "";					// Holds the XML data from 'hamqsl.com'		
+/*
+ *	These control the processor speed (see 'CpuBoost'). The currents are rough
+ *	figures for the processor alone at each speed and are only used for the energy
+ *	estimate. The ESP32 WiFi needs at least 80 MHz; the ESP8266 only has 80 and 160.
+ */
+
+#if defined ( ESP32 )
+	#define CPU_IDLE_MHZ	   80					// Speed when idle
+	#define CPU_BUSY_MHZ	  240					// and when busy
+	#define CPU_MA_IDLE		   20					// mA at idle speed
+	#define CPU_MA_BUSY		   40					// and at busy speed
+#elif defined ( ESP8266 )
+	#define CPU_IDLE_MHZ	   80
+	#define CPU_BUSY_MHZ	  160
+	#define CPU_MA_IDLE		   15
+	#define CPU_MA_BUSY		   23
+#endif
 
 
 /*
- *	The 'setup' function builds the list of solar data items to be displayed,
- *	initializes the display, serial monitor and a few other things.
+ *	These control the backlight (see 'Backlight'). The fade and step times and
+ *	the current used for the estimate are in 'PowerModel.h'.
  */
 
-void setup ()
-{
-	BuildDataItemList ();					// Build list of solar data to display
+#define BL_PWM_FREQ		 5000					// Backlight PWM frequency (Hz)
+#define BL_SENSE_MS		  500					// Time between light sensor readings
 
-	tft.init ();							// Initialize TFT screen object
-	tft.setRotation ( SCREEN_ORIENTATION );	// Landscape screen orientation
 
-	ShowSplash ();							// Shows the credits
-	delay ( 5000 );							// Time to read it (5 seconds)
-	StartupScreen ();						// Mostly blank for connection statuses
+/*
+ *	Everything created while fetching and decoding the solar data goes in a block
+ *	of memory set aside at startup (see 'ArenaAlloc'). The limits on the XML data
+ *	itself are in 'SolarXml.h'. The arena is never given back to the heap, so on
+ *	the ESP8266 it's only as big as the biggest thing put in it needs (reading the
+ *	settings file or the picture of the sun; see the checks after 'ArenaWriter').
+ *
+ *	'SOAK_SECONDS' is for testing; if not zero, the solar data is fetched that often
+ *	and the heap is reported after each fetch, so a few hours at 30 seconds covers
+ *	a couple of weeks of normal fetches. Please don't leave it running on Paul's
+ *	server!
+ */
 
-	Serial.begin ( BAUDRATE );				// Start the serial port
-	delay ( 1000 );							// Allow time to initialize
+#if defined ( ESP32 )
+	#define ARENA_SIZE	10240					// Bytes in the arena
+#elif defined ( ESP8266 )
+	#define ARENA_SIZE	 7168
+#endif
 
-	setDebug ( DEBUGLEVEL );				// Enable NTP debug level
-	setServer ( NTP_SERVER );				// Set NTP server URL
+#define SOAK_SECONDS		0					// Fetch interval for testing the heap
 
-	ShowConnectionProgress ();				// Connect to the WiFi and NTP server
 
-	local.setPosix ( timeZones[0] );		// Set local time zone to 1st rule
+/*
+ *	Setting 'BENCHMARK' to 'true' times the clock's busiest code at startup and
+ *	prints the results on the serial monitor (see 'Benchmark'). 'qemu.sh --bench'
+ *	sets it from the compiler command line.
+ */
 
-	configTime ( 0, 0, NTP_SERVER );		// Needed for https - why? (also timezone doesn't matter here)
+#if !defined ( BENCHMARK )
+	#define BENCHMARK	false					// Run the benchmark at startup
+#endif
 
-	NewDualScreen ();						// Show title & labels
-}											// End of 'setup'
+#define BENCH_VERSION		2					// Change if the output format changes
+												// ('host_bench.sh' uses it too)
 
 
 /*
- *	The 'loop' function runs forever. It gets periodic time updates from the
- *	NTP time server and whenever the time changes, it updates the display.
- *
- *	Modified in Version 3.1 to allow a repeating sequence of local timezones to
- *	be displayed. 
+ *	The time from power on to the clock showing the time (and the first solar
+ *	data) is printed on the serial monitor as "Timing:" lines; see 'Mark'.
  */
 
-void loop ()
-{
-	events ();								// Get periodic NTP updates
+#define MARKS				8					// Most startup times kept
+#define CONSOLE_LINE	  128					// Longest command (see 'Console')
 
-	t = now ();								// Get latest UTC time
 
-	if ( t != oldT )						// Did it change (new second)?
-	{
-		if ( second ( local.now () % TZ_INTERVAL ) == 0 )	// Time for next timezone?
-		{
-			tzIndex++;										// Point to the next one
-			if ( tzIndex >= tzCount )						// But not beyond the
-				tzIndex = 0;								// end of the list
-			local.setPosix ( timeZones[tzIndex] );			// Set new local time zone by rule
-		}
+/*
+ *	The settings from 'UserSettings.h' can be changed by the 'clock.cfg' file (see
+ *	'ConfigBegin'). These are the limits on what it can hold. 'clock.bin' is the
+ *	same settings already decoded; change 'CONFIG_VERSION' if the 'config' layout
+ *	changes in a way its size doesn't show.
+ */
 
-		UpdateDisplay ();					// Update clock every second
-		ShowNextData ();					// Show selected solar data
-		oldT = t;							// Displayed time is current time
-	}
-}
+#define CONFIG_FILE		"/clock.cfg"			// The settings as text
+#define CACHE_FILE		"/clock.bin"			// and as a 'configCache'
+#define CONFIG_VERSION		4
+#define CONFIG_MAX		 4096					// Biggest file we'll read
+#define CONFIG_NETWORKS		8					// Most WiFi networks
+#define CONFIG_ZONES		8					// Most timezones
+#define SSID_SIZE		   33					// Longest network name (plus 1)
+#define PWD_SIZE		   65					// Longest password (plus 1)
+#define ZONE_SIZE		   50					// Longest timezone rule (plus 1)
+#define ITEM_KINDS			7					// Solar data items there are
+#define OTA_URL_SIZE	   64					// Longest firmware update URL (plus 1)
+#define CONFIG_APPLY_MS	 1000					// Time for the web reply to get out
 
 
 /*
- *	Setup Functions; the following functions are primarily used in the clock
- *	start up, although a couple of them are also used during normal operation.
- *
- *	'BuildDataItemList' looks at the 'SHOW_xxx' definitions in the 'UserSettings.h'
- *	file and for those that are non-zero, adds pointers to the functions to display
- *	them in the proper slots in the 'dataItems' array.
- *
- *	Instructions for selecting which items to display are in the 'UserSettings.h'
- *	file. It's kind of brute force, but it works!
+ *	Firmware updates (see 'OtaPoll') are read 'OTA_CHUNK' bytes at a time, between
+ *	'OTA_BUDGET_MIN' and 'OTA_BUDGET_MAX' bytes a slice, aiming for slices of no
+ *	more than 'OTA_SLICE_MS'. New firmware on an ESP32 has 'OTA_VERIFY_SECONDS' to
+ *	show the time or the old one comes back.
  */
 
-void BuildDataItemList ()
-{
-	if ( DATA_ITEMS == 0 )						// User doesn't want any solar data
-		return;
+#define OTA_MINUTE			15					// Minute past the hour to look
+#define OTA_CHUNK		 1024					// Bytes per read
+#define OTA_BUDGET_MIN	  512					// Bytes per slice
+#define OTA_BUDGET_MAX	16384
+#define OTA_SLICE_MS		40					// Longest slice we want
+#define OTA_CONNECT_MS	 1500					// Longest wait for the server
+#define OTA_TIMEOUT_MS	15000					// Give up if nothing for this long
+#define OTA_VERIFY_SECONDS	120					// Time new firmware gets to work
+
 
-	if ( SHOW_SFI )								// Display SFI, 'A' and 'K'?
-		dataItems[SHOW_SFI - 1] = &ShowSFI;		// Add it to the list
+/*
+ *	The event log (see 'EventLog') is 'EVENT_PAGES' pages of 'EVENT_PAGE' bytes in
+ *	'EVENT_FILE', written round and round. New events wait in memory until their
+ *	page is full or 'EVENT_FLUSH_SECONDS' have gone by. The 'EV_' numbers are the
+ *	kinds of event and the 'RESTART_' numbers say why we restarted.
+ */
 
-	if ( SHOW_GMF )								// Display GMF?
-		dataItems[SHOW_GMF - 1] = &ShowGMF;		// Add that to the list
+#define EVENT_FILE		"/events.log"
+#define EVENT_PAGE		  256					// Bytes per page
+#define EVENT_PAGES			32					// 8K bytes in all
+#define EVENT_FLUSH_SECONDS	600					// Longest an event waits in memory
 
-	if ( SHOW_S2N )								// Display signal to noise?
-		dataItems[SHOW_S2N - 1] = &ShowS2N;		// Add that to the list
+#define EV_UPTIME		 0x01					// 'flags': time is seconds since startup
 
-	if ( SHOW_AUR )								// Display Aurora level?
-		dataItems[SHOW_AUR - 1] = &ShowAUR;		// Add that to the list
+#define EV_BOOT				1					// a = reset reason
+#define EV_RESTART			2					// a = 'RESTART_' reason
+#define EV_ROAM				3					// a = channel (-1 failed), b = RSSI
+#define EV_NTP				4					// a = 1 (0 first), b = offset ms, c = round trip ms
+#define EV_FETCH			5					// a = HTTP code, b = ms, c = 1 if good
+#define EV_CONFIG			6					// a = 1 web, 2 serial
+#define EV_OTA				7					// a = 1 started, 2 done, 3 failed; b = bytes
+#define EV_STALL			8					// a = 'PH_' phase, b = ms, c = lines
 
-	if ( SHOW_SSN )								// Display Aurora level?
-		dataItems[SHOW_SSN - 1] = &ShowSSN;		// Add that to the list
-}
+#define RESTART_WIFI		1					// Lost the WiFi connection
+#define RESTART_OTA			2					// New firmware
+#define RESTART_ROLLBACK	3					// New firmware failed its trial
+#define RESTART_STALL		4					// Stuck for 'STALL_RESET' seconds
 
 
 /*
- *	'ShowSplash' displays the program title and the author cedits. 
+ *	The loop watchdog (see 'Phase') counts every stretch of more than 'WATCH_MS'
+ *	without a 'PHASE' checkpoint in 'WATCH_BUCKETS' buckets (each twice as long as
+ *	the last) for each of the 'PH_' phases, and logs those of more than
+ *	'WATCH_LOG_MS'. With 'STALL_RESET' set, it looks every 'WATCH_TICK_MS' to see
+ *	if we're stuck.
  */
 
-void ShowSplash ( void )
-{
-	tft.fillScreen ( TFT_BLACK );						// Start with empty screen
-	
-	tft.setTextDatum ( TC_DATUM );						// Top center text position datum
+#define WATCH_MS		  250					// Shortest stall counted
+#define WATCH_LOG_MS	 3000					// Shortest one logged
+#define WATCH_BUCKETS		6					// 250 ms to 8 seconds and over
+#define WATCH_KEEP			8					// Recent stalls kept for "stalls"
+#define WATCH_TICK_MS	 1000
+#define WATCH_MAGIC		0x57415443				// "WATC"
+#define ROLLBACK_MAGIC	0x524F4C4C				// "ROLL"; gave up on new firmware
 
-	tft.setFreeFont  ( &FreeSerifBoldItalic18pt7b );	// Title font
-	tft.setTextColor ( TFT_MAGENTA );					// and color
-	tft.drawString	 ( "W8BH NTP Clock", 160, 20 );		// Paint the title
+#define PH_LOOP				0					// Everything else in 'loop'
+#define PH_EVENTS			1					// ezTime's 'events' (NTP)
+#define PH_RENDER			2					// Drawing the screen
+#define PH_FETCH			3					// Getting the solar data
+#define PH_PARSE			4					// and making sense of it
+#define PH_STATUS			5					// Checking the WiFi connection
+#define PHASES				6
 
-	tft.setFreeFont  ( &FreeSansBold9pt7b );			// Font for the credits
-	
-	tft.drawString	 ("Version 3.1", 160, 60);			// Show the version
-	
-	tft.setTextDatum ( TL_DATUM );						// Back to default top left
-	tft.setTextColor ( TFT_WHITE );						// Back to white
+#define PHASE(id)		Phase ( id, __LINE__ )	// Checkpoint here
 
-	tft.drawString ( "Originally by: W8BH", 30, 100 );			// Display
-	tft.drawString ( "Modified by: WA2FZW & AI6P", 30, 130 );	// the credits
-	tft.drawString ( "Solar data from: N0NBH", 30, 160 );
 
-	tft.setFreeFont  ( NULL );							// Select default font
-}
+/*
+ *	Longest string that can be copied out of flash memory by 'FlashText' (plus 1);
+ *	longer ones are cut short. There are only two of its buffers, used in turn,
+ *	so no more than two of its results can be in use at once: the third call
+ *	writes over the first one's.
+ */
+
+#define FLASH_TEXT		   48
 
 
 /*
- *	'StartupScreen' paints a mostly empty screen with just the 'TITLE' at the
- *	top. The blank area will be filled with the WiFi connection status and NTP
- *	connection status.
+ *	The display is drawn using colors from a 16 entry palette (see 'Ink'). These
+ *	are the indicies into the palettes. 'PAL_OK', 'PAL_WARN' and 'PAL_BAD' must be
+ *	in that order.
  */
 
-void StartupScreen()
-{
-	tft.fillScreen ( TFT_BLACK );							// Start with empty screen
-	tft.fillRoundRect ( 0, 0, 319, 32, 10, LABEL_BGCOLOR );	// Title block
-	tft.drawRoundRect ( 0, 0, 319, 239, 10, TFT_WHITE );	// Draw screen edge
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );		// Set label colors
-	tft.drawCentreString ( TITLE, 160, 6, 4 );				// Show the 'TITLE'
-	tft.setTextColor ( LABEL_FGCOLOR, TFT_BLACK );			// Set text color
-}	
+#define PAL_BG				0					// Screen background
+#define PAL_TIME			1					// 7-segment time display
+#define PAL_DATE			2					// Month & day
+#define PAL_LABEL_FG		3					// Label text
+#define PAL_LABEL_BG		4					// Label background
+#define PAL_EDGE			5					// Edges around the blocks
+#define PAL_NORMAL			6					// Solar data below any threshold
+#define PAL_MEDIUM			7					// Medium level
+#define PAL_HIGH			8					// Maximum
+#define PAL_OK				9					// Status indicator colors
+#define PAL_WARN		   10
+#define PAL_BAD			   11
+#define PAL_STATUS		   12					// Text on the status indicator
 
 
 /*
- *	'ShowConnectionProgress' was completely overhauled in Version 3.0. We now
- *	allow the user to define a list of WiFi networks that will be tried in order
- *	until a connection is established.
+ *	The screen was laid out for a 320 x 240 display. 'SCREEN_W' and 'SCREEN_H' are
+ *	the size of the one 'TFT_eSPI' is set up for, turned the way 'SCREEN_ORIENTATION'
+ *	says, and 'LX' and 'LY' scale the original boxes to fit it. Text positions
+ *	inside a box depend on its font rather than the screen, so they don't scale.
+ *	It all comes out as constants when the program is compiled.
  *
- *	We try each one 10 times and if we don't get a connection, we move onto the
- *	next one. If we don't get a connection on any of them, we start over with 
- *	the first one. Instructions on how to define the networks can be found in
- *	the 'UserSettings.h' file.
+ *	Displays 480 or more pixels across get the 75 pixel high digits (font 8)
+ *	instead of the 48 pixel ones (font 7); 'DIGIT_W' and 'COLON_W' are the widths
+ *	of the characters in the one used. The time has to be on the screen within
+ *	'RENDER_SECOND_US' of the second starting (background work starts after 50 ms;
+ *	see 'IdleSlice') and the whole screen should take no more than
+ *	'RENDER_SCREEN_US' to draw; the benchmark checks both.
  */
 
-void ShowConnectionProgress() 
-{
-	int16_t tries = 0;								// How many connection tries
-	int16_t index = 0;								// Index to list of networks
-	int16_t count = 0;								// Loop counter
+#define SCREEN_W		(( SCREEN_ORIENTATION & 1 ) ? TFT_HEIGHT : TFT_WIDTH )
+#define SCREEN_H		(( SCREEN_ORIENTATION & 1 ) ? TFT_WIDTH : TFT_HEIGHT )
 
-	int16_t networks = ELEMENTS ( ssid_pwd );		// Number of  networks in the list
+#define LX(x)			(( x ) * SCREEN_W / 320 )		// Scaled from 320 x 240
+#define LY(y)			(( y ) * SCREEN_H / 240 )
 
-	bool connected = false;							// Turns true when we connect
+#if SCREEN_W >= 480
 
-	StartupScreen ();
+	#define TIME_FONT		8					// Digits for the time
+	#define DIGIT_W		   55					// Width of each digit
+	#define COLON_W		   24					// and the colons
+	#define DIGIT_H		   75					// Height
+	#define RENDER_SECOND_US	40000			// Drawing budgets
+	#define RENDER_SCREEN_US   400000
 
-	tft.setFreeFont  ( &FreeSansBold9pt7b );		// Easier to read than the default
+#else
+
+	#define TIME_FONT		7
+	#define DIGIT_W		   32
+	#define COLON_W		   14
+	#define DIGIT_H		   48
+	#define RENDER_SECOND_US	25000
+	#define RENDER_SCREEN_US   200000
+
+#endif
+
+#define TIME_X			   10					// Left edge of the times
+#define LOCAL_Y			LY ( 46 )				// Top of the local time digits
+#define UTC_Y			LY ( 172 )				// and the UTC ones
+#define TIME_W			( 6 * DIGIT_W + 2 * COLON_W )	// 'HH:MM:SS'
+#define AMPM_W			   30					// 'AM' or 'PM' after it
+#define DATE_W			   58					// Date after that
+#define DATE_H			   60
+
+#define BAR_H			LY ( 33 )				// Title bars
+#define BOX_H			LY ( 110 )				// Boxes around the times
+#define UTC_TOP			LY ( 126 )				// Top of the UTC box
+#define SOLAR_X			   80					// Solar data, right of "UTC"
+#define SOLAR_Y			( UTC_TOP + ( LY ( 34 ) - 20 ) / 2 )	// in the UTC title bar
+
+static_assert ( TIME_X + TIME_W + AMPM_W + DATE_W <= SCREEN_W, "The time and date don't fit across the screen" );
+static_assert ( LOCAL_Y + DIGIT_H <= BOX_H, "The local time doesn't fit in its box" );
+static_assert ( UTC_Y + DIGIT_H <= UTC_TOP + BOX_H, "The UTC time doesn't fit in its box" );
+static_assert ( UTC_TOP + BOX_H < SCREEN_H, "The UTC box is off the screen" );
 
 
 /*
- *	First, we need to make sure there is at least one WiFi network in the list.
- *	If not we flash an error message on the screen forever!
+ *	Size and position of the analog clock face (see 'ShowAnalogTime'). It goes
+ *	where the local time digits would be. The hands are a fraction of the radius
+ *	in 1/16ths.
  */
 
-	while ( networks == 0 )							// No networks in the list!
-	{
-		tft.setTextColor ( TFT_RED, TFT_BLACK );
-		tft.drawString ( "NO WIFI NETWORKS DEFINED!", 25, 100 );
-		delay ( 1000 );
+#define FACE_X			LX ( 160 )				// Center of the face
+#define FACE_Y			LY ( 72 )
+#define FACE_R			LY ( 36 )				// Radius
+#define FACE_SIZE		( 2 * FACE_R + 1 )		// Width and height of the sprites
+
+#define HOUR_LEN			8					// Hour hand is 8/16ths of the radius
+#define MINUTE_LEN		   13
+#define SECOND_LEN		   14
 
-		tft.setTextColor ( TFT_WHITE, TFT_BLACK );
-		tft.drawString ( "NO WIFI NETWORKS DEFINED!", 25, 100 );
-		delay ( 1000 );
-	}
 
 /*
- *	Modified in Version 3.1:
- *
- *	Next, make sure at least one time zone is defined.
- *	If not we flash an error message on the screen forever!
+ *	The picture of the sun (see 'ShowSUN') is scaled down by the JPEG decoder to
+ *	fit in 'SUN_SIZE' pixels square and goes at 'SUN_X', 'SUN_Y' in the UTC title
+ *	bar. It's kept, packed, in 'SUN_FILE' and fetched again when it's more than
+ *	'SUN_REFRESH' seconds old, or 'SUN_RETRY_MS' after a failure. The decoder gets
+ *	what's left of the arena after 'SUN_ROWS' bytes for one row of its blocks; it
+ *	needs at least 'SUN_WORK' of it.
  */
 
-	while ( tzCount == 0 )							// No timezones in the list!
-	{
-		tft.setTextColor ( TFT_RED, TFT_BLACK );
-		tft.drawString ( "NO TIMEZONE DEFINED!", 25, 100 );
-		delay ( 1000 );
+#define SUN_SIZE		( LY ( 34 ) - 2 )		// Biggest picture that fits
+#define SUN_X			( SOLAR_X + 70 )		// Where it goes
+#define SUN_Y			( UTC_TOP + 1 )
+#define SUN_FILE		"/sun.bin"				// The picture we have
+#define SUN_TEMP		"/sun.tmp"				// and a new one coming in
+#define SUN_MAGIC		0x314E5553				// "SUN1"
+#define SUN_REFRESH		 3600					// Seconds before getting a new one
+#define SUN_RETRY_MS   600000					// Wait after a failure
+#define SUN_TIMEOUT_MS	 5000					// Longest wait for more of it
+#define SUN_ROWS		( SUN_SIZE * 16 * 2 )	// Blocks are up to 16 pixels high
+#define SUN_WORK		 3100					// Least the decoder can work with
 
-		tft.setTextColor ( TFT_WHITE, TFT_BLACK );
-		tft.drawString ( "NO TIMEZONE DEFINED!", 25, 100 );
-		delay ( 1000 );
-	}
+
+/*
+ *	The contest calendar (see 'ShowCON' and 'Contests.h') is read from 'CONTEST_URL'
+ *	every 'CON_REFRESH' seconds, or 'CON_RETRY_MS' after a failure. It's big, so
+ *	like a firmware update it's read in slices between the seconds, 'CON_CHUNK'
+ *	bytes at a time for no more than 'CON_SLICE_MS'.
+ */
+
+#define CON_REFRESH		21600					// Seconds between readings
+#define CON_RETRY_MS   600000					// Wait after a failure
+#define CON_CHUNK		  512					// Bytes per read
+#define CON_SLICE_MS		40					// Longest slice
+#define CON_TIMEOUT_MS	15000					// Give up if nothing for this long
+
+
+static_assert ( SUN_X + SUN_SIZE + 80 <= SCREEN_W, "The sun picture and its time don't fit" );
 
 
 /*
- *	OK, there is at least one network and at least one timezone defined, 
- *	so let's try to connect to a WiFi network.
+ *	Up to 'POOL_SIZE' connections to different servers are kept open between
+ *	requests (see 'PoolGet'); one is closed after 'POOL_IDLE_MS' without one. On the
+ *	ESP8266 each gets TLS buffers of 'POOL_RX' and 'POOL_TX' bytes if its server
+ *	can work with them, instead of 16K. If there's less than 'POOL_MIN_HEAP' free
+ *	when any TLS connection is about to be made, in the pool or not, the idle ones
+ *	are closed first (see 'PoolMakeRoom').
  */
 
-	while ( true )									// Cycle through the list until
-	{												// we get a good connection
-		WiFi.begin ( ssid_pwd[index].ssid,
-					 ssid_pwd[index].pwd );			// Start next one in the list
-		tft.drawString ( "Connecting to:", 5, 50 );		// Show we are trying
-		tft.fillRect ( 5, 70, 310, 30, TFT_BLACK );		// Erase any previous one
-		tft.drawString ( ssid_pwd[index].ssid, 5, 70 );	// Show which one we're trying
-		
-		for ( count = 0; count < 10; count++ )			// Try each one 10 times
-		{
-			if ( WiFi.status() != WL_CONNECTED )		// While waiting for connection
-			{   
-				tft.drawString ( "    ", 249, 70 );		// Erase previous counter
-				tft.drawNumber ( tries + 1, 275, 70 );	// and display the current count!
-				tries++;								// Increment try counter
-				delay ( 1000 );							// Wait a second
-			}
+#define POOL_SIZE			2					// Connections kept
+#define POOL_KEY		   48					// Longest "host:port" (plus 1)
+#define POOL_IDLE_MS	60000					// Closed after this long unused
+#define POOL_RX			 4096					// TLS buffer sizes (ESP8266)
+#define POOL_TX			  512
 
-			else										// We got a connection!
-			{
-				tft.fillRect ( 5, 70, 310, 30, TFT_BLACK );		// Erase 2nd line
-				tft.drawString ( "Connected to: ", 5, 70 );		// Connected to LAN now
-				tft.drawString ( ssid_pwd[index].ssid, 5, 90 );	// so show network name
-				connected = true;
-			}
-		}
+#if defined ( ESP32 )
+	#define POOL_MIN_HEAP	60000				// mbedTLS takes about 45K
+#elif defined ( ESP8266 )
+	#define POOL_MIN_HEAP	30000				// BearSSL about 22K with full buffers
+#endif
 
-		if ( connected )							// Connected so we can stop trying
-			break;									// Break out of the 'for' loop
 
-		index = ( index + 1 ) % networks;			// Move onto the next network
+/*
+ *	The following 'typedef' is used in building the list of functions that
+ *	will display the different data items in the UTC header block. All the
+ *	display functions have to be of the form 'void fcn ()'. The elements of
+ *	the list are built by looking at settings in the 'UserSettings.h' file
+ *	by the 'BuildDataItemList' function.
+ */
 
-		if ( networks != 1 )						// If more than one in the list
-			tries = 0;								// reset the tries counter
-	}
+typedef void (*function) ();
 
-	tries = 0;										// Now counter for NTP tries
+function dataItems[ITEM_KINDS];			// List of pointers to display functions
+int16_t dataIndex = 0;					// Index into 'dataItems' array
+
+TFT_eSPI tft = TFT_eSPI();				// Create the display object
+TFT_eSprite screen = TFT_eSprite ( &tft );	// 16 color copy of the screen (ESP32)
+TFT_eSPI* gfx = &tft;					// Where the drawing goes (screen or sprite)
+bool paletteMode = false;				// True if drawing into the sprite
+TFT_eSprite face = TFT_eSprite ( &tft );	// Analog face background and tick marks
+TFT_eSprite hands = TFT_eSprite ( &tft );	// Analog face with the hands drawn on it
+bool faceReady = false;					// Face sprite is drawn in the current colors
+uint32_t facePixels[2] = { 0, 0 };		// Pixels sent for the UTC and local time
+uint32_t pushedPixels = 0;				// All the pixels sent from sprites
+uint32_t faceUpdates[2] = { 0, 0 };		// Number of times each was updated
+Timezone local;							// Local timezone variable
+Timezone home;							// First timezone in the list (for schedules)
 
-	tft.drawString ( "Waiting for NTP", 5, 130 );	// Now get NTP info
+uint8_t tzIndex = 0;					// Index to local timezone to display
 
-	while ( timeStatus() != timeSet )				// Wait until time retrieved
-	{              
-		events();									// Allow ezTime to work
-		tft.drawString ( "    ", 229, 100 );		// Erase previous counter
-		tft.drawNumber ( tries + 1, 230, 130 );		// Show we are trying
-		tries++;									// Increment try counter
-		delay ( 1000 );								// Wait a second
-	}
+time_t t,  oldT;						// Current & displayed UTC time
+time_t lt, oldLt;						// Current & displayed local time
 
-	tft.drawString ( "NTP Time Received", 5, 150 );	// Show we got the time
-	delay ( 2000 );									// Time to read the screen
-	tft.setFreeFont  ( NULL );						// Reset to default font
-}
+bool useLocalTime = false;				// Temp flag used for display updates
+
+bool solarPending = true;				// No solar data yet or a retry is due
+bool fetchNow = false;					// Asked for a fetch (see 'CmdFetch')
 
 
 /*
- *	'NewDualScreen' paints all the fixed stuff on the display; time heading
- *	blocks, time labels, 'TITLE', etc.
+ *	The LAN synchronization ('LanSync.h') keeps everything it knows about the other
+ *	clocks in 'lan'.
  */
 
-void NewDualScreen ()										// Displays the fixed parts
-{
-	tft.fillScreen ( TFT_BLACK );							// Start with empty screen
-	tft.fillRoundRect ( 0, 0, 319, 33, 10, LABEL_BGCOLOR );	// Title bar for local time
-	tft.fillRoundRect (0, 126, 319, 34, 10, LABEL_BGCOLOR );// Title bar for UTC
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );		// Set label colors
-	tft.drawCentreString ( TITLE, 160, 6, 4 );				// Show title at top
-	tft.drawRoundRect ( 0, 0, 319, 110, 10, TFT_WHITE );	// Draw edge around local time
-	tft.drawRoundRect ( 0, 126, 319, 110, 10, TFT_WHITE );	// Draw edge around UTC
-}															// End of NewDualScreen
+WiFiUDP		lanUdp;						// Socket for talking to the other clocks
+lanSync		lan = {};					// Leader, offset to it and skew
+
+int16_t		wifiIndex = 0;				// Which 'ssid_pwd' entry we're connected to
+wifiRoam	roam = {};					// Signal strength and sweep ('Roam.h')
 
 
 /*
- * 	Display functions. The following functions update various fields on the
- * 	clock (except the solar data related ones which are in a separate section).
- *
- *	'UpdateDisplay' gets called once a second from the main loop and calls
- *	all the other funtions that update everything on the display.
+ *	The network health monitor keeps its statistics in 'NH_WINDOWS' windows of
+ *	'NH_WINDOW_MS' each. Each window has a latency histogram for each target plus
+ *	counts of the things we want to correlate the latency and loss with.
  */
 
-void UpdateDisplay ()
+struct nhWindow
 {
-	lt = local.now ();								// Get local time
-	useLocalTime = true;							// Use local timezone
-	ShowTimeDate ( lt, oldLt,
-				LOCAL_FORMAT_12HR, 10, 46 );		// Show new local time
+	uint16_t	hist[2][NH_BUCKETS];	// Latency histograms for gateway and DNS
+	uint16_t	sent[2];				// Probes sent to each
+	uint16_t	lost[2];				// and how many weren't answered
+	uint8_t		fetchOk;				// Successful solar data fetches
+	uint8_t		fetchFail;				// Failed ones
+	uint8_t		ntpLate;				// Minutes with an overdue NTP update
+};
+
+const uint16_t nhEdges[NH_BUCKETS - 1] = { 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+
+WiFiUDP		nhUdp;						// Socket for the probes
+nhWindow	nhWindows[NH_WINDOWS];		// Sliding windows of statistics
+uint8_t		nhCurrent = 0;				// Index of the current window
+bool		nhGatewayDns = true;		// False if the gateway doesn't answer DNS
+
+int16_t		pollMin = 2;				// Solar data is polled at 'pollMin' past
+int16_t		pollSec = 0;				// (and 30 past) the hour at 'pollSec'
+
+bool		radioAsleep = false;		// Radio is in modem sleep
+uint32_t	radioSince  = 0;			// 'millis ()' when it entered that state
+uint32_t	radioHold   = 0;			// Keep it awake until this 'millis ()'
+uint64_t	radioMs[2]  = { 0, 0 };		// Time spent awake and asleep
+
+uint8_t		cpuBoosts = 0;				// Nesting count of 'CpuBoost' calls
+uint32_t	cpuSince  = 0;				// 'millis ()' when the speed last changed
+uint64_t	cpuMs[2]  = { 0, 0 };		// Time spent at idle and busy speeds
+
+uint32_t	fetchCount = 0;				// Number of solar data fetches
+uint32_t	fetchTotalMs = 0;			// Total time they took
+uint32_t	fetchMaxMs = 0;				// and the longest one
+uint32_t	fetchFailed = 0;			// Fetches that didn't get usable data
+uint32_t	failSince = 0;				// 'millis ()' when they started failing
+uint32_t	recoveryMs = 0;				// Longest time from a failure to a good fetch
+uint32_t	stallCount = 0;				// Seconds that were shown late
+uint32_t	stallMaxMs = 0;				// Longest time between seconds
+uint32_t	lastGapMs = 0;				// and the last one
+
+/*
+ *	'config' holds the settings that can be changed without rebuilding the program;
+ *	'cfg' is the ones in use. 'configCache' is how they're kept in 'CACHE_FILE'.
+ */
+
+struct config
+{
+	uint8_t		networks;					// Number of WiFi networks
+	uint8_t		zones;						// Number of timezones
+	uint8_t		items;						// Number of solar data items shown
+	uint8_t		item[ITEM_KINDS];			// Which ones, in order
+	int16_t		tzInterval;					// Seconds each timezone is shown
+	int16_t		cycleTime;					// Seconds each solar data item is shown
+	int16_t		mediumK, highK;				// Color breakpoints
+	int16_t		mediumA, highA;
+	int16_t		mediumSfi, highSfi;
+	char		ssid[CONFIG_NETWORKS][SSID_SIZE];
+	char		pwd[CONFIG_NETWORKS][PWD_SIZE];
+	char		zone[CONFIG_ZONES][ZONE_SIZE];
+	char		otaUrl[OTA_URL_SIZE];		// Where to look for new firmware
+};
+
+struct configCache
+{
+	uint32_t	version;					// 'CONFIG_VERSION' and the size
+	uint32_t	textCrc;					// CRC of the 'CONFIG_FILE' it came from
+	uint32_t	defaultsCrc;				// and of the built-in settings under it
+	config		data;
+	uint32_t	crc;						// CRC of all the above
+};
+
+config		cfg;							// Settings in use
+bool		fsReady = false;				// File system is there
+
+const char* const itemNames[ITEM_KINDS] =	// Names of the solar data items
+	{ "sfi", "gmf", "s2n", "aur", "ssn", "sun", "con" };
+
+#if defined ( ESP32 )
+	WebServer		configServer ( 80 );	// For reading and changing the settings
+#elif defined ( ESP8266 )
+	ESP8266WebServer configServer ( 80 );
+#endif
+
+config*		webConfig = nullptr;			// Settings from the web not applied yet
+uint32_t	webConfigTime;					// When we said we'd take them
+
+struct mark									// A point in the startup
+{
+	const char*	name;						// What got done
+	uint32_t	us;							// 'micros ()' when it was
+};
+
+mark		marks[MARKS];					// The ones we've passed
+uint8_t		markCount = 0;					// How many of them
+uint8_t		markShown = 0;					// and how many were printed
+bool		serialUp  = false;				// Printing works now
+
+/*
+ *	'event' is one entry in the event log and 'eventPage' is a page of them (see
+ *	'EventLog').
+ */
+
+struct event
+{
+	uint32_t	time;					// UTC, or see 'EV_UPTIME'
+	uint8_t		type;					// 'EV_' number
+	uint8_t		flags;
+	int16_t		a;						// What these mean depends
+	int32_t		b;						// on the type (see 'EV_')
+	int32_t		c;
+};
+
+#define EVENTS_PER_PAGE		(( EVENT_PAGE - 16 ) / sizeof ( event ))
+
+struct eventPage
+{
+	uint32_t	seq;					// 0 if never used
+	uint32_t	crc;					// Of the rest of the page
+	uint8_t		count;					// Events in it
+	uint8_t		spare[7];
+	event		events[EVENTS_PER_PAGE];
+};
+
+static_assert ( sizeof ( event ) == 16, "'event' has padding" );
+static_assert ( sizeof ( eventPage ) == EVENT_PAGE, "'eventPage' must fill a page" );
+
+eventPage	evPage = {};				// Page being filled
+uint32_t	evSeq[EVENT_PAGES] = {};	// Sequence number in each slot
+uint8_t		evSlot = 0;					// Slot 'evPage' goes in
+bool		evDirty = false;			// Has events not written yet
+uint32_t	evFlushed = 0;				// When we last wrote
+
+#if defined ( ESP32 )					// 'esp_reset_reason' numbers
+	const char* const resetNames[] = { "unknown", "power on", "reset pin", "software",
+				"crash", "interrupt watchdog", "task watchdog", "watchdog", "deep sleep",
+				"brownout", "SDIO" };
+#elif defined ( ESP8266 )				// 'rst_info' reasons
+	const char* const resetNames[] = { "power on", "hardware watchdog", "crash",
+				"software watchdog", "software", "deep sleep", "reset pin" };
+#endif
+
+const char* const restartNames[] = { "", "lost the WiFi", "new firmware", "firmware rollback",
+									"stuck" };
+
+
+/*
+ *	The loop watchdog (see 'Phase'). 'watchStall' is one stall, and 'watchRescue' is
+ *	what's kept in the RTC memory (which survives a restart) when we restart
+ *	because we're stuck: the stall and the event log page that hadn't been written.
+ *	'OtaRollback' uses it too, with just the 'magic' set to 'ROLLBACK_MAGIC'.
+ */
+
+struct watchStall
+{
+	uint32_t	ms;						// How long
+	uint8_t		phase;					// 'PH_' phase
+	uint16_t	line;					// Last checkpoint passed
+	uint16_t	last;					// and the one before
+};
+
+struct watchRescue
+{
+	uint32_t	magic;					// 'WATCH_MAGIC' if there's one
+	watchStall	stall;
+	eventPage	page;
+};
+
+volatile uint32_t	phaseStart = 0;		// 'millis ()' at the last checkpoint
+volatile uint8_t	phaseId = PH_LOOP;	// Phase it started
+volatile uint16_t	phaseLine = 0;		// Line it was on
+volatile uint16_t	phaseLast = 0;		// and the checkpoint before that
+
+uint16_t	watchHist[PHASES][WATCH_BUCKETS] = {};	// Stalls by phase and length
+watchStall	watchRecent[WATCH_KEEP] = {};			// The last few
+uint8_t		watchNext = 0;							// Where the next one goes
+
+const char* const phaseNames[PHASES] = { "loop", "events", "render", "fetch", "parse", "status" };
+
+Ticker		watchTimer;						// For seeing we're stuck
+
+#if defined ( ESP32 )							// The ESP8266 has 'rtcUserMemoryRead'
+	RTC_NOINIT_ATTR watchRescue rescue;			// and 'rtcUserMemoryWrite' instead
+#endif
+
+
+/*
+ *	'sunCache' starts 'SUN_FILE'; the rows of the picture follow it, packed (see
+ *	'SunPack'). 'sunJob' is what the JPEG decoder's input and output functions
+ *	need while a new picture is coming in.
+ */
+
+struct sunCache
+{
+	uint32_t	magic;					// 'SUN_MAGIC'
+	uint32_t	time;					// When it was fetched (UTC)
+	uint16_t	w, h;					// Size in pixels
+};
+
+struct sunJob
+{
+	Stream*		stream;					// The JPEG coming in
+	File		file;					// and the packed rows going out
+	uint16_t*	rows;					// One row of blocks
+	uint16_t	w, h;					// Size after scaling
+	uint16_t	x, y;					// Offset to center it
+	uint16_t	rowTop;					// Picture row at the top of 'rows'
+	uint16_t	rowsH;					// and how many rows it holds
+	uint32_t	bytes;					// JPEG bytes read
+	uint32_t	packed;					// and packed bytes written
+};
+
+bool		sunShowing = false;			// The sun picture is on the screen
+bool		sunWanted = false;			// A new one is needed
+time_t		sunFetched = 0;				// When the one we have was fetched
+uint32_t	sunFailed = 0;				// 'millis ()' when the last try failed
+
+contest		conList[CON_MAX];			// Coming contests, soonest first
+uint8_t		conCount = 0;				// How many
+bool		conWanted = false;			// A new list is needed
+time_t		conFetched = 0;				// When the calendar was last read
+uint32_t	conFailed = 0;				// 'millis ()' when the last try failed
+
+
+/*
+ *	'poolConn' is one connection in the pool. They're set aside once at startup,
+ *	like the arena; the TLS buffers the secure clients allocate are freed when a
+ *	connection is closed. 'trustSetup' is what sets up the certificate for a server.
+ */
+
+struct poolConn
+{
+	char				key[POOL_KEY];		// "host:port" it's for ("" if none)
+	WiFiClientSecure	client;
+	HTTPClient			http;
+
+	#if defined ( ESP8266 )
+		BearSSL::Session	session;		// For a shorter handshake next time
+	#endif
+
+	bool				busy;				// A request is using it
+	uint32_t			lastUsed;			// 'millis ()' at the end of the last request
+	uint32_t			requests;			// Requests made on it
+	uint32_t			connects;			// and the ones that needed a new connection
+	uint32_t			failures;			// or failed
+};
+
+typedef void (*trustSetup) ( WiFiClientSecure& client );
+
+poolConn	pool[POOL_SIZE];				// Connections kept open
+uint32_t	poolReused = 0;					// Requests on an open connection
+uint32_t	poolReusedMs = 0;				// and the time they took
+uint32_t	poolNew = 0;					// Requests that had to connect first
+uint32_t	poolNewMs = 0;
+uint32_t	poolHeapLow = 0;				// Least heap free after a request
+
+alignas ( 8 ) uint8_t arena[ARENA_SIZE];	// Memory for one fetch and parse
+size_t		arenaUsed = 0;				// How much of it is in use
+size_t		arenaPeak = 0;				// Most ever used
+uint8_t		fragFirst = 0;				// Heap fragmentation after the first fetch
+uint8_t		fragWorst = 0;				// and the worst seen since
+uint32_t	heapLowest = 0;				// Lowest free heap after a fetch
+
+time_t		sunrise[3] = {};			// Sunrise and sunset (UTC) for the UTC days
+time_t		sunset[3]  = {};			// before, of and after 'Daylight' was last
+										// asked about; if equal, no sunrise that day
+
+uint8_t		blLevel = 255;				// Current backlight PWM duty
+uint8_t		blTarget = 255;				// and where it's headed
+uint64_t	blDutyMs = 0;				// Sum of duty times milliseconds
+uint64_t	blTotalMs = 0;				// Time accounted for
+
+
+/*
+ *	The day and night color palettes:
+ */
+
+const uint16_t dayPalette[16] =
+{
+	TFT_BLACK, TIMECOLOR, DATECOLOR, LABEL_FGCOLOR, LABEL_BGCOLOR, TFT_WHITE,
+	COLOR_NORMAL, COLOR_MEDIUM, COLOR_HIGH,
+	TFT_GREEN, TFT_ORANGE, TFT_RED, TFT_BLACK
+};
+
+const uint16_t nightPalette[16] =
+{
+	TFT_BLACK, NIGHT_TIMECOLOR, NIGHT_DATECOLOR, NIGHT_LABEL_FG, NIGHT_LABEL_BG, NIGHT_EDGE,
+	TFT_DARKGREEN, 0x8400, TFT_RED,						// Dimmed normal, medium, high
+	TFT_DARKGREEN, 0x8200, TFT_MAROON, TFT_BLACK		// Dimmed status colors
+};
+
+const uint16_t* palette = dayPalette;	// Palette in use
+
+
+/*
+ *	Month names for 'ShowDate'; kept in flash memory
+ */
+
+const char months[12][4] PROGMEM =
+{
+	"JAN", "FEB", "MAR", "APR", "MAY", "JUN",		// Should be obvious!
+	"JUL", "AUG", "SEP", "OCT", "NOV", "DEC"
+};
+
+
+/*
+ *	A quarter of a sine wave, one entry per degree, scaled by 16384 (see 'Sin14')
+ */
+
+const int16_t sinTable[91] PROGMEM =
+{
+	    0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,
+	 2845,  3126,  3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,
+	 5604,  5872,  6138,  6402,  6664,  6924,  7182,  7438,  7692,  7943,
+	 8192,  8438,  8682,  8923,  9162,  9397,  9630,  9860, 10087, 10311,
+	10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+	12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+	14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+	15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+	16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+	16384
+};
+
+
+/*
+ *	'faceBox' is a rectangle on the analog face sprites; corners are inclusive.
+ *	An empty box has 'x0' > 'x1'.
+ */
+
+struct faceBox
+{
+	int16_t		x0, y0;					// Top left corner
+	int16_t		x1, y1;					// Bottom right corner
+};
+
+
+/*
+ *	The solar data values that get displayed (see 'SolarXml.h'); anything that
+ *	wasn't in the XML data is "??".
+ */
+
+const solarSnapshot noSolar = { "??", "??", "??", "??", "??", "??", "??", "??" };
+solarSnapshot solar = noSolar;			// What's on the display
+
+
+/*
+ *	The times that get displayed, broken down into their date and time fields once
+ *	a second (see 'Breakdown' in 'Calendar.h').
+ */
+
+calendar utcCal   = {};					// UTC now
+calendar localCal = {};					// Local time now
+calendar homeCal  = {};					// Time in the first timezone (for schedules)
+
+
+/*
+ *	The 'setup' function builds the list of solar data items to be displayed,
+ *	initializes the display, serial monitor and a few other things.
+ */
+
+void setup ()
+{
+	tft.init ();							// Initialize TFT screen object
+	tft.setRotation ( SCREEN_ORIENTATION );	// Landscape screen orientation
+	BacklightBegin ();						// Take over the backlight
+
+	ShowSplash ();							// Shows the credits
+	Mark ( "screen on" );
+	delay ( 5000 );							// Time to read it (5 seconds)
+	StartupScreen ();						// Mostly blank for connection statuses
+
+	Serial.begin ( BAUDRATE );				// Start the serial port
+	delay ( 1000 );							// Allow time to initialize
+	serialUp = true;
+	MarkReport ();							// Times we missed printing
+
+	ConfigBegin ();							// Get the settings
+	EventBegin ();							// and the event log
+	OtaBegin ();							// New firmware on trial?
+
+	setDebug ( DEBUGLEVEL );				// Enable NTP debug level
+	setServer ( TESTING ? TEST_HOST : NTP_SERVER );	// Set NTP server URL
+	setInterval ( NTP_INTERVAL );			// and how often to ask it
+
+	if ( BENCHMARK )						// Time things if asked to (before
+	{										// the WiFi, so it runs under QEMU too)
+		ScreenSpriteBegin ();
+		Benchmark ();
+	}
+
+	ShowConnectionProgress ();				// Connect to the WiFi and NTP server
+
+	configTime ( 0, 0, TESTING ? TEST_HOST : NTP_SERVER );	// Needed for https - why? (also timezone doesn't matter here)
+
+	ClockSyncBegin ();						// Start talking to other clocks
+	nhUdp.begin ( NH_PORT );				// Socket for network health probes
+	ConfigServerBegin ();					// Settings can be changed from now on
+
+	ScreenSpriteBegin ();					// Draw into a sprite if we can
+	NewDualScreen ();						// Show title & labels
+
+	cpuSince = millis ();					// Start the processor speed governor
+	SetCpuSpeed ( false );					// at idle speed
+
+	Serial.printf_P ( PSTR ( "Free heap after startup: %u\n" ), ESP.getFreeHeap ());
+	Mark ( "setup done" );
+	WatchBegin ();							// Loop watchdog starts now
+}											// End of 'setup'
+
+
+/*
+ *	The 'loop' function runs forever. It gets periodic time updates from the
+ *	NTP time server and whenever the time changes, it updates the display.
+ *
+ *	Modified in Version 3.1 to allow a repeating sequence of local timezones to
+ *	be displayed. 
+ */
+
+void loop ()
+{
+	uint32_t	us = micros ();
+
+	PHASE ( PH_EVENTS );					// Loop watchdog checkpoint
+	events ();								// Get periodic NTP updates
+	PHASE ( PH_LOOP );
+	NtpEvent ( micros () - us );			// and log them
+	EventPoll ();							// Write the event log
+	TestFlap ();							// Drop the WiFi if testing
+	ConfigPoll ();							// Any new settings?
+	Console ();								// or commands?
+	NtpPoll ();								// "ntp" typed?
+	OtaPoll ();								// or firmware?
+	SunPoll ();								// or a picture of the sun?
+	ConPoll ();								// or the contests?
+	PoolTidy ();							// Close idle connections
+	ClockSync ();							// Keep in step with other clocks
+	WiFiRoam ();							// Look for a stronger access point
+	NetHealth ();							// Probe the gateway and DNS server
+	RadioPower ();							// Let the radio sleep if it can
+	Backlight ();							// Adjust the backlight
+	HourlyReport ();						// Hourly power usage report
+
+	t = SyncedNow ();						// Get latest UTC time
+
+	if ( t != oldT )						// Did it change (new second)?
+	{
+		PHASE ( PH_RENDER );
+		StallCheck ();										// See if we're late
+		Breakdown ( t, utcCal );							// Once for everybody
+
+		if (( utcCal.second % cfg.tzInterval ) == 0 )		// Time for next timezone?
+		{
+			tzIndex++;										// Point to the next one
+			if ( tzIndex >= tzCount )						// But not beyond the
+				tzIndex = 0;								// end of the list
+			local.setPosix ( TimeZoneRule ( tzIndex ));		// Set new local time zone by rule
+		}
+
+		CpuBoost ();						// Full speed for the repaint
+		NightMode ();						// Switch colors at dusk and dawn
+		UpdateDisplay ();					// Update clock every second
+		ShowNextData ();					// Show selected solar data
+		CpuRelax ();						// Back to idle speed
+		Mark ( "first paint" );				// Only counts once
+		OtaConfirm ();						// New firmware works
+		oldT = t;							// Displayed time is current time
+	}
+}
+
+
+/*
+ *	Setup Functions; the following functions are primarily used in the clock
+ *	start up, although a couple of them are also used during normal operation.
+ *
+ *	'BuildDataItemList' looks at the 'SHOW_xxx' definitions in the 'UserSettings.h'
+ *	file and for those that are non-zero, adds pointers to the functions to display
+ *	them in the proper slots in the 'dataItems' array.
+ *
+ *	Instructions for selecting which items to display are in the 'UserSettings.h'
+ *	file. It's kind of brute force, but it works!
+ */
+
+void BuildDataItemList ()
+{
+	const function shows[ITEM_KINDS] =			// In 'itemNames' order
+		{ &ShowSFI, &ShowGMF, &ShowS2N, &ShowAUR, &ShowSSN, &ShowSUN, &ShowCON };
+
+	for ( uint8_t i = 0; i < cfg.items; i++ )	// The ones in 'cfg' (from the
+		dataItems[i] = shows[cfg.item[i]];		// 'SHOW_xxx' settings or the file)
+
+	dataIndex = 0;								// Start at the top of the list
+}
+
+
+/*
+ *	Constant strings and tables are kept in flash memory (added in Version 3.2).
+ *	On the ESP32 that's automatic for anything 'const', but on the ESP8266 they
+ *	get copied to RAM at startup unless they're marked 'PROGMEM' (or 'PSTR' and
+ *	'F' for strings in the code), and then they can't be used directly.
+ *
+ *	'FlashText' gets such a string ready to hand to something that wants a normal
+ *	string. On the ESP8266 it's copied into one of two RAM buffers, used in turn,
+ *	so the result is only good until the call after next (see 'FLASH_TEXT'). On
+ *	the ESP32 there's nothing to do.
+ *
+ *	The 'printf' format strings go in flash with 'PSTR' and 'printf_P', which the
+ *	ESP8266's 'Print' has; on the ESP32 'printf_P' is just 'printf'.
+ */
+
+const char* FlashText ( PGM_P text )
+{
+	#if defined ( ESP8266 )
+
+static	char	buf[2][FLASH_TEXT];					// Where the copies go
+static	uint8_t	next = 0;							// Which one to use
+
+		next ^= 1;
+		strncpy_P ( buf[next], text, FLASH_TEXT - 1 );
+		buf[next][FLASH_TEXT - 1] = 0;
+
+		return buf[next];
+
+	#else
+
+		return text;
+
+	#endif
+}
+
+
+/*
+ *	'TimeZoneRule' gets one of the timezones from the settings.
+ */
+
+String TimeZoneRule ( uint8_t index )
+{
+	return String ( cfg.zone[index] );
+}
+
+
+/*
+ *	'ShowSplash' displays the program title and the author cedits. 
+ */
+
+void ShowSplash ( void )
+{
+	tft.fillScreen ( TFT_BLACK );						// Start with empty screen
+	
+	tft.setTextDatum ( TC_DATUM );						// Top center text position datum
+
+	tft.setFreeFont  ( &FreeSerifBoldItalic18pt7b );	// Title font
+	tft.setTextColor ( TFT_MAGENTA );					// and color
+	tft.drawString	 ( FlashText ( PSTR ( "W8BH NTP Clock" )), SCREEN_W / 2, 20 );	// Paint the title
+
+	tft.setFreeFont  ( &FreeSansBold9pt7b );			// Font for the credits
+	
+	tft.drawString	 ( FlashText ( PSTR ( "Version 3.2" )), SCREEN_W / 2, 60);	// Show the version
+	
+	tft.setTextDatum ( TL_DATUM );						// Back to default top left
+	tft.setTextColor ( TFT_WHITE );						// Back to white
+
+	tft.drawString ( FlashText ( PSTR ( "Originally by: W8BH" )), 30, 100 );	// Display
+	tft.drawString ( FlashText ( PSTR ( "Modified by: WA2FZW & AI6P" )), 30, 130 );	// the credits
+	tft.drawString ( FlashText ( PSTR ( "Solar data from: N0NBH" )), 30, 160 );
+
+	tft.setFreeFont  ( NULL );							// Select default font
+}
+
+
+/*
+ *	'StartupScreen' paints a mostly empty screen with just the 'TITLE' at the
+ *	top. The blank area will be filled with the WiFi connection status and NTP
+ *	connection status.
+ */
+
+void StartupScreen()
+{
+	tft.fillScreen ( TFT_BLACK );							// Start with empty screen
+	tft.fillRoundRect ( 0, 0, SCREEN_W - 1, BAR_H - 1, 10, LABEL_BGCOLOR );	// Title block
+	tft.drawRoundRect ( 0, 0, SCREEN_W - 1, SCREEN_H - 1, 10, TFT_WHITE );	// Draw screen edge
+	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );		// Set label colors
+	tft.drawCentreString ( FlashText ( PSTR ( TITLE )), SCREEN_W / 2, LY ( 6 ), 4 );	// Show the 'TITLE'
+	tft.setTextColor ( LABEL_FGCOLOR, TFT_BLACK );			// Set text color
+}	
+
+
+/*
+ *	'ShowConnectionProgress' was completely overhauled in Version 3.0. We now
+ *	allow the user to define a list of WiFi networks that will be tried in order
+ *	until a connection is established.
+ *
+ *	We try each one 10 times and if we don't get a connection, we move onto the
+ *	next one. If we don't get a connection on any of them, we start over with 
+ *	the first one. Instructions on how to define the networks can be found in
+ *	the 'UserSettings.h' file.
+ */
+
+void ShowConnectionProgress() 
+{
+	int16_t tries = 0;								// How many connection tries
+	int16_t index = 0;								// Index to list of networks
+	int16_t count = 0;								// Loop counter
+
+	int16_t networks = cfg.networks;				// Number of  networks in the list
+
+	bool connected = false;							// Turns true when we connect
+
+	StartupScreen ();
+
+	tft.setFreeFont  ( &FreeSansBold9pt7b );		// Easier to read than the default
+
+
+/*
+ *	First, we need to make sure there is at least one WiFi network in the list.
+ *	If not we flash an error message on the screen forever!
+ */
+
+	while ( networks == 0 )							// No networks in the list!
+	{
+		tft.setTextColor ( TFT_RED, TFT_BLACK );
+		tft.drawString ( FlashText ( PSTR ( "NO WIFI NETWORKS DEFINED!" )), 25, 100 );
+		delay ( 1000 );
+
+		tft.setTextColor ( TFT_WHITE, TFT_BLACK );
+		tft.drawString ( FlashText ( PSTR ( "NO WIFI NETWORKS DEFINED!" )), 25, 100 );
+		delay ( 1000 );
+	}
+
+/*
+ *	Modified in Version 3.1:
+ *
+ *	Next, make sure at least one time zone is defined.
+ *	If not we flash an error message on the screen forever!
+ */
+
+	while ( tzCount == 0 )							// No timezones in the list!
+	{
+		tft.setTextColor ( TFT_RED, TFT_BLACK );
+		tft.drawString ( FlashText ( PSTR ( "NO TIMEZONE DEFINED!" )), 25, 100 );
+		delay ( 1000 );
+
+		tft.setTextColor ( TFT_WHITE, TFT_BLACK );
+		tft.drawString ( FlashText ( PSTR ( "NO TIMEZONE DEFINED!" )), 25, 100 );
+		delay ( 1000 );
+	}
+
+
+/*
+ *	OK, there is at least one network and at least one timezone defined, 
+ *	so let's try to connect to a WiFi network.
+ */
+
+	while ( true )									// Cycle through the list until
+	{												// we get a good connection
+		WiFi.begin ( cfg.ssid[index],
+					 cfg.pwd[index] );				// Start next one in the list
+		SetListenInterval ();
+		tft.drawString ( FlashText ( PSTR ( "Connecting to:" )), 5, 50 );	// Show we are trying
+		tft.fillRect ( 5, 70, SCREEN_W - 10, 30, TFT_BLACK );	// Erase any previous one
+		tft.drawString ( cfg.ssid[index], 5, 70 );		// Show which one we're trying
+		
+		for ( count = 0; count < 10; count++ )			// Try each one 10 times
+		{
+			if ( WiFi.status() != WL_CONNECTED )		// While waiting for connection
+			{   
+				tft.drawString ( "    ", 249, 70 );		// Erase previous counter
+				tft.drawNumber ( tries + 1, 275, 70 );	// and display the current count!
+				tries++;								// Increment try counter
+				delay ( 1000 );							// Wait a second
+			}
+
+			else										// We got a connection!
+			{
+				tft.fillRect ( 5, 70, SCREEN_W - 10, 30, TFT_BLACK );	// Erase 2nd line
+				tft.drawString ( FlashText ( PSTR ( "Connected to: " )), 5, 70 );	// Connected to LAN now
+				tft.drawString ( cfg.ssid[index], 5, 90 );		// so show network name
+				wifiIndex = index;								// Remember which one
+				connected = true;
+				Mark ( "WiFi connected" );
+			}
+		}
+
+		if ( connected )							// Connected so we can stop trying
+			break;									// Break out of the 'for' loop
+
+		index = ( index + 1 ) % networks;			// Move onto the next network
+
+		if ( networks != 1 )						// If more than one in the list
+			tries = 0;								// reset the tries counter
+	}
+
+	tries = 0;										// Now counter for NTP tries
+
+	tft.drawString ( FlashText ( PSTR ( "Waiting for NTP" )), 5, 130 );	// Now get NTP info
+
+	while ( timeStatus() != timeSet )				// Wait until time retrieved
+	{              
+		events();									// Allow ezTime to work
+		tft.drawString ( "    ", 229, 100 );		// Erase previous counter
+		tft.drawNumber ( tries + 1, 230, 130 );		// Show we are trying
+		tries++;									// Increment try counter
+		delay ( 1000 );								// Wait a second
+	}
+
+	tft.drawString ( FlashText ( PSTR ( "NTP Time Received" )), 5, 150 );	// Show we got the time
+	Mark ( "NTP time" );
+	delay ( 2000 );									// Time to read the screen
+	tft.setFreeFont  ( NULL );						// Reset to default font
+}
+
+
+/*
+ *	'NewDualScreen' paints all the fixed stuff on the display; time heading
+ *	blocks, time labels, 'TITLE', etc.
+ */
+
+void NewDualScreen ()										// Displays the fixed parts
+{
+	CpuBoost ();											// Full speed for the repaint
+	gfx->fillScreen ( Ink ( PAL_BG ));						// Start with empty screen
+	gfx->fillRoundRect ( 0, 0, SCREEN_W - 1, BAR_H, 10, Ink ( PAL_LABEL_BG ));	// Title bar for local time
+	gfx->fillRoundRect (0, UTC_TOP, SCREEN_W - 1, LY ( 34 ), 10, Ink ( PAL_LABEL_BG ));	// Title bar for UTC
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Set label colors
+	gfx->drawCentreString ( FlashText ( PSTR ( TITLE )), SCREEN_W / 2, LY ( 6 ), 4 );	// Show title at top
+	gfx->drawRoundRect ( 0, 0, SCREEN_W - 1, BOX_H, 10, Ink ( PAL_EDGE ));	// Draw edge around local time
+	gfx->drawRoundRect ( 0, UTC_TOP, SCREEN_W - 1, BOX_H, 10, Ink ( PAL_EDGE ));	// Draw edge around UTC
+	PushRegion ( 0, 0, tft.width (), tft.height ());		// Send it all to the screen
+	faceReady = false;										// Analog face needs redrawing
+	CpuRelax ();
+}															// End of NewDualScreen
+
+
+/*
+ *	Palette and night mode functions; added in Version 3.2.
+ *
+ *	All the colors used on the main screen come from a 16 entry palette. On the
+ *	ESP32, which has plenty of memory, the whole screen is drawn into a 4 bit per
+ *	pixel sprite (38K) and each function that draws something sends just the area
+ *	it changed to the display with 'PushRegion'. Switching between the day and
+ *	night colors is then just a matter of giving the sprite the other palette and
+ *	pushing the whole thing once; nothing has to be redrawn.
+ *
+ *	The ESP8266 doesn't have the memory to spare, so there the drawing goes straight
+ *	to the display in the palette colors and switching means repainting everything.
+ *
+ *	'Ink' returns what the drawing functions should use as a color: the palette
+ *	index when drawing into the sprite, or the actual color otherwise.
+ */
+
+void ScreenSpriteBegin ()
+{
+	#if defined ( ESP32 )
+
+		if ( paletteMode )					// Already done for the benchmark
+			return;
+
+		screen.setColorDepth ( 4 );
+		if ( screen.createSprite ( tft.width (), tft.height ()))
+		{
+			screen.createPalette ( palette, 16 );
+			gfx = &screen;
+			paletteMode = true;
+		}
+
+	#endif
+}
+
+
+uint16_t Ink ( uint8_t index )
+{
+	return paletteMode ? index : palette[index];
+}
+
+
+/*
+ *	'PushRegion' copies a rectangle of the sprite to the same place on the display
+ *	with the sprite's own clipped push (as 'ShowAnalogTime' does with its hands),
+ *	which opens one window for it and looks up the palette on the way.
+ */
+
+void PushRegion ( int16_t x, int16_t y, int16_t w, int16_t h )
+{
+	if ( !paletteMode )									// Already on the screen
+		return;
+
+	screen.pushSprite ( x, y, x, y, w, h );
+	pushedPixels += w * h;
+}
+
+
+/*
+ *	'SetTheme' switches to the day or night palette. With the sprite that's one
+ *	push of the whole screen; without it, we repaint the fixed parts and make
+ *	'ShowTimeDate' redraw everything on the next update.
+ */
+
+void SetTheme ( bool night )
+{
+	palette = night ? nightPalette : dayPalette;
+
+	if ( paletteMode )
+	{
+		screen.createPalette ( palette, 16 );
+		PushRegion ( 0, 0, tft.width (), tft.height ());
+		faceReady = false;								// Not in the sprite
+	}
+
+	else
+	{
+		NewDualScreen ();
+		oldT = oldLt = 0;
+	}
+}
+
+
+/*
+ *	'NightMode' gets called once a second and switches to the night colors once
+ *	the sun is halfway through setting and back once it's halfway up.
+ */
+
+void NightMode ()
+{
+static	bool	night = false;							// Currently using night colors
+
+	if ( !NIGHT_MODE )
+		return;
+
+	if (( Daylight ( t ) < 50 ) != night )
+	{
+		night = !night;
+		SetTheme ( night );
+	}
+}
+
+
+/*
+ * 	Display functions. The following functions update various fields on the
+ * 	clock (except the solar data related ones which are in a separate section).
+ *
+ *	'UpdateDisplay' gets called once a second from the main loop and calls
+ *	all the other funtions that update everything on the display.
+ */
+
+void UpdateDisplay ()
+{
+	lt = local.tzTime ( t, UTC_TIME );				// Get local time
+	Breakdown ( lt, localCal );						// and its date and time
+
+	useLocalTime = true;							// Use local timezone
+	ShowTimeDate ( localCal, oldLt,
+				LOCAL_FORMAT_12HR, TIME_X, LOCAL_Y );	// Show new local time
 
 	useLocalTime = false;							// Now use UTC
-	ShowTimeDate ( t, oldT,
-				UTC_FORMAT_12HR, 10, 172 );			// Show new UTC time
+	ShowTimeDate ( utcCal, oldT,
+				UTC_FORMAT_12HR, TIME_X, UTC_Y );	// Show new UTC time
+
+	PHASE ( PH_STATUS );
+	ShowClockStatus();								// And clock status
+	PHASE ( PH_RENDER );
+	oldLt = lt;										// and current local time
+
+
+/*
+ *	Get solar data first time or every hour at a random time shortly after
+ *	the half hour which is when most of the data is updated.
+ */
+
+	GetSolarData();								// Get new info
+}												// End of 'UpdateDisplay'
+
+
+/*
+ *	'ShowClockStatus' checks the WiFi connection and changes the color of the
+ *	status circle in the local time header when the connection is lost for
+ *	some time.
+ *
+ *	Modified by WA2FZW in Version 3.0:
+ *
+ *		In previous versions, the WiFi signal strength was shown as the
+ *		negative of the RSSI (Received Signal Strength Indicator). This
+ *		was misleading as the number was always positive and one would
+ *		think a larger number would be better, when in fact, the higher
+ *		the number, the weaker the signal.
+ *
+ *		It now displays the actual signal strength in dBm.
+ *
+ *	Note at startup it may take a few seconds for the status to be displayed
+ *	as it is only checked every 10 seconds.
+ */
+
+void ShowClockStatus ()
+{
+	const int16_t w = 59, h = 27;					// Size of the rectangle
+	const int16_t x = SCREEN_W - w - 4;				// and where it goes
+	const int16_t y = ( BAR_H - h ) / 2;
+	int16_t	fontSz = 2;								// Font size
+	uint16_t color;									// Color of the rectangle
+	int16_t	wifiSignal;								// Integer signal strength
+	String rssi ="";								// ASCII signal strength
+
+	if ( utcCal.second % 10 )			// If the remainder of seconds / 10 not zero
+		return;							// do nothing; i.e. only execute every 10 seconds
+
+	if (( WiFi.status() != WL_CONNECTED )			// If WiFi connection lost
+							&& ( !roam.start ))		// and not moving to another AP
+	{
+		tft.setFreeFont  ( &FreeSansBold9pt7b );	// Easier to read than the default
+		WiFi.disconnect ();							// and drop current connection
+		StartupScreen ();							// Erase most of the screen
+
+		for ( int8_t i = 0; i < 5; i++ )			// Flash the error message
+		{
+			tft.setTextColor ( TFT_RED, TFT_BLACK );
+			tft.drawString ( FlashText ( PSTR ( "LOST WIFI CONNECTION!" )), 45, LY ( 100 ));
+			delay ( 1000 );
+
+			tft.setTextColor ( TFT_WHITE, TFT_BLACK );
+			tft.drawString ( FlashText ( PSTR ( "LOST WIFI CONNECTION!" )), 45, LY ( 100 ));
+			delay ( 1000 );
+		}
+		
+		Restart ( RESTART_WIFI );						// Just start all over!
+	}
+
+	int16_t syncAge = now () - lastNtpUpdateTime ();	// how long has it been since last sync?
+
+	if ( syncAge < SYNC_MARGINAL )					// GREEN: time is good & in sync
+		color = Ink ( PAL_OK );
+
+	else if ( syncAge < SYNC_LOST )					// ORANGE: sync is 1-24 hours old
+		color = Ink ( PAL_WARN );
+
+	else color = Ink ( PAL_BAD );					// RED: time is stale, over 24 hrs old
+
+	gfx->fillRoundRect ( x, y, w, h, 6, color );	// Show WiFi status as a color
+	gfx->setTextColor ( Ink ( PAL_STATUS ), color );
+
+	gfx->fillCircle ( x - 8, y + h / 2, 4,			// Network health dot
+					  Ink ( PAL_OK + NetHealthLevel ()));	// just left of the status
+
+	wifiSignal = WiFi.RSSI ();						// Read signal strength
+	
+	if ( wifiSignal < -99 )							// Limit to 2 digit value
+		wifiSignal = -99;							// for horizontal space limits
+
+	rssi = wifiSignal;								// Assemble ASCII answer
+	rssi += " dBm";
+
+	gfx->drawString ( rssi, x+6, y+6, fontSz );		// Display it
+	PushRegion ( x - 12, y, w + 12, h );			// and send it to the screen
+}													// End of 'ShowClockStatus'
+
+
+/*
+ *	Modified by John Price (WA2FZW)
+ *
+ *		In the original code, this was an empty function. I added code to display either
+ *		an 'A' or 'P' to the right of the local time. Later changed it to show 'AM'
+ *		or 'PM'.
+ */
+
+void ShowAMPM ( int16_t hr, int16_t x, int16_t y )
+{
+	char ampm;									// Will be either 'A' or 'P'
+
+	if ( hr <= 11 )								// If the hour is 11 or less
+		ampm = 'A';								// It's morning
+	else										// Otherwise,
+		ampm = 'P';								// it must be afternoon (DOH!)
+
+	gfx->drawChar ( ampm, x + 2, y - 12, 4 );	// Show 'A' or 'P'
+	gfx->drawChar ( 'M', x, y + 12, 4 );		// And 'M'
+}												// End of 'ShowAMPM'
+
+
+void ShowTime ( const calendar& c, bool hr12, int16_t x, int16_t y )
+{
+	const int16_t fontSz = TIME_FONT;				// Font size
+	const int16_t x0 = x;							// Where the time starts
+	gfx->setTextColor ( Ink ( PAL_TIME ), Ink ( PAL_BG ));	// Set time color
+
+	int16_t h = c.hour;							// Get hours, minutes, and seconds
+	int16_t m = c.minute;
+	int16_t s = c.second;
+
+	if ( hr12 )										// If using 12hr time format,
+	{
+		if ( DISPLAY_AMPM )							// If showing AM/PM
+			ShowAMPM ( h, x + TIME_W, y + DIGIT_H / 2 - 10 );	// Show it
+ 
+		if ( h == 0 )								// 00:00 becomes 12:00
+			h = 12;
+
+		if ( h > 12 )								// 13:00 becomes 01:00
+			h -= 12;
+	}
+
+	if ( h < 10 )										// Is hour a single digit?
+	{
+		if (( !hr12 ) || ( HOUR_LEADING_ZERO ))			// 24hr format: always use leading 0
+			x += gfx->drawChar ( '0', x, y, fontSz );	// Show leading zero for hours
+
+		else
+		{
+			gfx->setTextColor ( Ink ( PAL_BG ), Ink ( PAL_BG ));	// Black on black text
+			x += gfx->drawChar ( '8', x, y, fontSz );	// Will erase the old digit
+			gfx->setTextColor ( Ink ( PAL_TIME ), Ink ( PAL_BG ));	// Reset proper color
+		}
+	}
+
+	x += gfx->drawNumber ( h, x, y, fontSz );			// Show hours
+	x += gfx->drawChar ( ':', x, y, fontSz );			// Show ':'
+
+	if ( m < 10)										// Single digit minutes?
+		x += gfx->drawChar ( '0', x, y, fontSz );		// Always a leading zero for minutes
+
+	x += gfx->drawNumber ( m, x, y, fontSz );			// Show minutes
+	x += gfx->drawChar ( ':', x, y, fontSz );			// Another ':'
+
+	if ( s < 10 )										// Single digit seconds?
+		x += gfx->drawChar ( '0', x, y, fontSz );		// Always a leading zero for seconds
+
+	x += gfx->drawNumber ( s, x, y, fontSz );			// Show seconds
+
+	PushRegion ( x0, y, TIME_W + AMPM_W, DIGIT_H + 4 );	// Digits and AM/PM to the screen
+
+	facePixels[useLocalTime] += paletteMode ? ( TIME_W + AMPM_W ) * ( DIGIT_H + 4 ) : ( x - x0 ) * DIGIT_H;
+	faceUpdates[useLocalTime]++;
+}														// End of ShowTIme
+
+
+void ShowDate ( const calendar& c, int16_t x, int16_t y )
+{
+	const int16_t fontSz = 4;							// Font size
+	const int16_t yspacing = 30;						// Vertical spacing
+
+	const int16_t x0 = x, y0 = y;						// Where the date goes
+	int16_t i = 0;										// ???
+	int16_t m = c.month - 1;							// Index to 'months' array
+	int16_t d = c.day;									// Just a number
+
+	gfx->setTextColor ( Ink ( PAL_DATE ), Ink ( PAL_BG ));	// Set proper colors
+	gfx->fillRect ( x, y, DATE_W - 8, DATE_H, Ink ( PAL_BG ));	// Erase previous date
+
+	if ( DATE_ABOVE_MONTH )								// Show date on top?
+	{
+		if (( DATE_LEADING_ZERO ) && ( d < 10 ))		// Do we need a leading zero?
+			i = gfx->drawNumber ( 0, x, y, fontSz );	// Draw leading zero
+
+		gfx->drawNumber ( d, x + i, y, fontSz );		// Draw date
+		y += yspacing;									// Y position for month
+		gfx->drawString ( FlashText ( months[m] ),
+						  x, y, fontSz );				// Draw month
+	}
+
+	else												// Month goes on top		
+	{
+		gfx->drawString ( FlashText ( months[m] ),
+						  x, y, fontSz );				// Draw month
+		y += yspacing;									// Vertical space for day
+
+		if (( DATE_LEADING_ZERO ) && ( d < 10 ))		// Do we need a leading zero?
+			x += gfx->drawNumber ( 0, x, y, fontSz );	// Yep, draw it
+
+		gfx->drawNumber ( d, x, y, fontSz );			// Draw date
+	}
+
+	PushRegion ( x0, y0, DATE_W, DATE_H );				// Send it to the screen
+}														// End of 'ShowDate'
+
+
+void ShowTimeZone ( int16_t x, int16_t y )
+{
+	const int16_t fontSz = 4;							// Font size
+
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Set text colors
+
+	if ( !useLocalTime )
+	{
+		gfx->drawString ( "UTC", x, y + 3, fontSz );	// UTC time
+		PushRegion ( x, y + 3, 60, 26 );
+	}
+	else
+	{
+		gfx->fillRoundRect ( 2, 2, 75, BAR_H, 10, Ink ( PAL_LABEL_BG ));
+		gfx->drawString ( local.getTimezoneName(),
+								x, y + 2, fontSz);		// Show local time zone
+		PushRegion ( 2, 2, 76, BAR_H - 2 );
+	}
+}														// End of 'ShowTimeZone'
+
+
+void ShowTimeDate ( const calendar& c, time_t oldT, bool hr12, int16_t x, int16_t y )
+{
+	if ( ANALOG_FACE && useLocalTime )					// Local time on the analog face?
+		ShowAnalogTime ( c, hr12, x, y );
+
+	else
+		ShowTime ( c, hr12, x, y );						// Display time HH:MM:SS
+
+	if (( !oldT ) || c.newHour )						// Did hour change?
+		ShowTimeZone ( x, y - LY ( 42 ));				// Yes, update time zone
+
+	if (( !oldT ) || c.newDay )							// Did date change?
+		ShowDate ( c, x + TIME_W + AMPM_W, y );			// Yes, update it
+}														// End of 'ShowTimeDate'
+
+
+/*
+ *	Analog clock face; added in Version 3.2.
+ *
+ *	Erasing and redrawing three anti-aliased hands every second makes them flicker
+ *	and sends a lot more over the SPI bus than needed. Instead, the face with its
+ *	tick marks is drawn once in the 'face' sprite. Each second we work out which
+ *	hands moved, take the smallest rectangle that covers where they were and where
+ *	they are going, copy just that rectangle of the face into the 'hands' sprite,
+ *	draw all the hands over it and push that rectangle to the display in one go.
+ *	Most seconds only the second hand moves, so that's a small area.
+ *
+ *	The angles are in whole degrees clockwise from 12 o'clock and the positions
+ *	come from a fixed point sine table rather than floating point.
+ */
+
+int32_t Sin14 ( int16_t deg )							// Sine times 16384
+{
+	deg %= 360;
+
+	if ( deg < 0 )
+		deg += 360;
+
+	if ( deg <= 90 )
+		return  ( int16_t ) pgm_read_word ( &sinTable[deg] );
+
+	if ( deg <= 180 )
+		return  ( int16_t ) pgm_read_word ( &sinTable[180 - deg] );
+
+	if ( deg <= 270 )
+		return -( int16_t ) pgm_read_word ( &sinTable[deg - 180] );
+
+	return -( int16_t ) pgm_read_word ( &sinTable[360 - deg] );
+}
+
+
+int32_t Cos14 ( int16_t deg )							// Cosine times 16384
+{
+	return Sin14 ( deg + 90 );
+}
+
+
+/*
+ *	'HandTip' gives the end of a hand 'len' sixteenths of the radius long in
+ *	sprite coordinates.
+ */
+
+void HandTip ( int16_t deg, int16_t len, int16_t& x, int16_t& y )
+{
+	int32_t r = ( int32_t ) FACE_R * len / 16;			// Length in pixels
+
+	x = FACE_R + (( r * Sin14 ( deg )) >> 14 );
+	y = FACE_R - (( r * Cos14 ( deg )) >> 14 );
+}
+
+
+/*
+ *	'HandBox' is the rectangle a hand covers, including its width and a pixel
+ *	for the anti-aliasing.
+ */
+
+faceBox HandBox ( int16_t deg, int16_t len, int16_t width )
+{
+	faceBox		b;										// The answer
+	int16_t		x, y;									// Tip of the hand
+	int16_t		pad = width / 2 + 2;					// Half width plus smoothing
+
+	HandTip ( deg, len, x, y );
+
+	b.x0 = max ( min ( x, ( int16_t ) FACE_R ) - pad, 0 );
+	b.y0 = max ( min ( y, ( int16_t ) FACE_R ) - pad, 0 );
+	b.x1 = min ( max ( x, ( int16_t ) FACE_R ) + pad, FACE_SIZE - 1 );
+	b.y1 = min ( max ( y, ( int16_t ) FACE_R ) + pad, FACE_SIZE - 1 );
+
+	return b;
+}
+
+
+void AddBox ( faceBox& to, const faceBox& b )			// Grow 'to' to cover 'b'
+{
+	if ( b.x0 > b.x1 )									// Nothing to add
+		return;
+
+	if ( to.x0 > to.x1 )								// Nothing there yet
+	{
+		to = b;
+		return;
+	}
+
+	to.x0 = min ( to.x0, b.x0 );
+	to.y0 = min ( to.y0, b.y0 );
+	to.x1 = max ( to.x1, b.x1 );
+	to.y1 = max ( to.y1, b.y1 );
+}
+
+
+/*
+ *	'BuildFace' creates the sprites the first time and draws the dial in the
+ *	current palette colors. It returns 'false' if there isn't enough memory.
+ */
+
+bool BuildFace ()
+{
+	int16_t		x0, y0, x1, y1;							// Ends of a tick mark
+
+	if ( !face.created ())
+	{
+		face.setColorDepth ( 16 );
+		hands.setColorDepth ( 16 );
+
+		if ( !face.createSprite ( FACE_SIZE, FACE_SIZE ))
+			return false;
+
+		if ( !hands.createSprite ( FACE_SIZE, FACE_SIZE ))
+		{
+			face.deleteSprite ();
+			return false;
+		}
+	}
+
+	face.fillSprite ( palette[PAL_BG] );
+	face.drawSmoothCircle ( FACE_R, FACE_R, FACE_R, palette[PAL_EDGE], palette[PAL_BG] );
+
+	for ( int16_t i = 0; i < 60; i++ )					// Tick marks
+	{
+		if ( i % 5 )									// Minutes are just a dot
+		{
+			HandTip ( i * 6, 15, x0, y0 );
+			face.drawPixel ( x0, y0, palette[PAL_DATE] );
+		}
+
+		else											// Hours are a short line
+		{
+			HandTip ( i * 6, 12, x0, y0 );
+			HandTip ( i * 6, 15, x1, y1 );
+			face.drawWideLine ( x0, y0, x1, y1, ( i % 15 ) ? 2 : 3,
+								palette[PAL_DATE], palette[PAL_BG] );
+		}
+	}
+
+	faceReady = true;
+	return true;
+}
+
+
+/*
+ *	'ShowAnalogTime' is called instead of 'ShowTime' for the local time when
+ *	'ANALOG_FACE' is 'true'.
+ */
+
+void ShowAnalogTime ( const calendar& c, bool hr12, int16_t x, int16_t y )
+{
+	const int16_t	lens[3]   = { HOUR_LEN, MINUTE_LEN, SECOND_LEN };
+	const int16_t	widths[3] = { 5, 3, 1 };			// Width at the center
+	const uint8_t	inks[3]   = { PAL_TIME, PAL_TIME, PAL_HIGH };
+
+static	int16_t		oldDeg[3];							// Where the hands were drawn
+static	faceBox		oldBox[3];							// and the area they covered
+
+	int16_t		deg[3];									// Where they go now
+	faceBox		area = { 0, 0, -1, -1 };				// What needs redrawing
+	bool		full = !faceReady;						// Redraw the whole face
+	int16_t		tx, ty;									// Tip of a hand
+	uint16_t*	src;									// Face pixels
+	uint16_t*	dst;									// Pixels with the hands
+
+	deg[0] = ( c.hour % 12 ) * 30 + c.minute / 2;
+	deg[1] = c.minute * 6 + c.second / 10;
+	deg[2] = c.second * 6;
+
+	if ( full && !BuildFace ())							// Not enough memory
+	{
+		ShowTime ( c, hr12, x, y );						// Use the digits
+		return;
+	}
+
+	for ( int8_t i = 0; i < 3; i++ )
+	{
+		if ( full || ( deg[i] != oldDeg[i] ))			// Hand moved?
+		{
+			if ( !full )
+				AddBox ( area, oldBox[i] );				// Where it was
+
+			oldDeg[i] = deg[i];
+			oldBox[i] = HandBox ( deg[i], lens[i], widths[i] );
+			AddBox ( area, oldBox[i] );					// and where it's going
+		}
+	}
+
+	if ( full )
+		area = { 0, 0, FACE_SIZE - 1, FACE_SIZE - 1 };
+
+	if ( area.x0 > area.x1 )							// Nothing moved
+		return;
+
+	src = ( uint16_t* ) face.getPointer ();				// Copy the background
+	dst = ( uint16_t* ) hands.getPointer ();
+
+	for ( int16_t row = area.y0; row <= area.y1; row++ )
+		memcpy ( dst + row * FACE_SIZE + area.x0, src + row * FACE_SIZE + area.x0,
+				 ( area.x1 - area.x0 + 1 ) * sizeof ( uint16_t ));
+
+	for ( int8_t i = 0; i < 3; i++ )					// Hour hand first, second on top
+	{
+		HandTip ( deg[i], lens[i], tx, ty );
+		hands.drawWedgeLine ( FACE_R, FACE_R, tx, ty, widths[i], 1,
+							  palette[inks[i]] );		// Blend with what's under it
+	}
+
+	hands.fillSmoothCircle ( FACE_R, FACE_R, 3, palette[PAL_HIGH] );	// Hub
+
+	hands.pushSprite ( FACE_X - FACE_R + area.x0, FACE_Y - FACE_R + area.y0,
+					   area.x0, area.y0, area.x1 - area.x0 + 1, area.y1 - area.y0 + 1 );
+
+	facePixels[1] += ( area.x1 - area.x0 + 1 ) * ( area.y1 - area.y0 + 1 );
+	pushedPixels  += ( area.x1 - area.x0 + 1 ) * ( area.y1 - area.y0 + 1 );
+	faceUpdates[1]++;
+}
+
+
+/*
+ *	'PrintFacePixels' shows how many pixels a second go to the display for each
+ *	time display, so the analog and 7-segment faces can be compared.
+ */
+
+void PrintFacePixels ( bool restart )
+{
+	for ( int8_t i = 1; i >= 0; i-- )
+		if ( faceUpdates[i] )
+			Serial.printf_P ( PSTR ( "%s time: %s face, average %u pixels/second\n" ),
+							i ? "Local" : "UTC",
+							( i && ANALOG_FACE && faceReady ) ? "analog" : "7-segment",
+							facePixels[i] / faceUpdates[i] );
+
+	if ( restart )										// New average next time
+	{
+		facePixels[0] = facePixels[1] = 0;
+		faceUpdates[0] = faceUpdates[1] = 0;
+	}
+
+	Serial.printf_P ( PSTR ( "Display: %u late seconds, longest %u ms\n" ), stallCount, stallMaxMs );
+}
+
+										
+/*
+ *	Currently gives the option to show UTC or local time; why not both?
+ */
+
+void PrintTime ()											// Print time to serial port
+{
+	if ( !PRINTED_TIME )									// Option 0: dont print
+		return;
+
+	if ( PRINTED_TIME == 1 )								// Option 1: print UTC time
+		Serial.println ( dateTime ( TIME_FORMAT ));
+
+	else
+		Serial.println ( local.dateTime ( TIME_FORMAT ));	// Option 2: print local time
+}															// End of 'PrintTime'
+
+
+/*
+ *	Benchmark functions; added in Version 3.2.
+ *
+ *	When 'BENCHMARK' is 'true', 'Benchmark' runs once at startup (before connecting
+ *	to the WiFi) and times:
+ *
+ *		The XML parsing on the sample data in 'SolarSample.h', worst case data
+ *		and damaged copies of the sample (which also checks the results)
+ *		The UTC to local time conversion for each of the 'timeZones'
+ *		'Breakdown' and the ezTime functions it replaced
+ *		Drawing the time, date and solar data for some typical updates
+ *
+ *	The results are printed on the serial monitor as JSON so that runs with
+ *	different versions of the program can be compared with a script. Each result
+ *	has a name that doesn't change, the number of times it was run, the average
+ *	time in microseconds and, for the drawing, the number of pixels sent to the
+ *	display each time (only counted when drawing into the sprite) and, for the
+ *	drawing that has to be done in time for the next second, the budget for it on
+ *	this size of screen ('RENDER_SECOND_US' and 'RENDER_SCREEN_US'); "over_budget"
+ *	at the end counts the results that took longer. The processor runs at full
+ *	speed throughout.
+ *
+ *	'host_bench.sh' (in the 'Software' folder) times the XML parsing and 'Breakdown'
+ *	on a computer with the same result names.
+ */
+
+uint32_t	benchCount = 0;				// Results printed so far
+uint32_t	benchOver = 0;				// and how many were over budget
+volatile uint32_t benchSink = 0;		// Stops the compiler skipping the work
+
+
+void BenchResult ( const char* name, uint32_t runs, uint32_t us, int32_t pixels, uint32_t budget )
+{
+	Serial.printf_P ( PSTR ( "%s\n    { \"name\": \"%s\", \"runs\": %u, \"us\": %.2f, \"pixels\": %d, \"budget\": %u }" ),
+					benchCount++ ? "," : "", name, runs, ( float ) us / runs,
+					paletteMode ? pixels : -1, budget );
+
+	if ( budget && ( us / runs > budget ))
+		benchOver++;
+}
+
+
+/*
+ *	'BenchXmlWorst' times the XML parsers on the worst data we can think of: 4K of
+ *	tags that almost match ("<sunspot" over and over). 'ParseSolarData' gives up
+ *	after 'XML_MAX_TAGS' of them. "xml.scan" is 4K with no tags at all.
+ */
+
+void BenchXmlWorst ()
+{
+	const size_t	size = 4096;						// How much
+	char*			xml = ( char* ) ArenaAlloc ( size + 1 );
+	solarSnapshot	snap;
+	uint32_t		us;
+
+	if ( !xml )
+		return;
+
+	for ( size_t i = 0; i < size; i++ )
+		xml[i] = "<sunspot"[i % 8];
+	xml[size] = 0;
+
+	us = micros ();
+	for ( uint16_t i = 0; i < 20; i++ )
+		ParseSolarData ( xml, size, snap );
+	BenchResult ( "xml.worst", 20, micros () - us, 0, 0 );
+
+	for ( size_t i = 0; i < size; i++ )					// Same thing without the '<'s
+		xml[i] = "sunspots"[i % 8];						// to see the scanning speed
+
+	us = micros ();
+	for ( uint16_t i = 0; i < 20; i++ )
+		ParseSolarData ( xml, size, snap );
+	BenchResult ( "xml.scan", 20, micros () - us, 0, 0 );
+
+	for ( size_t i = 0; i < size; i++ )					// Put them back for the old way
+		xml[i] = "<sunspot"[i % 8];
+
+	us = micros ();
+	for ( uint16_t i = 0; i < 20; i++ )
+		ParseSolarDataRef ( xml, snap );
+	BenchResult ( "xml.worst.ref", 20, micros () - us, 0, 0 );
+}
+
+
+/*
+ *	'BenchXmlFuzz' makes lots of damaged copies of the sample data (characters
+ *	changed to ones that matter in XML, bits cut out, copies cut short). Those that
+ *	'ParseSolarData' accepts must give exactly the same values as 'ParseSolarDataRef';
+ *	the result shows how many didn't and how many were rejected.
+ */
+
+void BenchXmlFuzz ()
+{
+	const char		chars[] = "<>/ \tsunpotlar1";		// What we change things to
+	const size_t	sampleLen = sizeof ( solarSample ) - 1;
+	char*			xml = ( char* ) ArenaAlloc ( sampleLen + 1 );
+	solarSnapshot	a, b;								// Results from each parser
+	uint32_t		seed = 12345;						// Always the same tests
+	uint32_t		mismatches = 0;
+	uint32_t		rejected = 0;						// Damaged too badly to use
+	uint32_t		us = micros ();
+	size_t			len;								// Length of this copy
+	size_t			at;									// Where we change it
+
+	if ( !xml )
+		return;
+
+	for ( uint16_t run = 0; run < 500; run++ )
+	{
+		memcpy_P ( xml, solarSample, sampleLen + 1 );
+		len = sampleLen;
+
+		for ( uint8_t k = 0; k < 1 + ( run % 8 ); k++ )
+		{
+			seed ^= seed << 13;							// Xorshift random numbers
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+			at = seed % len;
+
+			switch (( seed >> 24 ) % 3 )
+			{
+				case 0:									// Change a character
+					xml[at] = chars[( seed >> 8 ) % ( sizeof ( chars ) - 1 )];
+					break;
+
+				case 1:									// Cut out up to 16
+				{
+					size_t	cut = min ( ( size_t ) (( seed >> 8 ) % 16 + 1 ), len - at );
+
+					memmove ( xml + at, xml + at + cut, len - at - cut + 1 );
+					len -= cut;
+					break;
+				}
+
+				case 2:									// Cut it short
+					xml[at] = 0;
+					len = at;
+					break;
+			}
+
+			if ( len == 0 )
+				break;
+		}
+
+		memset ( &a, 0, sizeof ( a ));
+		memset ( &b, 0, sizeof ( b ));
+		ParseSolarDataRef ( xml, b );
+
+		if ( !ParseSolarData ( xml, len, a ))			// Rejected
+			rejected++;
+
+		else if ( memcmp ( &a, &b, sizeof ( a )))		// Accepted but different
+			mismatches++;
+	}
+
+	us = micros () - us;
+
+	Serial.printf_P ( PSTR ( ",\n    { \"name\": \"xml.fuzz\", \"runs\": 500, \"us\": %.2f, "
+					"\"mismatches\": %u, \"rejected\": %u }" ),
+					us / 500.0, mismatches, rejected );
+	benchCount++;
+}
+
+
+void Benchmark ()
+{
+	const time_t	start = 1792108800;					// 10/16/26 00:00:00 UTC
+	char			name[24];							// For the result names
+	solarSnapshot	snap;								// Somewhere to parse into
+	char			value[SOLAR_VALUE];
+	char*			xml;								// Sample XML in RAM
+	calendar		c = {};
+	Timezone		zone;
+	uint32_t		us;									// Start time
+	uint32_t		pixels;								// Pixels sent
+
+	CpuBoost ();
+
+	Serial.printf_P ( PSTR ( "{ \"benchmark\": %u, \"board\": \"%s\", \"mhz\": %u, \"sprite\": %s, \"screen\": \"%ux%u\",\n"
+					"  \"results\": [" ),
+					BENCH_VERSION,
+					#if defined ( ESP32 )
+						"ESP32",
+					#elif defined ( ESP8266 )
+						"ESP8266",
+					#endif
+					CPU_BUSY_MHZ, paletteMode ? "true" : "false", SCREEN_W, SCREEN_H );
+
+
+/*
+ *	The XML parsing. The sample is copied into the arena first, just like the real
+ *	data would be.
+ */
+
+	ArenaReset ();
+	xml = ( char* ) ArenaAlloc ( sizeof ( solarSample ));
+
+	if ( xml )
+	{
+		memcpy_P ( xml, solarSample, sizeof ( solarSample ));
+
+		us = micros ();
+		for ( uint16_t i = 0; i < 200; i++ )
+			ParseSolarData ( xml, sizeof ( solarSample ) - 1, snap );
+		BenchResult ( "xml.parse", 200, micros () - us, 0, 0 );
+
+		us = micros ();
+		for ( uint16_t i = 0; i < 200; i++ )
+			ParseSolarDataRef ( xml, snap );
+		BenchResult ( "xml.parse.ref", 200, micros () - us, 0, 0 );
+
+		us = micros ();
+		for ( uint16_t i = 0; i < 1000; i++ )
+		{
+			GetXmlData ( xml, "sunspots", value );
+			benchSink += value[0];
+		}
+		BenchResult ( "xml.tag", 1000, micros () - us, 0, 0 );
+
+		solar = snap;									// For drawing the solar data
+	}
+
+	BenchXmlWorst ();
+	BenchXmlFuzz ();
+	ArenaReset ();
+
+
+/*
+ *	Local time conversion for a time every 8 hours or so through a year:
+ */
+
+	for ( uint8_t i = 0; i < tzCount; i++ )
+	{
+		zone.setPosix ( TimeZoneRule ( i ));
+
+		us = micros ();
+		for ( uint16_t j = 0; j < 1000; j++ )
+			benchSink += zone.tzTime ( start + j * 31536UL, UTC_TIME );
+
+		snprintf ( name, sizeof ( name ), "tz.%u", i );
+		BenchResult ( name, 1000, micros () - us, 0, 0 );
+	}
+
+
+/*
+ *	Breaking down a time, the new way and the old:
+ */
+
+	us = micros ();
+	for ( uint16_t i = 0; i < 1000; i++ )
+	{
+		Breakdown ( start + i * 3571UL, c );
+		benchSink += c.hour + c.minute + c.second + c.day + c.month;
+	}
+	BenchResult ( "calendar.breakdown", 1000, micros () - us, 0, 0 );
+
+	us = micros ();
+	for ( uint16_t i = 0; i < 1000; i++ )
+	{
+		time_t	when = start + i * 3571UL;
+
+		benchSink += hour ( when ) + minute ( when ) + second ( when )
+				   + day ( when ) + month ( when );
+	}
+	BenchResult ( "calendar.eztime", 1000, micros () - us, 0, 0 );
+
+
+/*
+ *	Drawing. "render.second" is what happens most seconds, "render.hour" is when
+ *	the hour changes (the timezone and date get drawn too), "render.sfi" is one
+ *	of the solar data items and "render.screen" is the whole screen.
+ */
+
+	Breakdown ( start, utcCal );
+
+	pixels = pushedPixels;
+	us = micros ();
+	for ( uint16_t i = 0; i < 50; i++ )
+		ShowTime ( utcCal, UTC_FORMAT_12HR, TIME_X, UTC_Y );
+	BenchResult ( "render.second", 50, micros () - us, ( pushedPixels - pixels ) / 50, RENDER_SECOND_US );
+
+	pixels = pushedPixels;
+	us = micros ();
+	for ( uint16_t i = 0; i < 20; i++ )
+		ShowTimeDate ( utcCal, 0, UTC_FORMAT_12HR, TIME_X, UTC_Y );
+	BenchResult ( "render.hour", 20, micros () - us, ( pushedPixels - pixels ) / 20, RENDER_SECOND_US );
+
+	pixels = pushedPixels;
+	us = micros ();
+	for ( uint16_t i = 0; i < 20; i++ )
+	{
+		ShowSFI ();
+		PushRegion ( SOLAR_X, UTC_TOP, SCREEN_W - 1 - SOLAR_X, LY ( 34 ));
+	}
+	BenchResult ( "render.sfi", 20, micros () - us, ( pushedPixels - pixels ) / 20, 0 );
+
+	pixels = pushedPixels;
+	us = micros ();
+	for ( uint16_t i = 0; i < 5; i++ )
+		NewDualScreen ();
+	BenchResult ( "render.screen", 5, micros () - us, ( pushedPixels - pixels ) / 5, RENDER_SCREEN_US );
+
+	Serial.printf_P ( PSTR ( "\n  ],\n  \"over_budget\": %u\n}\n" ), benchOver );
+
+
+/*
+ *	Put back anything the benchmark changed:
+ */
+
+	solar = noSolar;
+	utcCal = {};
+	facePixels[0] = facePixels[1] = 0;
+	faceUpdates[0] = faceUpdates[1] = 0;
+
+	CpuRelax ();
+}
+
+
+/*
+ *	LAN clock synchronization functions; added in Version 3.2.
+ *
+ *	When several clocks hang on the same wall, each one polls 'now ()' on its own
+ *	and their seconds visibly flip at different times. These functions let the
+ *	clocks on a LAN agree on a common time base; the protocol itself (leader
+ *	election and the NTP style exchange with the leader) is in 'LanSync.h'.
+ *
+ *	All the clocks then paint their digits when the corrected time ('SyncedNow')
+ *	crosses a second boundary, so they all flip together.
+ */
+
+uint32_t ChipId ()
+{
+	#if defined ( ESP32 )
+		return ( uint32_t ) ( ESP.getEfuseMac () >> 16 );	// Unique part of the MAC
+
+	#elif defined ( ESP8266 )
+		return ESP.getChipId ();
+
+	#endif
+}
+
+
+/*
+ *	'EpochMs' returns our own (NTP disciplined) time in milliseconds and 'SyncedNow'
+ *	returns the time corrected to match the leader's.
+ */
+
+int64_t EpochMs ()
+{
+	time_t s = now ();									// Whole seconds
+	return (( int64_t ) s * 1000 ) + ms ( LAST_READ );	// Plus milliseconds of that read
+}
+
+time_t SyncedNow ()
+{
+	if ( !LAN_SYNC )									// Not synchronizing
+		return now ();									// so just our own time
+
+	return ( EpochMs () + lan.offset ) / 1000;			// Leader's idea of the time
+}
+
+
+void ClockSyncBegin ()
+{
+	if ( !LAN_SYNC )
+		return;
+
+	LanBegin ( lan, ChipId ());					// Leader until we hear from
+	lanUdp.begin ( LAN_SYNC_PORT );				// someone lower
+
+	Serial.printf_P ( PSTR ( "Clock sync: ID %08X\n" ), lan.myId );
+}
+
+
+/*
+ *	'SendLanPacket' sends a packet 'LanSync.h' has filled in. If 'to' is zero, it's
+ *	broadcast to every clock on the subnet.
+ */
+
+void SendLanPacket ( const lanPacket &pkt, IPAddress to )
+{
+	if ( ( uint32_t ) to == 0 )								// Broadcast?
+		to = ( uint32_t ) WiFi.localIP () | ~( uint32_t ) WiFi.subnetMask ();
+
+	lanUdp.beginPacket ( to, LAN_SYNC_PORT );
+	lanUdp.write (( const uint8_t* ) &pkt, sizeof ( pkt ));
+	lanUdp.endPacket ();
+}
+
+
+/*
+ *	'ClockSync' gets called every time through the main loop. It answers any
+ *	packets from the other clocks, holds the leader election and, if we're a
+ *	follower, polls the leader. It never waits for anything.
+ */
+
+void ClockSync ()
+{
+static	uint32_t	helloTime = 0;						// When we last said hello
+static	uint32_t	pollTime  = 0;						// When we last polled the leader
+static	uint32_t	reportTime = 0;						// When we last printed the status
+
+	lanPacket	pkt;									// Incoming or outgoing packet
+	int64_t		arrival;								// When it arrived
+	int16_t		size;									// Size of incoming packet
+	uint32_t	leader = lan.leaderId;					// To see if it changes
+
+	if ( !LAN_SYNC )
+		return;
+
+	while (( size = lanUdp.parsePacket ()) > 0 )		// Anything from the other clocks?
+	{
+		arrival = EpochMs ();							// Stamp it right away
+
+		size = lanUdp.read (( uint8_t* ) &pkt, sizeof ( pkt ));
+		while ( lanUdp.available ())					// Discard anything extra
+			lanUdp.read ();
+
+		if ( size != sizeof ( pkt ))
+			continue;
+
+		if ( LanReceive ( lan, pkt, arrival, ( uint32_t ) lanUdp.remoteIP (), millis ()))
+		{
+			pkt.t3 = EpochMs ();						// Answer a follower
+			SendLanPacket ( pkt, lanUdp.remoteIP ());
+		}
+	}
+
+	if ( LanLeaderLost ( lan, millis ()))				// Leader went away; take over
+		Serial.println ( F ( "Clock sync: leader lost, now leading" ));
+
+	else if (( lan.leaderId != leader ) && ( lan.leaderId != lan.myId ))
+		Serial.printf_P ( PSTR ( "Clock sync: following %08X\n" ), lan.leaderId );
+
+	if (( millis () - helloTime ) >= LAN_HELLO_MS )		// Time to announce ourselves?
+	{
+		helloTime = millis ();
+		memset ( &pkt, 0, sizeof ( pkt ));
+		LanStamp ( lan, pkt, LAN_HELLO );
+		SendLanPacket ( pkt, IPAddress ( 0, 0, 0, 0 ));
+	}
+
+	if (( lan.leaderId != lan.myId ) && (( millis () - pollTime ) >= LAN_POLL_MS ))
+	{
+		pollTime = millis ();							// Time to poll the leader
+		LanRequest ( lan, pkt, EpochMs ());
+		SendLanPacket ( pkt, IPAddress ( lan.leaderAddr ));
+	}
+
+	if (( millis () - reportTime ) >= 60000 )			// Once a minute
+	{
+		reportTime = millis ();
+		PrintSyncStatus ();
+
+		if ( lan.leaderId == lan.myId )					// Leader starts over collecting
+			lan.skew = 0;								// the followers' worst skew
+	}
+}
+
+
+/*
+ *	'PrintSyncStatus' shows where we stand on the serial monitor. For a follower,
+ *	'skew' is how far its display was from the leader's when last measured; for
+ *	the leader it's the worst any follower reported in the last minute.
+ */
+
+void PrintSyncStatus ()
+{
+	if ( lan.leaderId == lan.myId )
+		Serial.printf_P ( PSTR ( "Clock sync: leader, worst skew %d ms\n" ), lan.skew );
+
+	else
+		Serial.printf_P ( PSTR ( "Clock sync: follower of %08X, offset %d ms, rtt %d ms, skew %d ms\n" ),
+						lan.leaderId, lan.offset, lan.rtt, lan.skew );
+}
+
+
+/*
+ *	'IdleSlice' returns 'true' when we're well clear of the next second boundary,
+ *	i.e., the digits have been painted and there's plenty of time before they
+ *	need to be painted again. Background work that might take a while should
+ *	only be started then.
+ */
+
+bool IdleSlice ()
+{
+	int16_t	msec = ( EpochMs () + lan.offset ) % 1000;	// Where we are in the second
+
+	return ( msec > 50 ) && ( msec < 600 );
+}
+
+
+/*
+ *	WiFi roaming functions; added in Version 3.2.
+ *
+ *	If there are several access points with the same SSID, the ESP will happily
+ *	stay connected to a weak one until the connection drops completely (at which
+ *	point 'ShowClockStatus' reboots the clock). 'WiFiRoam' watches the averaged
+ *	signal strength and when it drops below 'ROAM_RSSI' it sweeps the channels
+ *	looking for an access point with the same SSID at least 'ROAM_MARGIN' dB
+ *	stronger. The decisions are made in 'Roam.h'; all we do here is talk to the
+ *	radio.
+ *
+ *	The sweep scans one channel at a time, and only starts a scan in an idle
+ *	slice, so the display never misses a beat. Neither the NTP state nor anything
+ *	else is disturbed by a move; only the radio connection changes.
+ */
+
+void WiFiRoam ()
+{
+	int16_t			found;								// Number of scan results
+
+	if ( !WIFI_ROAMING )
+		return;
+
+	if ( roam.start )									// Roam in progress?
+	{
+		if ( WiFi.status () == WL_CONNECTED )			// Made it
+		{
+			Serial.printf_P ( PSTR ( "WiFi roam: now on %s channel %d, %d dBm\n" ),
+						WiFi.BSSIDstr ().c_str (), WiFi.channel (), WiFi.RSSI ());
+
+			EventLog ( EV_ROAM, WiFi.channel (), WiFi.RSSI (), 0 );
+			RoamDone ( roam, WiFi.RSSI (), millis ());
+		}
+
+		else if ( RoamFailed ( roam, millis ()))		// Let the ESP pick any AP
+		{
+			Serial.println ( F ( "WiFi roam: failed, reconnecting" ));
+			EventLog ( EV_ROAM, -1, 0, 0 );
+			WiFi.disconnect ();
+			WiFi.begin ( cfg.ssid[wifiIndex],
+						 cfg.pwd[wifiIndex] );
+			SetListenInterval ();
+		}
+
+		return;
+	}
+
+	if ( WiFi.status () != WL_CONNECTED )				// 'ShowClockStatus' deals
+		return;											// with this
+
+	if (( millis () - roam.sampleTime ) >= ROAM_SAMPLE_MS )
+		RoamSample ( roam, WiFi.RSSI (), millis ());
+
+
+/*
+ *	If a scan is running, collect the results when it's done. We're only interested
+ *	in access points with our SSID.
+ */
+
+	if ( roam.scanning )
+	{
+		found = WiFi.scanComplete ();
+
+		if ( found == WIFI_SCAN_RUNNING )				// Not yet
+			return;
+
+		for ( int16_t i = 0; i < found; i++ )
+			if ( WiFi.SSID ( i ) == cfg.ssid[wifiIndex] )
+				RoamFound ( roam, WiFi.BSSID ( i ), WiFi.channel ( i ), WiFi.RSSI ( i ),
+							WiFi.BSSID ());
+
+		WiFi.scanDelete ();								// Free the results
+		RoamScanned ( roam );
+		return;
+	}
+
+	switch ( RoamNext ( roam, ROAM_RSSI, ROAM_MARGIN, IdleSlice (), millis ()))
+	{
+		case ROAM_SCAN:									// Scan just one channel
+			#if defined ( ESP32 )
+				WiFi.scanNetworks ( true, false, false, ROAM_DWELL_MS, roam.channel );
+
+			#elif defined ( ESP8266 )
+				WiFi.scanNetworks ( true, false, roam.channel );
+
+			#endif
+			break;
+
+		case ROAM_MOVE:
+			Serial.printf_P ( PSTR ( "WiFi roam: %d dBm -> %d dBm on channel %d\n" ),
+							roam.smoothRssi / 16, roam.bestRssi, roam.bestChannel );
+
+			WiFi.disconnect ();
+			WiFi.begin ( cfg.ssid[wifiIndex], cfg.pwd[wifiIndex],
+						 roam.bestChannel, roam.bestBssid );
+			SetListenInterval ();
+			break;
+	}
+}
+
+
+/*
+ *	Network health monitor functions; added in Version 3.2.
+ *
+ *	The status indicator only shows the RSSI and the age of the last NTP update,
+ *	so when it turns orange there's no way to tell why. 'NetHealth' sends a small
+ *	DNS query (for the NTP server's name) alternately to the gateway and to the DNS
+ *	server every 'NH_PROBE_MS' and times the answers. Only one probe is ever
+ *	outstanding and we never wait for the answer; it's picked up on a later pass
+ *	through the main loop, or counted as lost after 'NH_TIMEOUT_MS'.
+ *
+ *	Most home routers relay DNS, so they answer the gateway probe. If the gateway
+ *	never answers while the DNS server does, we assume it doesn't relay DNS and
+ *	stop probing it rather than reporting it as 100% loss.
+ *
+ *	The latencies go into fixed size histograms in a ring of windows, so the memory
+ *	used never grows. The solar data fetches and overdue NTP updates are counted in
+ *	the same windows so they can be compared with the network's behavior at the
+ *	time they happened.
+ */
+
+void NetHealth ()
+{
+static	uint32_t	probeTime  = 0;						// When the last probe was sent
+static	uint32_t	windowTime = 0;						// When the current window started
+static	uint32_t	ntpTime    = 0;						// When we last checked NTP
+static	uint16_t	probeId    = 0;						// DNS ID of the outstanding probe
+static	uint8_t		target     = NH_GATEWAY;			// Who it was sent to
+static	bool		waiting    = false;					// Probe outstanding
+static	uint8_t		gwTries    = 0;						// Gateway probes never answered
+
+	uint8_t			query[32];							// DNS query packet
+	uint8_t			reply[12];							// Start of the answer
+	uint16_t		latency;							// Round trip time
+	uint8_t			bucket;								// Histogram bucket
+	int16_t			len;								// Length of query packet
+	const char*		name = NTP_SERVER;					// Name we look up
+
+	if ( WiFi.status () != WL_CONNECTED )
+		return;
+
+	if (( millis () - windowTime ) >= NH_WINDOW_MS )	// Time for a new window?
+	{
+		if ( windowTime )
+			PrintNetHealth ();							// Report the one just finished
+
+		windowTime = millis ();
+		nhCurrent = ( nhCurrent + 1 ) % NH_WINDOWS;
+		memset ( &nhWindows[nhCurrent], 0, sizeof ( nhWindow ));
+	}
+
+	if (( millis () - ntpTime ) >= 60000 )				// Once a minute, see if the
+	{													// NTP update is overdue
+		ntpTime = millis ();
+
+		if (( now () - lastNtpUpdateTime ()) > ( NTP_INTERVAL + 120 ))
+			nhWindows[nhCurrent].ntpLate++;
+	}
+
+	if ( waiting )										// Probe outstanding?
+	{
+		latency = millis () - probeTime;
+
+		if ( nhUdp.parsePacket () > 0 )					// Got an answer
+		{
+			len = nhUdp.read ( reply, sizeof ( reply ));
+			while ( nhUdp.available ())					// Don't need the rest
+				nhUdp.read ();
+
+			if (( len < 4 ) || ((( reply[0] << 8 ) | reply[1] ) != probeId )
+							|| !( reply[2] & 0x80 ))	// Must be a reply to our query
+				return;
+
+			for ( bucket = 0; bucket < NH_BUCKETS - 1; bucket++ )
+				if ( latency <= nhEdges[bucket] )
+					break;
+
+			nhWindows[nhCurrent].hist[target][bucket]++;
+			nhWindows[nhCurrent].sent[target]++;
+			waiting = false;
+
+			if ( target == NH_GATEWAY )					// Gateway does relay DNS
+				gwTries = 0;
+		}
+
+		else if ( latency > NH_TIMEOUT_MS )				// Given up on it
+		{
+			nhWindows[nhCurrent].sent[target]++;
+			nhWindows[nhCurrent].lost[target]++;
+			waiting = false;
+
+			if (( target == NH_GATEWAY ) && nhGatewayDns && ( ++gwTries >= 20 )
+						&& (( uint32_t ) WiFi.gatewayIP () != ( uint32_t ) WiFi.dnsIP ()))
+			{
+				Serial.println ( F ( "Net health: gateway doesn't answer DNS, not probing it" ));
+				nhGatewayDns = false;
+			}
+		}
+
+		return;
+	}
+
+	if ((( millis () - probeTime ) < NH_PROBE_MS ) || !IdleSlice ())
+		return;											// Not time for another one
+
+
+/*
+ *	Build a minimal DNS query for the 'A' record of the NTP server: a 12 byte
+ *	header asking for recursion, then the name as length prefixed labels, then the
+ *	query type and class.
+ */
+
+	probeId = ( probeId + 1 ) | 1;						// New query ID (never 0)
+	memset ( query, 0, 12 );
+	query[0] = probeId >> 8;
+	query[1] = probeId & 0xFF;
+	query[2] = 0x01;									// Recursion desired
+	query[5] = 1;										// One question
+	len = 12;
+
+	while ( *name && len < ( int16_t ) sizeof ( query ) - 6 )
+	{
+		const char* dot = strchr ( name, '.' );			// End of this label
+		uint8_t labelLen = dot ? dot - name : strlen ( name );
+
+		if ( len + labelLen + 1 > ( int16_t ) sizeof ( query ) - 5 )
+			break;										// Name too long for the buffer
+
+		query[len++] = labelLen;
+		memcpy ( &query[len], name, labelLen );
+		len += labelLen;
+		name += labelLen + ( dot ? 1 : 0 );
+	}
+
+	query[len++] = 0;									// End of name
+	query[len++] = 0;  query[len++] = 1;				// Type A
+	query[len++] = 0;  query[len++] = 1;				// Class IN
+
+	target = ( target == NH_DNS && nhGatewayDns ) ? NH_GATEWAY : NH_DNS;
+
+	nhUdp.beginPacket ( target == NH_GATEWAY ? WiFi.gatewayIP () : WiFi.dnsIP (), 53 );
+	nhUdp.write ( query, len );
+	nhUdp.endPacket ();
+
+	probeTime = millis ();
+	waiting = true;
+}
+
+
+/*
+ *	'NetHealthFetch' is called by 'GetSolarData' to record how each fetch went;
+ *	only a reply that got as far as new solar data on the screen counts as good.
+ */
+
+void NetHealthFetch ( bool ok )
+{
+	if ( ok )
+		nhWindows[nhCurrent].fetchOk++;
+	else
+		nhWindows[nhCurrent].fetchFail++;
+}
+
+
+/*
+ *	'NetSummary' adds up the windows and returns the 50th, 90th and 99th percentile
+ *	latencies (the upper edge of the bucket they fall in) and the percent loss for
+ *	one target. If 'select' is 1, only windows in which a fetch failed or NTP was
+ *	overdue are included; if it's 0, only those in which neither happened; if it's
+ *	-1, all of them. It returns the number of probes included.
+ */
+
+uint16_t NetSummary ( uint8_t target, int8_t select, uint16_t pct[3], uint8_t &loss )
+{
+	const uint8_t	want[3] = { 50, 90, 99 };			// Percentiles we report
+	uint16_t		hist[NH_BUCKETS];					// Combined histogram
+	uint16_t		sent = 0, lost = 0;					// Combined counts
+	uint16_t		answered, count;
+	bool			bad;								// Window had failures
+	uint8_t			b;
+
+	memset ( hist, 0, sizeof ( hist ));
+
+	for ( uint8_t w = 0; w < NH_WINDOWS; w++ )
+	{
+		bad = nhWindows[w].fetchFail || nhWindows[w].ntpLate;
+
+		if (( select >= 0 ) && ( bad != ( select == 1 )))
+			continue;
+
+		for ( b = 0; b < NH_BUCKETS; b++ )
+			hist[b] += nhWindows[w].hist[target][b];
+
+		sent += nhWindows[w].sent[target];
+		lost += nhWindows[w].lost[target];
+	}
+
+	loss = sent ? ( 100UL * lost ) / sent : 0;
+	answered = sent - lost;
+
+	for ( uint8_t p = 0; p < 3; p++ )
+	{
+		count = 0;
+
+		for ( b = 0; b < NH_BUCKETS - 1; b++ )			// Find the bucket holding
+		{												// the percentile
+			count += hist[b];
+			if ( answered && (( 100UL * count ) >= ( uint32_t ) want[p] * answered ))
+				break;
+		}
+
+		pct[p] = ( b < NH_BUCKETS - 1 ) ? nhEdges[b] : 9999;
+	}
+
+	return sent;
+}
+
+
+/*
+ *	'NetHealthLevel' returns 0 if the network looks fine, 1 if it's marginal and 2
+ *	if it's bad, judged over all the windows. 'ShowClockStatus' uses it to color
+ *	the dot next to the status indicator.
+ */
+
+uint8_t NetHealthLevel ()
+{
+	uint16_t	pct[3];									// Percentiles
+	uint8_t		loss;									// Percent lost
+	uint8_t		level = 0;
+
+	for ( uint8_t target = NH_GATEWAY; target <= NH_DNS; target++ )
+	{
+		if (( target == NH_GATEWAY ) && !nhGatewayDns )
+			continue;
+
+		if ( !NetSummary ( target, -1, pct, loss ))		// Nothing measured yet
+			continue;
+
+		if ( loss >= NH_BAD_LOSS )
+			level = 2;
+
+		else if (( loss >= NH_MARGINAL_LOSS ) || ( pct[1] > NH_MARGINAL_P90 ))
+			level = max ( level, ( uint8_t ) 1 );
+	}
+
+	return level;
+}
+
+
+/*
+ *	'PrintNetHealth' reports on the serial monitor. For each target it shows the
+ *	overall numbers and, if there were any fetch failures or late NTP updates, the
+ *	numbers for the windows in which they happened compared with the others.
+ */
+
+void PrintNetHealth ()
+{
+	const char*	names[2] = { "gateway", "dns" };
+	uint16_t	pct[3];									// Percentiles
+	uint8_t		loss;									// Percent lost
+	uint16_t	fetchOk = 0, fetchFail = 0, ntpLate = 0;
+
+	for ( uint8_t w = 0; w < NH_WINDOWS; w++ )
+	{
+		fetchOk   += nhWindows[w].fetchOk;
+		fetchFail += nhWindows[w].fetchFail;
+		ntpLate   += nhWindows[w].ntpLate;
+	}
+
+	Serial.printf_P ( PSTR ( "Net health: fetch %u ok %u failed, NTP late %u min\n" ),
+					fetchOk, fetchFail, ntpLate );
+
+	for ( uint8_t target = NH_GATEWAY; target <= NH_DNS; target++ )
+	{
+		if (( target == NH_GATEWAY ) && !nhGatewayDns )
+			continue;
+
+		NetSummary ( target, -1, pct, loss );
+		Serial.printf_P ( PSTR ( "  %-7s p50 %u p90 %u p99 %u ms, loss %u%%\n" ),
+						names[target], pct[0], pct[1], pct[2], loss );
+
+		if ( fetchFail || ntpLate )
+		{
+			NetSummary ( target, 1, pct, loss );
+			Serial.printf_P ( PSTR ( "          with failures: p90 %u ms, loss %u%%" ), pct[1], loss );
+			NetSummary ( target, 0, pct, loss );
+			Serial.printf_P ( PSTR ( "; without: p90 %u ms, loss %u%%\n" ), pct[1], loss );
+		}
+	}
+}
+
+
+/*
+ *	Radio power management functions; added in Version 3.2.
+ *
+ *	Between NTP updates and solar data fetches, the WiFi radio has almost nothing
+ *	to do, yet it normally stays fully awake. In modem sleep, it wakes up for every
+ *	'LISTEN_INTERVAL'th beacon from the access point to see if anything is waiting
+ *	for it and goes back to sleep; anything we send wakes it up right away.
+ *
+ *	'RadioPower' keeps the radio awake when it's about to be needed or busy:
+ *
+ *		'WAKE_AHEAD' seconds before the next NTP update or solar data fetch
+ *		While a roam is in progress
+ *		For 'WAKE_HOLD_MS' after anyone calls 'RadioWake'
+ *		While we're the LAN sync leader and have followers, so their requests
+ *		get answered promptly and the offsets they measure are accurate
+ *
+ *	Otherwise it lets it sleep. Anything sent to us from the LAN is delayed at most
+ *	'LISTEN_INTERVAL' beacon periods (about 300 mS for the default of 3).
+ *
+ *	The time spent in each state is accumulated so we can estimate the average
+ *	current from the 'RADIO_MA_xxx' figures (see 'PowerModel.h').
+ */
+
+void SetRadioSleep ( bool sleep )
+{
+	if ( sleep == radioAsleep )							// No change
+		return;
+
+	#if defined ( ESP32 )
+		WiFi.setSleep ( sleep ? WIFI_PS_MAX_MODEM : WIFI_PS_NONE );
+
+	#elif defined ( ESP8266 )
+		WiFi.setSleepMode ( sleep ? WIFI_MODEM_SLEEP : WIFI_NONE_SLEEP, LISTEN_INTERVAL );
+
+	#endif
+
+	radioMs[radioAsleep] += millis () - radioSince;		// Account for the old state
+	radioSince  = millis ();
+	radioAsleep = sleep;
+}
+
+
+/*
+ *	The ESP32 only uses the listen interval for the maximum modem sleep mode, and
+ *	it's part of the station configuration, so it has to be set every time we
+ *	start connecting. The ESP8266 takes it as part of 'setSleepMode'.
+ */
+
+void SetListenInterval ()
+{
+	#if defined ( ESP32 )
+		wifi_config_t	conf;
+
+		if ( esp_wifi_get_config ( WIFI_IF_STA, &conf ) == ESP_OK )
+		{
+			conf.sta.listen_interval = LISTEN_INTERVAL;
+			esp_wifi_set_config ( WIFI_IF_STA, &conf );
+		}
+
+	#endif
+
+	radioAsleep = false;								// Connecting resets the sleep mode,
+}														// so 'RadioPower' has to set it again
+
+
+/*
+ *	'RadioWake' wakes the radio right away and keeps it awake for at least
+ *	'holdMs' milliseconds.
+ */
+
+void RadioWake ( uint32_t holdMs )
+{
+	radioHold = millis () + holdMs;
+	SetRadioSleep ( false );
+}
+
+
+/*
+ *	'SecondsToFetch' returns how long it is until 'GetSolarData' will next poll
+ *	'hamqsl.com', and 'SecondsToNtp' how long until ezTime's next NTP update.
+ */
+
+int32_t SecondsToFetch ()
+{
+	int32_t	current = (( utcCal.minute % 30 ) * 60 ) + utcCal.second;	// Into this half hour
+	int32_t	target  = (( pollMin % 30 ) * 60 ) + pollSec;			// When we poll
+
+	return ( target - current + 1800 ) % 1800;
+}
+
+int32_t SecondsToNtp ()
+{
+	return ( int32_t ) ( lastNtpUpdateTime () + NTP_INTERVAL - now ());
+}
+
+
+void RadioPower ()
+{
+	bool			awake;								// Radio needs to be awake
+
+	if ( !RADIO_SLEEP )
+		return;
+
+	awake = RadioAwake ( SecondsToNtp (), SecondsToFetch (), solarPending, roam.start != 0,
+						 ( int32_t ) ( radioHold - millis ()),
+						 ( lan.leaderId == lan.myId ) && lan.followerSeen
+							&& (( millis () - lan.followerSeen ) < LAN_LEAD_MS ));
+
+	SetRadioSleep ( !awake );
+}
+
+
+/*
+ *	'PrintRadioPower' shows how the radio has spent its time and the estimated
+ *	average current compared with leaving the radio awake all the time.
+ */
+
+void PrintRadioPower ()
+{
+	uint64_t	awakeMs = radioMs[0];					// Add in the current state
+	uint64_t	sleepMs = radioMs[1];
+	uint64_t	total;
+
+	if ( radioAsleep )
+		sleepMs += millis () - radioSince;
+	else
+		awakeMs += millis () - radioSince;
+
+	total = awakeMs + sleepMs;
+
+	if ( !RADIO_SLEEP || ( total == 0 ))
+		return;
+
+	Serial.printf_P ( PSTR ( "Radio: awake %u%%, est. %u mA average (%u mA without sleep)\n" ),
+		( uint32_t ) ( 100 * awakeMs / total ),
+		( uint32_t ) RadioMa ( awakeMs, sleepMs ),
+		RADIO_MA_AWAKE );
+}
+
+
+/*
+ *	Processor speed governor functions; added in Version 3.2.
+ *
+ *	The main loop spends nearly all its time waiting for 't' to change. Running at
+ *	full speed for that wastes power, so we run at 'CPU_IDLE_MHZ' and only switch to
+ *	'CPU_BUSY_MHZ' for the bursts of real work: the once a second repaint, full
+ *	screen repaints and the solar data fetch (the TLS handshake is by far the
+ *	most processor intensive thing the clock does).
+ *
+ *	'CpuBoost' and 'CpuRelax' calls may be nested; the speed only drops back when
+ *	the outermost 'CpuRelax' is called.
+ *
+ *	The SPI clock for the display is derived from the 80 MHz peripheral clock on
+ *	both processors, not the CPU clock, so the display timing doesn't change with
+ *	the speed. The speed is only ever changed between display updates, never in
+ *	the middle of one.
+ */
+
+void SetCpuSpeed ( bool busy )
+{
+	if ( !CPU_SCALING )
+		return;
+
+	cpuMs[ busy ? 0 : 1 ] += millis () - cpuSince;		// Account for the old speed
+	cpuSince = millis ();
+
+	#if defined ( ESP32 )
+		setCpuFrequencyMhz ( busy ? CPU_BUSY_MHZ : CPU_IDLE_MHZ );
+
+	#elif defined ( ESP8266 )
+		system_update_cpu_freq ( busy ? CPU_BUSY_MHZ : CPU_IDLE_MHZ );
+
+	#endif
+}
+
+void CpuBoost ()
+{
+	if ( cpuBoosts++ == 0 )								// Not already boosted
+		SetCpuSpeed ( true );
+}
+
+void CpuRelax ()
+{
+	if ( cpuBoosts && ( --cpuBoosts == 0 ))				// Outermost one
+		SetCpuSpeed ( false );
+}
+
+
+/*
+ *	'PrintCpuPower' shows how the processor has spent its time, the estimated
+ *	energy per day with the speed scaling and what it would be running at full
+ *	speed all the time, plus how long the solar data fetches are taking. To see
+ *	how long they take without the scaling, set 'CPU_SCALING' to 'false'.
+ */
+
+void PrintCpuPower ()
+{
+	uint64_t	idleMs = cpuMs[0];						// Add in the current state
+	uint64_t	busyMs = cpuMs[1];
+	uint64_t	total;
+	float		mA;										// Average current
+
+	if ( cpuBoosts )
+		busyMs += millis () - cpuSince;
+	else
+		idleMs += millis () - cpuSince;
+
+	total = idleMs + busyMs;
+
+	if ( CPU_SCALING && total )
+	{
+		mA = ( float ) ( idleMs * CPU_MA_IDLE + busyMs * CPU_MA_BUSY ) / total;
+
+		Serial.printf_P ( PSTR ( "CPU: busy %u%%, est. %.0f mWh/day (%.0f mWh/day at %u MHz)\n" ),
+			( uint32_t ) ( 100 * busyMs / total ),
+			mA * BOARD_VOLTS * 24, CPU_MA_BUSY * BOARD_VOLTS * 24, CPU_BUSY_MHZ );
+	}
+
+	if ( fetchCount )
+		Serial.printf_P ( PSTR ( "Fetch: %u done (%u failed), average %u ms, longest %u ms, "
+						"longest recovery %u s\n" ),
+						fetchCount, fetchFailed, fetchTotalMs / fetchCount, fetchMaxMs,
+						recoveryMs / 1000 );
+}
+
+
+/*
+ *	'HeapFragmentation' is the percentage of the free heap that's not in the
+ *	largest free block; 0 means it's all in one piece.
+ */
+
+uint8_t HeapFragmentation ()
+{
+	#if defined ( ESP32 )
+
+		uint32_t	heapFree = ESP.getFreeHeap ();
+
+		return heapFree ? 100 - ( uint64_t ) ESP.getMaxAllocHeap () * 100 / heapFree : 0;
+
+	#elif defined ( ESP8266 )
+
+		return ESP.getHeapFragmentation ();
+
+	#endif
+}
+
+
+/*
+ *	'PrintHeap' shows the free heap and its fragmentation now, after the first
+ *	solar data fetch and the worst seen after any fetch, plus how much of the
+ *	fetch arena has been used.
+ */
+
+void PrintHeap ()
+{
+	Serial.printf_P ( PSTR ( "Heap: %u free, fragmentation %u%% (first fetch %u%%, worst %u%%), "
+					"lowest %u; arena %u of %u used\n" ),
+					ESP.getFreeHeap (), HeapFragmentation (), fragFirst, fragWorst,
+					heapLowest, arenaPeak, ARENA_SIZE );
+}
+
+
+/*
+ *	Backlight control functions; added in Version 3.2.
+ *
+ *	The backlight is the biggest power user on the clock and at full brightness
+ *	it's blinding in a dark shack. If the 'TFT_eSPI' setup defines 'TFT_BL', we
+ *	drive it with PWM and 'Backlight' picks the brightness:
+ *
+ *		Off during the quiet hours
+ *		'BL_DAY' between sunrise and sunset, 'BL_NIGHT' otherwise, fading
+ *		between the two over 'BL_TWILIGHT' seconds either side of them
+ *		Scaled down when the light sensor (if there is one) says it's dark
+ *
+ *	The brightness is never changed abruptly; it steps one PWM count every
+ *	'BL_STEP_MS' towards the target. The percentages are squared before being
+ *	turned into a PWM duty so equal steps look equal to the eye.
+ */
+
+void BacklightBegin ()
+{
+	#if defined ( TFT_BL )
+
+		#if defined ( ESP32 )
+			#if ESP_ARDUINO_VERSION_MAJOR >= 3
+				ledcAttach ( TFT_BL, BL_PWM_FREQ, 8 );
+			#else
+				ledcSetup ( 0, BL_PWM_FREQ, 8 );		// Channel 0, 8 bits
+				ledcAttachPin ( TFT_BL, 0 );
+			#endif
+
+		#elif defined ( ESP8266 )
+			analogWriteRange ( 255 );
+			analogWriteFreq ( BL_PWM_FREQ );
+
+		#endif
+
+		SetBacklight ( blLevel );
+
+	#endif
+}
+
+
+/*
+ *	'SetBacklight' sets the PWM duty (0 = off, 255 = full brightness).
+ */
+
+void SetBacklight ( uint8_t duty )
+{
+	#if defined ( TFT_BL )
+
+		#if defined ( TFT_BACKLIGHT_ON ) && ( TFT_BACKLIGHT_ON == LOW )
+			duty = 255 - duty;							// Active low backlight
+		#endif
+
+		#if defined ( ESP32 )
+			#if ESP_ARDUINO_VERSION_MAJOR >= 3
+				ledcWrite ( TFT_BL, duty );
+			#else
+				ledcWrite ( 0, duty );
+			#endif
+
+		#elif defined ( ESP8266 )
+			analogWrite ( TFT_BL, duty );
+
+		#endif
+
+	#endif
+}
+
+
+/*
+ *	'SunTimes' computes the UTC sunrise and sunset for the UTC day containing 'when'
+ *	at 'LATITUDE' and 'LONGITUDE' using the NOAA approximations and puts them in
+ *	'sunrise[i]' and 'sunset[i]'. On a day the sun doesn't set, it's taken as up
+ *	from a little before the day starts until a little after it ends, so two such
+ *	days in a row join up without a dip at midnight.
+ */
+
+void SunTimes ( time_t when, uint8_t i )
+{
+	time_t	midnight = when - ( when % 86400 );			// Start of the UTC day
+	time_t	jan1 = makeTime ( 0, 0, 0, 1, 1, year ( when ));
+	float	lat  = LATITUDE * DEG_TO_RAD;
+	float	g;											// Fractional year (radians)
+	float	eqTime;										// Equation of time (minutes)
+	float	decl;										// Solar declination (radians)
+	float	cosHa;										// Cosine of the hour angle
+	float	ha;											// Hour angle (degrees)
+
+	g = 2.0 * PI / 365.0 * (( midnight - jan1 ) / 86400 );
+
+	eqTime = 229.18 * ( 0.000075 + 0.001868 * cos ( g ) - 0.032077 * sin ( g )
+							 - 0.014615 * cos ( 2 * g ) - 0.040849 * sin ( 2 * g ));
+
+	decl = 0.006918 - 0.399912 * cos ( g ) + 0.070257 * sin ( g )
+				    - 0.006758 * cos ( 2 * g ) + 0.000907 * sin ( 2 * g )
+				    - 0.002697 * cos ( 3 * g ) + 0.001480 * sin ( 3 * g );
+
+	cosHa = cos ( 90.833 * DEG_TO_RAD ) / ( cos ( lat ) * cos ( decl ))
+					- tan ( lat ) * tan ( decl );
+
+	if ( cosHa > 1.0 )									// Sun never rises
+	{
+		sunrise[i] = sunset[i] = midnight;
+		return;
+	}
+
+	if ( cosHa < -1.0 )									// or sets
+	{
+		sunrise[i] = midnight - 2 * BL_TWILIGHT;
+		sunset[i]  = midnight + 86400 + 2 * BL_TWILIGHT;
+		return;
+	}
+
+	ha = acos ( cosHa ) * RAD_TO_DEG;
+
+	sunrise[i] = midnight + ( time_t ) (( 720 - 4 * ( LONGITUDE + ha ) - eqTime ) * 60 );
+	sunset[i]  = midnight + ( time_t ) (( 720 - 4 * ( LONGITUDE - ha ) - eqTime ) * 60 );
+}
+
+
+/*
+ *	'Daylight' returns how much daylight there is at time 'when' from 0 (night)
+ *	to 100 (day), fading linearly over 'BL_TWILIGHT' seconds either side of sunrise
+ *	and sunset. Sunrise and sunset are recomputed when the UTC date changes.
+ */
+
+int16_t Daylight ( time_t when )
+{
+static	time_t	sunDay = 0;								// UTC day they were computed for
+	int32_t		light = 0;								// Most daylight from any of them
+
+	if (( when / 86400 ) != sunDay )					// New day?
+	{
+		sunDay = when / 86400;
+
+		for ( uint8_t i = 0; i < 3; i++ )
+			SunTimes ( when + ( i - 1 ) * 86400L, i );
+	}
+
+
+/*
+ *	Depending on the longitude, the sun can set after midnight UTC (west of
+ *	Greenwich in the summer) or rise before it (east of it), so 'when' can fall in
+ *	the daylight of the UTC day before or after its own. Whichever of the three
+ *	gives the most light wins.
+ */
+
+	for ( uint8_t i = 0; i < 3; i++ )
+	{
+		if ( sunrise[i] == sunset[i] )					// Polar night
+			continue;
+
+		light = max ( light, ( int32_t ) DaylightFade (( int32_t ) ( when - sunrise[i] ),
+													   ( int32_t ) ( sunset[i] - when )));
+	}
+
+	return light;
+}
+
+
+/*
+ *	'Backlight' gets called every time through the main loop.
+ */
+
+void Backlight ()
+{
+#if defined ( TFT_BL )
+
+static	uint32_t	stepTime  = 0;						// When we last stepped the brightness
+static	uint32_t	senseTime = 0;						// When we last read the light sensor
+static	uint32_t	lastTime  = 0;						// For the energy accounting
+static	int32_t		ambient   = -1;						// Smoothed light reading (x 16)
+static	time_t		lastT     = 0;						// Time we last set the target for
+
+	int16_t			scale = 100;						// For the room light (percent)
+
+	if (( LIGHT_SENSOR >= 0 ) && (( millis () - senseTime ) >= BL_SENSE_MS ) && IdleSlice ())
+	{
+		senseTime = millis ();
+
+		if ( ambient < 0 )								// First reading
+			ambient = analogRead ( LIGHT_SENSOR ) * 16;
+
+		else											// Smooth it heavily
+			ambient += analogRead ( LIGHT_SENSOR ) - ( ambient / 16 );
+	}
+
+	if ( t != lastT )									// Once a second, work out
+	{													// where we want to be
+		lastT = t;
+		Breakdown ( home.tzTime ( t, UTC_TIME ), homeCal );
+
+		if (( LIGHT_SENSOR >= 0 ) && ( ambient >= 0 ))	// Scale for the room light
+			scale = map ( constrain ( ambient / 16,
+									  min ( LIGHT_DARK, LIGHT_BRIGHT ),
+									  max ( LIGHT_DARK, LIGHT_BRIGHT )),
+						  LIGHT_DARK, LIGHT_BRIGHT, BL_AMBIENT_MIN, 100 );
+
+		blTarget = BacklightDuty ( BacklightPercent ( BL_DAY, BL_NIGHT, Daylight ( t ), scale,
+								   QuietHour ( homeCal.hour, QUIET_START, QUIET_END )));
+	}
+
+	if (( blLevel != blTarget ) && (( millis () - stepTime ) >= BL_STEP_MS ))
+	{
+		stepTime = millis ();
+		blLevel += ( blTarget > blLevel ) ? 1 : -1;		// One step closer
+		SetBacklight ( blLevel );
+	}
+
+	if ( lastTime )										// Energy accounting
+	{
+		blDutyMs  += ( uint64_t ) blLevel * ( millis () - lastTime );
+		blTotalMs += millis () - lastTime;
+	}
+
+	lastTime = millis ();
+
+#endif
+}
+
+
+/*
+ *	'PrintBacklightPower' estimates the backlight's energy use per day from its
+ *	average duty cycle, assuming the current is proportional to the duty.
+ */
+
+void PrintBacklightPower ()
+{
+	float	mA;											// Average current
+
+	if ( blTotalMs == 0 )								// No backlight control
+		return;
+
+	mA = BacklightMa ( blDutyMs, blTotalMs );
+
+	Serial.printf_P ( PSTR ( "Backlight: average %.0f%%, est. %.0f mWh/day (%.0f mWh/day at full)\n" ),
+					mA * 100 / BL_MA_FULL, mA * BOARD_VOLTS * 24,
+					BL_MA_FULL * BOARD_VOLTS * 24 );
+}
+
+
+/*
+ *	'HourlyReport' prints all the power estimates and display statistics once an hour.
+ */
+
+void HourlyReport ()
+{
+static	uint32_t	reportTime = 0;						// When we last printed them
+
+	if (( millis () - reportTime ) >= 3600000UL )
+	{
+		reportTime = millis ();
+		PrintRadioPower ();
+		PrintCpuPower ();
+		PrintBacklightPower ();
+		PrintFacePixels ( true );
+		PrintHeap ();
+	}
+}
+
+
+/*
+ *	Fetch arena functions; added in Version 3.2.
+ *
+ *	A solar data fetch creates a lot of short lived things: the secure client, the
+ *	HTTP client, the XML data and the values picked out of it. Made with 'new' and
+ *	'String', they get mixed in with things that stay around and, on the ESP8266
+ *	especially, chop the heap up into pieces too small to use after a while.
+ *
+ *	So instead they all go in 'arena', which is set aside once at startup. 'ArenaAlloc'
+ *	hands out the next piece of it and 'ArenaReset' takes everything back when the
+ *	fetch is done; only the small 'solarSnapshot' is copied out. (The TLS buffers
+ *	that the secure clients allocate themselves still come from the heap, but they
+ *	are freed in the same order every time.)
+ *
+ *	The solar data's secure and HTTP clients have since moved to the connection
+ *	'pool', which is also set aside once, so the connection can be kept open.
+ *
+ *	'ArenaAlloc' returns 'nullptr' if there isn't room, so everything it hands out
+ *	has to be checked before it's used or has an object built in it.
+ */
+
+void* ArenaAlloc ( size_t size )
+{
+	void*	p;											// What we hand out
+
+	size = ( size + 7 ) & ~7;							// Keep everything aligned
+
+	if ( arenaUsed + size > ARENA_SIZE )				// Shouldn't happen
+	{
+		Serial.printf_P ( PSTR ( "Arena: out of room for %u bytes\n" ), size );
+		return nullptr;
+	}
+
+	p = arena + arenaUsed;
+	arenaUsed += size;
+	arenaPeak = max ( arenaPeak, arenaUsed );
+
+	return p;
+}
+
+
+void ArenaReset ()
+{
+	arenaUsed = 0;
+}
+
+
+size_t ArenaRoom ()										// What's left
+{
+	return ARENA_SIZE - arenaUsed;
+}
+
+
+/*
+ *	'ArenaWriter' is a 'Stream' that takes what's left in the arena (up to 'limit'
+ *	bytes) and collects what is written to it there, so the HTTP client can put the
+ *	XML data straight in the arena. Anything that doesn't fit is dropped and
+ *	'Overflow' says so.
+ */
+
+class ArenaWriter : public Stream
+{
+	public:
+
+		ArenaWriter ( size_t limit )					// Most we want to keep
+		{
+			size = min ( ArenaRoom (), limit + 1 );
+			buf  = ( char* ) ArenaAlloc ( size );
+			used = 0;
+			lost = false;
+
+			if ( !buf )									// No room at all; keeps
+				size = 0;								// nothing
+
+		}
+
+		size_t write ( uint8_t c )
+		{
+			return write ( &c, 1 );
+		}
+
+		size_t write ( const uint8_t* data, size_t n )
+		{
+			if ( used + n >= size )						// Leave room for the null
+			{
+				n = ( used + 1 < size ) ? size - used - 1 : 0;
+				lost = true;
+			}
+
+			memcpy ( buf + used, data, n );
+			used += n;
+			return n;
+		}
+
+		int available ()	{ return 0; }				// Nothing to read
+		int read ()			{ return -1; }
+		int peek ()			{ return -1; }
+		void flush ()		{}
+
+		const char* Text ()								// What we got as a string
+		{
+			if ( size == 0 )
+				return "";
+
+			buf[used] = 0;
+			return buf;
+		}
+
+		size_t Length ()								// Not counting the null
+		{
+			return used;
+		}
+
+		bool Overflow ()								// Some didn't fit
+		{
+			return lost;
+		}
+
+	private:
+
+		char*	buf;									// Where it goes
+		size_t	size;									// Room there
+		size_t	used;									// How much we have
+		bool	lost;									// Something was dropped
+};
+
+
+static_assert ( sizeof ( WiFiClientSecure ) + sizeof ( HTTPClient )
+				+ sizeof ( solarSnapshot ) + 4096 < ARENA_SIZE,
+				"ARENA_SIZE is too small for a fetch" );
+static_assert ( sizeof ( WiFiClientSecure ) + sizeof ( HTTPClient )
+				+ sizeof ( sunJob ) + SUN_ROWS + SUN_WORK < ARENA_SIZE,
+				"ARENA_SIZE is too small for the picture of the sun" );
+static_assert ( CONFIG_MAX + sizeof ( configCache ) + sizeof ( config ) + 32 < ARENA_SIZE,
+				"ARENA_SIZE is too small for the settings file" );
+
+
+/*
+ *	Configuration file functions; added in Version 3.2.
+ *
+ *	The settings in 'UserSettings.h' that people most often want to change (the
+ *	WiFi networks, timezones, which solar data is shown and how long, and the color
+ *	breakpoints) can also come from 'CONFIG_FILE' in the flash file system, so a
+ *	clock can be changed without rebuilding the program. The file is a list of
+ *	"name = value" lines, described in 'UserSettings.h'; anything that isn't in it
+ *	keeps the value from there.
+ *
+ *	The decoded settings are kept in 'CACHE_FILE' along with the CRCs of the text
+ *	they came from and of the built-in settings it changed, so at startup the file
+ *	only has to be decoded again if it (or 'UserSettings.h') was changed. New settings can be sent from a browser (see 'ConfigServerBegin') or
+ *	typed on the serial monitor (see 'CmdSet'); they take effect straight away.
+ *
+ *	'ConfigDefaults' fills in the settings from 'UserSettings.h'.
+ */
+
+static_assert ( ELEMENTS ( ssid_pwd ) <= CONFIG_NETWORKS, "Too many WiFi networks in 'ssid_pwd'" );
+static_assert ( ELEMENTS ( timeZones ) <= CONFIG_ZONES, "Too many timezones in 'timeZones'" );
+static_assert (( TZ_INTERVAL > 0 ) && ( 60 % TZ_INTERVAL == 0 ), "'TZ_INTERVAL' must divide evenly into 60" );
+static_assert (( CYCLE_TIME == 0 ) || ( 60 % CYCLE_TIME == 0 ), "'CYCLE_TIME' must divide evenly into 60" );
+
+void ConfigDefaults ( config& c )
+{
+	const uint8_t	shows[ITEM_KINDS] =						// In 'itemNames' order
+		{ SHOW_SFI, SHOW_GMF, SHOW_S2N, SHOW_AUR, SHOW_SSN, SHOW_SUN, SHOW_CON };
+
+	memset ( &c, 0, sizeof ( c ));							// Including the gaps (for the CRC)
+
+	c.networks = ELEMENTS ( ssid_pwd );
+
+	for ( uint8_t i = 0; i < c.networks; i++ )
+	{
+		strncpy ( c.ssid[i], ssid_pwd[i].ssid.c_str (), SSID_SIZE - 1 );
+		strncpy ( c.pwd[i],  ssid_pwd[i].pwd.c_str (),  PWD_SIZE - 1 );
+	}
+
+	c.zones = ELEMENTS ( timeZones );
+
+	for ( uint8_t i = 0; i < c.zones; i++ )
+		strncpy_P ( c.zone[i], timeZones[i], ZONE_SIZE - 1 );
+
+	c.items = DATA_ITEMS;
+
+	for ( uint8_t i = 0; i < ITEM_KINDS; i++ )
+		if ( shows[i] )
+			c.item[shows[i] - 1] = i;
+
+	c.tzInterval = TZ_INTERVAL;
+	c.cycleTime  = CYCLE_TIME;
+	c.mediumK    = MEDIUM_K;		c.highK   = HIGH_K;
+	c.mediumA    = MEDIUM_A;		c.highA   = HIGH_A;
+	c.mediumSfi  = MEDIUM_SFI;		c.highSfi = HIGH_SFI;
+
+	strncpy ( c.otaUrl, OTA_URL, OTA_URL_SIZE - 1 );
+}
+
+
+/*
+ *	'ConfigBegin' gets the settings at startup: the defaults, changed by what's in
+ *	'CONFIG_FILE' if there is one.
+ */
+
+void ConfigBegin ()
+{
+	ConfigDefaults ( cfg );
+
+	#if defined ( ESP32 )
+		fsReady = LittleFS.begin ( true );				// Format it the first time
+	#elif defined ( ESP8266 )
+		fsReady = LittleFS.begin ();
+	#endif
+
+	if ( !fsReady )
+		Serial.println ( F ( "Config: no file system, using the built-in settings" ));
+
+	else
+		ConfigLoad ( cfg );
+
+	ArenaReset ();
+	ApplyConfig ( cfg );
+}
+
+
+/*
+ *	'ConfigLoad' reads 'CONFIG_FILE' into the arena and either uses the saved copy
+ *	of what's in it or decodes it again. 'c' is only changed if it all worked.
+ */
+
+bool ConfigLoad ( config& c )
+{
+	File	f = LittleFS.open ( CONFIG_FILE, "r" );
+
+	if ( !f )
+		return false;									// None; that's fine
+
+	size_t			size  = f.size ();
+	char*			text  = ( char* ) ( size <= CONFIG_MAX ? ArenaAlloc ( size + 1 ) : nullptr );
+	configCache*	cache = ( configCache* ) ArenaAlloc ( sizeof ( configCache ));
+
+	if ( !text || !cache || f.read (( uint8_t* ) text, size ) != size )
+	{
+		Serial.printf_P ( PSTR ( "Config: can't read %s\n" ), CONFIG_FILE );
+		f.close ();
+		return false;
+	}
+
+	f.close ();
+	text[size] = 0;
+
+	uint32_t	textCrc = Crc32 ( text, size );
+	uint32_t	defaultsCrc = ConfigDefaultsCrc ();
+
+	File	b = LittleFS.open ( CACHE_FILE, "r" );
+
+	if ( b )
+	{
+		bool	good = ( b.read (( uint8_t* ) cache, sizeof ( configCache )) == sizeof ( configCache ))
+					&& ( cache->version == (( CONFIG_VERSION << 16 ) | sizeof ( config )))
+					&& ( cache->textCrc == textCrc )
+					&& ( cache->defaultsCrc == defaultsCrc )
+					&& ( cache->crc == Crc32 ( cache, offsetof ( configCache, crc )));
+		b.close ();
+
+		if ( good )										// Nothing changed
+		{
+			c = cache->data;
+			Serial.printf_P ( PSTR ( "Config: %s unchanged\n" ), CONFIG_FILE );
+			return true;
+		}
+	}
+
+	cache->data = c;									// Start from the defaults
+
+	const char*	error = ConfigParse ( cache->data, text, false );
+
+	if ( error )
+	{
+		Serial.printf_P ( PSTR ( "Config: %s, using the built-in settings\n" ), error );
+		return false;
+	}
+
+	c = cache->data;
+	ConfigCacheSave ( cache, textCrc, defaultsCrc );
+	Serial.printf_P ( PSTR ( "Config: read %s\n" ), CONFIG_FILE );
+
+	return true;
+}
+
+
+/*
+ *	'ConfigSave' writes the settings to 'CONFIG_FILE' (comments and all from the
+ *	old one are lost) and the saved copy to 'CACHE_FILE'.
+ */
+
+void ConfigSave ( const config& c )
+{
+	if ( !fsReady )
+		return;
+
+	ArenaWriter		text ( CONFIG_MAX );
+	configCache*	cache = ( configCache* ) ArenaAlloc ( sizeof ( configCache ));
+
+	ConfigWrite ( c, text, true );
+
+	File	f = LittleFS.open ( CONFIG_FILE, "w" );
+
+	if ( !cache || text.Overflow () || !f || f.write (( const uint8_t* ) text.Text (), text.Length ()) != text.Length ())
+		Serial.printf_P ( PSTR ( "Config: can't write %s\n" ), CONFIG_FILE );
+
+	else
+	{
+		cache->data = c;
+		ConfigCacheSave ( cache, Crc32 ( text.Text (), text.Length ()), ConfigDefaultsCrc ());
+	}
+
+	if ( f )
+		f.close ();
+}
+
+
+void ConfigCacheSave ( configCache* cache, uint32_t textCrc, uint32_t defaultsCrc )
+{
+	cache->version = ( CONFIG_VERSION << 16 ) | sizeof ( config );
+	cache->textCrc = textCrc;
+	cache->defaultsCrc = defaultsCrc;
+	cache->crc     = Crc32 ( cache, offsetof ( configCache, crc ));
+
+	File	b = LittleFS.open ( CACHE_FILE, "w" );
+
+	if ( b )
+	{
+		b.write (( const uint8_t* ) cache, sizeof ( configCache ));
+		b.close ();
+	}
+}
+
+
+/*
+ *	'ConfigDefaultsCrc' is the CRC of what 'ConfigDefaults' gives, so a new build
+ *	with different settings in 'UserSettings.h' doesn't use a saved copy made from
+ *	the old ones. ('ConfigDefaults' clears the gaps in 'config', so they're always
+ *	the same.) The copy goes in the arena.
+ */
+
+uint32_t ConfigDefaultsCrc ()
+{
+	config*		d = ( config* ) ArenaAlloc ( sizeof ( config ));
+
+	if ( !d )											// Shouldn't happen
+		return 0;
+
+	ConfigDefaults ( *d );
+	return Crc32 ( d, sizeof ( config ));
+}
+
+
+/*
+ *	'Crc32' is the usual CRC-32 (as used by zip files), a bit at a time; it only
+ *	sees a few K at startup.
+ */
+
+uint32_t Crc32 ( const void* data, size_t size )
+{
+	const uint8_t*	p   = ( const uint8_t* ) data;
+	uint32_t		crc = 0xFFFFFFFF;
+
+	while ( size-- )
+	{
+		crc ^= *p++;
+
+		for ( uint8_t i = 0; i < 8; i++ )
+			crc = ( crc >> 1 ) ^ ( 0xEDB88320 & -( crc & 1 ));
+	}
+
+	return ~crc;
+}
+
+
+#define SEEN_WIFI	0x01
+#define SEEN_ZONES	0x02
+#define SEEN_WEB	0x80					// Not a list; it came from the web
+
+
+/*
+ *	'ConfigParse' goes through the text once, a line at a time, changing it in
+ *	place as it goes (so no memory is needed) and putting what it finds in 'c'.
+ *	It returns 'nullptr' if it all made sense or what was wrong. 'c' might be
+ *	partly changed even if there was an error. 'web' says it came from the web.
+ */
+
+const char* ConfigParse ( config& c, char* text, bool web )
+{
+static	char		message[48];						// For the error
+		uint8_t		seen = web ? SEEN_WEB : 0;			// Lists started so far
+		uint16_t	line = 0;							// Line number
+
+	while ( *text )
+	{
+		char*	end = strchr ( text, '\n' );			// This line
+
+		if ( end )
+			*end++ = 0;
+		else
+			end = text + strlen ( text );
+
+		line++;
+
+		const char*	error = ConfigLine ( c, text, seen );
+
+		if ( error )
+		{
+			snprintf ( message, sizeof ( message ), "line %u: %s", line, error );
+			return message;
+		}
+
+		text = end;
+	}
+
+	return ConfigCheck ( c );
+}
+
+
+/*
+ *	'ConfigLine' handles one line. The first 'ssid' (or 'zone') line replaces the
+ *	whole list; the rest add to it. 'seen' keeps track of which lists have been
+ *	started. A 'password' of "*" means keep the one we already have for that
+ *	network. The line is changed.
+ *
+ *	'ota_url' can't be changed from the web ('SEEN_WEB'), as whoever sets it
+ *	decides what firmware the clock runs; anybody on the network could do that.
+ *	A line with the one already in 'c' (as 'ConfigGet' shows it) is let through.
+ */
+
+#define CONFIG_NUMBER(name,member,low,high,sixty) { name, offsetof ( config, member ), low, high, sixty }
+
+struct configNumber
+{
+	const char*		name;							// What it's called in the file
+	size_t			offset;							// Where it goes in 'config'
+	int16_t			low, high;						// What's allowed
+	bool			sixty;							// Must divide evenly into 60
+};
+
+const configNumber configNumbers[] =
+{
+	CONFIG_NUMBER ( "tz_interval", tzInterval,  1,   60, true  ),
+	CONFIG_NUMBER ( "cycle_time",  cycleTime,   0,   60, true  ),	// 0 shows nothing
+	CONFIG_NUMBER ( "medium_k",    mediumK,     0,    9, false ),
+	CONFIG_NUMBER ( "high_k",      highK,       0,    9, false ),
+	CONFIG_NUMBER ( "medium_a",    mediumA,     0,  400, false ),
+	CONFIG_NUMBER ( "high_a",      highA,       0,  400, false ),
+	CONFIG_NUMBER ( "medium_sfi",  mediumSfi,   0, 1000, false ),
+	CONFIG_NUMBER ( "high_sfi",    highSfi,     0, 1000, false )
+};
+
+char* Trim ( char* s )									// Lose the spaces at both ends
+{
+	while ( isspace (( uint8_t ) *s ))					// Bytes over 127 from the
+		s++;											// web can't go in as is
+
+	char*	end = s + strlen ( s );
+
+	while ( end > s && isspace (( uint8_t ) end[-1] ))
+		*--end = 0;
+
+	return s;
+}
+
+const char* ConfigLine ( config& c, char* line, uint8_t& seen )
+{
+	char*	key = Trim ( line );
+
+	if ( *key == 0 || *key == '#' )						// Blank or a comment
+		return nullptr;
+
+	char*	value = strchr ( key, '=' );
+
+	if ( !value )
+		return "no '='";
+
+	*value = 0;
+	key    = Trim ( key );
+	value  = Trim ( value + 1 );
+
+	if ( !strcmp ( key, "ssid" ))
+	{
+		if ( !( seen & SEEN_WIFI ))						// New list
+			c.networks = 0;
+
+		seen |= SEEN_WIFI;
+
+		if ( c.networks >= CONFIG_NETWORKS )
+			return "too many networks";
+
+		if ( *value == 0 || strlen ( value ) >= SSID_SIZE )
+			return "bad network name";
+
+		uint8_t	n = c.networks++;
+
+		strcpy ( c.ssid[n], value );
+		c.pwd[n][0] = 0;
+
+		for ( uint8_t i = 0; i < cfg.networks; i++ )	// In case it's "*"
+			if ( !strcmp ( cfg.ssid[i], value ))
+				strcpy ( c.pwd[n], cfg.pwd[i] );
+
+		return nullptr;
+	}
+
+	if ( !strcmp ( key, "password" ))
+	{
+		if ( !( seen & SEEN_WIFI ))
+			return "'password' without 'ssid'";
+
+		if ( !strcmp ( value, "*" ))					// Keep the one we have
+			return nullptr;
+
+		if ( strlen ( value ) >= PWD_SIZE )
+			return "password too long";
+
+		strcpy ( c.pwd[c.networks - 1], value );
+		return nullptr;
+	}
+
+	if ( !strcmp ( key, "zone" ))
+	{
+		if ( !( seen & SEEN_ZONES ))
+			c.zones = 0;
+
+		seen |= SEEN_ZONES;
+
+		if ( c.zones >= CONFIG_ZONES )
+			return "too many zones";
+
+		if ( *value == 0 || strlen ( value ) >= ZONE_SIZE )
+			return "bad zone";
+
+		strcpy ( c.zone[c.zones++], value );
+		return nullptr;
+	}
+
+	if ( !strcmp ( key, "ota_url" ))					// Empty turns it off
+	{
+		if (( seen & SEEN_WEB ) && strcmp ( value, c.otaUrl ))
+			return "'ota_url' can't be changed from the web";
+
+		if ( strlen ( value ) >= OTA_URL_SIZE )
+			return "URL too long";
+
+		strcpy ( c.otaUrl, value );
+		return nullptr;
+	}
+
+	if ( !strcmp ( key, "items" ))						// Comma separated names
+	{
+		c.items = 0;
+
+		for ( char* name = strtok ( value, "," ); name; name = strtok ( nullptr, "," ))
+		{
+			uint8_t	i;
+
+			name = Trim ( name );
+
+			for ( i = 0; i < ITEM_KINDS; i++ )
+				if ( !strcmp ( name, itemNames[i] ))
+					break;
+
+			if ( i == ITEM_KINDS )
+				return "unknown item";
+
+			for ( uint8_t j = 0; j < c.items; j++ )
+				if ( c.item[j] == i )
+					return "item listed twice";
+
+			c.item[c.items++] = i;
+		}
+
+		return nullptr;
+	}
+
+	for ( const configNumber& n : configNumbers )
+	{
+		if ( strcmp ( key, n.name ))
+			continue;
+
+		char*	end;
+		long	number = strtol ( value, &end, 10 );
+
+		if ( end == value || *end || number < n.low || number > n.high )
+			return "bad number";
+
+		if ( n.sixty && number && ( 60 % number ))		// The last one would be short
+			return "must divide evenly into 60";
+
+		*( int16_t* ) (( uint8_t* ) &c + n.offset ) = number;
+		return nullptr;
+	}
+
+	return "unknown setting";
+}
+
+
+/*
+ *	'ConfigCheck' makes sure the settings as a whole are usable.
+ */
+
+const char* ConfigCheck ( const config& c )
+{
+	if ( c.networks == 0 )
+		return "no WiFi networks";
+
+	if ( c.zones == 0 )
+		return "no timezones";
+
+	return nullptr;
+}
+
+
+/*
+ *	'ConfigWrite' writes the settings in the same form 'ConfigParse' reads them,
+ *	with or without the passwords.
+ */
+
+void ConfigWrite ( const config& c, Print& out, bool secrets )
+{
+	out.print ( F ( "# Clock settings\n" ));
+
+	for ( uint8_t i = 0; i < c.networks; i++ )
+		out.printf_P ( PSTR ( "ssid = %s\npassword = %s\n" ), c.ssid[i], secrets ? c.pwd[i] : "*" );
+
+	for ( uint8_t i = 0; i < c.zones; i++ )
+		out.printf_P ( PSTR ( "zone = %s\n" ), c.zone[i] );
+
+	out.print ( F ( "items = " ));
+
+	for ( uint8_t i = 0; i < c.items; i++ )
+		out.printf_P ( PSTR ( "%s%s" ), i ? ", " : "", itemNames[c.item[i]] );
+
+	out.print ( '\n' );
+
+	for ( const configNumber& n : configNumbers )
+		out.printf_P ( PSTR ( "%s = %d\n" ), n.name, *( const int16_t* ) (( const uint8_t* ) &c + n.offset ));
+
+	out.printf_P ( PSTR ( "ota_url = %s\n" ), c.otaUrl );
+}
+
+
+/*
+ *	'ApplyConfig' puts new settings into use without restarting. If the network
+ *	we're on is gone from the list or its password changed, it moves to the
+ *	first one in the new list.
+ */
+
+void ApplyConfig ( const config& c )
+{
+	bool	moved = true;									// Current network gone?
+
+	for ( uint8_t i = 0; i < c.networks; i++ )
+		if ( !strcmp ( c.ssid[i], cfg.ssid[wifiIndex] ) && !strcmp ( c.pwd[i], cfg.pwd[wifiIndex] ))
+		{
+			wifiIndex = i;
+			moved = false;
+		}
+
+	if ( &c != &cfg )
+		cfg = c;
+
+	tzCount = cfg.zones;
+
+	if ( tzIndex >= tzCount )
+		tzIndex = 0;
+
+	local.setPosix ( TimeZoneRule ( tzIndex ));				// Current local time zone
+	home.setPosix ( TimeZoneRule ( 0 ));					// and the one schedules are based on
+
+	BuildDataItemList ();
+
+	if ( moved && WiFi.status () == WL_CONNECTED )
+	{
+		Serial.printf_P ( PSTR ( "Config: moving to %s\n" ), cfg.ssid[0] );
+		wifiIndex = 0;
+		WiFi.disconnect ();
+		WiFi.begin ( cfg.ssid[0], cfg.pwd[0] );
+		SetListenInterval ();
+	}
+}
+
+
+/*
+ *	'ConfigServerBegin' starts a little web server if 'CONFIG_HTTP' is set. Going
+ *	to "http://<clock address>/config" shows the settings (without the passwords);
+ *	sending a new file there, for example with:
+ *
+ *		curl -H 'Content-Type: text/plain' --data-binary @clock.cfg http://<clock address>/config
+ *
+ *	checks it, puts it into use and saves it. It has to be sent as plain text; the
+ *	web server takes anything else apart as a form, and an empty file would put
+ *	all the settings back to the ones in 'UserSettings.h', so that gets turned away
+ *	too. "/events" shows the event log (see 'EventGet').
+ */
+
+void ConfigServerBegin ()
+{
+	if ( !CONFIG_HTTP )
+		return;
+
+	configServer.on ( "/config", HTTP_GET,  ConfigGet );
+	configServer.on ( "/config", HTTP_POST, ConfigPost );
+	configServer.on ( "/events", HTTP_GET,  EventGet );
+	configServer.begin ();
+}
+
+
+void ConfigGet ()
+{
+	ArenaWriter	text ( CONFIG_MAX );
+
+	ConfigWrite ( cfg, text, false );
+	configServer.send ( 200, "text/plain", text.Text ());
+	ArenaReset ();
+}
+
+
+void ConfigPost ()
+{
+	const String&	body = configServer.arg ( "plain" );
+
+	if ( !configServer.hasArg ( "plain" ) || ( body.length () == 0 ))	// A form or nothing
+	{
+		configServer.send ( 400, "text/plain", "no settings; send them as 'Content-Type: text/plain'\n" );
+		return;
+	}
+
+	char*		text = ( char* ) ( body.length () <= CONFIG_MAX ? ArenaAlloc ( body.length () + 1 ) : nullptr );
+	config*		c    = ( config* ) ArenaAlloc ( sizeof ( config ));
+	const char*	error = "too big";
+
+	if ( text && c )
+	{
+		memcpy ( text, body.c_str (), body.length () + 1 );
+		ConfigDefaults ( *c );								// Same as at startup
+		strcpy ( c->otaUrl, cfg.otaUrl );					// except this stays put
+		error = ConfigParse ( *c, text, true );
+	}
+
+	if ( !error )											// Keep them until the
+	{														// answer has gone out
+		delete webConfig;
+		webConfig = new ( std::nothrow ) config ( *c );
+		webConfigTime = millis ();
+
+		if ( !webConfig )
+			error = "out of memory";
+	}
+
+	if ( error )
+		configServer.send ( 400, "text/plain", String ( error ) + "\n" );
+
+	else
+		configServer.send ( 200, "text/plain", "OK\n" );
+
+	ArenaReset ();
+}
+
+
+/*
+ *	'ConfigPoll' looks after the web server. Settings that came in are put into use
+ *	'CONFIG_APPLY_MS' after the reply was sent rather than in 'ConfigPost', as
+ *	moving to another network would cut the reply off.
+ */
+
+void ConfigPoll ()
+{
+	if ( !CONFIG_HTTP )
+		return;
+
+	configServer.handleClient ();
+
+	if ( webConfig && (( millis () - webConfigTime ) >= CONFIG_APPLY_MS ))
+	{
+		ApplyConfig ( *webConfig );
+		ConfigSave ( cfg );
+		Serial.println ( F ( "Config: new settings from the web" ));
+		EventLog ( EV_CONFIG, 1, 0, 0 );
+
+		delete webConfig;
+		webConfig = nullptr;
+	}
+}
+
+
+/*
+ *	Serial console functions; added in Version 3.2.
+ *
+ *	Commands typed on the serial monitor show what the clock is up to and let you
+ *	poke it ("help" lists them). 'Console' is called every time around 'loop';
+ *	it takes whatever characters have arrived without waiting for more, and only
+ *	when a whole line is in does it look the first word up in 'commands' and call
+ *	that function with the rest of the line.
+ */
+
+struct command
+{
+	const char*	name;								// What's typed
+	void		( *run ) ( char* args );			// What does it
+	const char*	help;								// For 'help'
+};
+
+const command commands[] =
+{
+	{ "help",	CmdHelp,	"List the commands" },
+	{ "stats",	CmdStats,	"Power, processor, display and fetch statistics" },
+	{ "timing",	CmdTiming,	"Startup times" },
+	{ "heap",	CmdHeap,	"Heap and arena use" },
+	{ "solar",	CmdSolar,	"The solar data being shown" },
+	{ "sync",	CmdSync,	"Clock sync and network health" },
+	{ "fetch",	CmdFetch,	"Get the solar data now" },
+	{ "ntp",	CmdNtp,		"Get the time from the NTP server (between seconds)" },
+	{ "zone",	CmdZone,	"zone [n]: list the timezones or show number n" },
+	{ "page",	CmdPage,	"page [n]: show the next solar data item or number n" },
+	{ "update",	CmdUpdate,	"Look for new firmware now" },
+	{ "config",	CmdConfig,	"Show the settings" },
+	{ "set",	CmdSet,		"set name = value: change a setting (as in 'clock.cfg')" },
+	{ "apply",	CmdApply,	"Use and save the settings changed by 'set'" },
+	{ "cancel",	CmdCancel,	"Forget them" },
+	{ "log",	CmdLog,		"log [n]: the newest 20 (or n) events" },
+	{ "stalls",	CmdStalls,	"Where the loop has been held up" },
+	{ "sun",	CmdSun,		"Get a new picture of the sun" },
+	{ "contest",	CmdContest,	"contest [fetch]: the coming contests, or read the calendar now" },
+	{ "pool",	CmdPool,	"pool [bench [n]]: open connections, or time n requests with and without" }
+};
+
+config*		pending = nullptr;						// Changes not applied yet
+uint8_t		pendingSeen = 0;						// Lists started in them
+bool		ntpNow = false;							// "ntp" typed; see 'NtpPoll'
+
+
+void Console ()
+{
+static	char		line[CONSOLE_LINE];						// What's been typed
+static	uint8_t		used = 0;								// How much of it
+
+	while ( Serial.available ())
+	{
+		char	ch = Serial.read ();
+
+		if ( ch == '\r' )
+			continue;
+
+		if ( ch != '\n' )
+		{
+			if ( used < CONSOLE_LINE - 1 )
+				line[used++] = ch;
+			continue;
+		}
+
+		line[used] = 0;
+		used = 0;
+
+		char*	name = Trim ( line );
+		char*	args = name + strcspn ( name, " \t" );		// After the first word
+
+		if ( *args )
+			*args++ = 0;
+
+		if ( *name == 0 )
+			continue;
+
+		uint8_t	i;
+
+		for ( i = 0; i < ELEMENTS ( commands ); i++ )
+			if ( !strcmp ( name, commands[i].name ))
+				break;
+
+		if ( i < ELEMENTS ( commands ))
+			commands[i].run ( Trim ( args ));
+		else
+			Serial.printf_P ( PSTR ( "Unknown command '%s'; try 'help'\n" ), name );
+	}
+}
+
+
+void CmdHelp ( char* args )
+{
+	for ( const command& c : commands )
+		Serial.printf_P ( PSTR ( "  %-8s%s\n" ), c.name, c.help );
+}
+
+
+void CmdStats ( char* args )
+{
+	PrintRadioPower ();
+	PrintCpuPower ();
+	PrintBacklightPower ();
+	PrintFacePixels ( false );
+}
+
+
+void CmdTiming ( char* args )
+{
+	markShown = 0;										// All of them again
+	MarkReport ();
+}
+
+
+void CmdHeap ( char* args )
+{
+	PrintHeap ();
+}
+
+
+void CmdSolar ( char* args )
+{
+	Serial.printf_P ( PSTR ( "Solar: SFI %s, A %s, K %s, GMF %s, S/N %s, aurora %s, Bz %s, SSN %s%s\n" ),
+					solar.sfi, solar.aIndex, solar.kIndex, solar.gmf, solar.s2n,
+					solar.aurora, solar.bz, solar.ssn, solarPending ? " (retry due)" : "" );
+	Serial.printf_P ( PSTR ( "Next fetch in %d seconds\n" ), SecondsToFetch ());
+}
+
+
+void CmdSync ( char* args )
+{
+	Serial.printf_P ( PSTR ( "NTP: last update %d seconds ago, next in %d\n" ),
+					( int32_t ) ( now () - lastNtpUpdateTime ()), SecondsToNtp ());
+	PrintSyncStatus ();
+	PrintNetHealth ();
+}
+
+
+void CmdFetch ( char* args )
+{
+	fetchNow = true;									// 'GetSolarData' does it
+	Serial.println ( F ( "Fetching at the next second" ));
+}
+
+
+void CmdNtp ( char* args )
+{
+	RadioWake ( WAKE_HOLD_MS );
+	ntpNow = true;
+}
+
+
+/*
+ *	'NtpPoll' does the update "ntp" asked for. 'updateNTP' waits for the answer,
+ *	so it's only started once the seconds have been painted; a slow server can
+ *	still hold the display up, as it can with ezTime's own updates.
+ */
+
+void NtpPoll ()
+{
+	if ( !ntpNow || !IdleSlice ())
+		return;
+
+	uint32_t	us = micros ();
+
+	ntpNow = false;
+	PHASE ( PH_EVENTS );
+	updateNTP ();										// Waits for the answer
+	PHASE ( PH_LOOP );
+	NtpEvent ( micros () - us );
+	Serial.printf_P ( PSTR ( "NTP: last update %d seconds ago\n" ), ( int32_t ) ( now () - lastNtpUpdateTime ()));
+}
+
+
+void CmdZone ( char* args )
+{
+	if ( *args == 0 )
+	{
+		for ( uint8_t i = 0; i < tzCount; i++ )
+			Serial.printf_P ( PSTR ( "%c %u %s\n" ), i == tzIndex ? '*' : ' ', i + 1, cfg.zone[i] );
+		return;
+	}
+
+	uint8_t	n = atoi ( args );
+
+	if ( n < 1 || n > tzCount )
+	{
+		Serial.printf_P ( PSTR ( "There are %u timezones\n" ), tzCount );
+		return;
+	}
+
+	tzIndex = n - 1;									// Shown until the next switch
+	local.setPosix ( TimeZoneRule ( tzIndex ));
+}
+
+
+void CmdPage ( char* args )
+{
+	if ( cfg.items == 0 )
+		return;
+
+	if ( *args )
+	{
+		uint8_t	n = atoi ( args );
+
+		if ( n < 1 || n > cfg.items )
+		{
+			Serial.printf_P ( PSTR ( "There are %u items\n" ), cfg.items );
+			return;
+		}
+
+		dataIndex = n - 1;
+	}
+
+	Serial.printf_P ( PSTR ( "Showing %s\n" ), itemNames[cfg.item[dataIndex]] );
+	dataItems[dataIndex++]();							// As 'ShowNextData' does
+	PushRegion ( SOLAR_X, UTC_TOP, SCREEN_W - 1 - SOLAR_X, LY ( 34 ));
+	SunDraw ();
+
+	if ( dataIndex >= cfg.items )
+		dataIndex = 0;
+}
+
+
+void CmdUpdate ( char* args )
+{
+	if ( !cfg.otaUrl[0] )
+		Serial.println ( F ( "OTA: no 'ota_url' set" ));
+	else
+		OtaCheck ();
+}
+
+
+void CmdConfig ( char* args )
+{
+	ConfigWrite ( pending ? *pending : cfg, Serial, false );
+
+	if ( pending )
+		Serial.println ( F ( "# Not applied yet" ));
+}
+
+
+void CmdSet ( char* args )
+{
+	if ( !pending )										// Start from what we have
+	{
+		pending = new ( std::nothrow ) config ( cfg );
+		pendingSeen = 0;
+	}
+
+	const char*	error = pending ? ConfigLine ( *pending, args, pendingSeen ) : "out of memory";
+
+	if ( error )
+		Serial.printf_P ( PSTR ( "Config: %s\n" ), error );
+}
+
+
+void CmdApply ( char* args )
+{
+	const char*	error = pending ? ConfigCheck ( *pending ) : "nothing to apply";
+
+	if ( error )
+		Serial.printf_P ( PSTR ( "Config: %s\n" ), error );
+
+	else
+	{
+		ApplyConfig ( *pending );
+		ConfigSave ( cfg );
+		ArenaReset ();
+		Serial.println ( F ( "Config: applied" ));
+		EventLog ( EV_CONFIG, 2, 0, 0 );
+	}
+
+	CmdCancel ( args );
+}
+
+
+void CmdCancel ( char* args )
+{
+	delete pending;
+	pending = nullptr;
+}
+
+
+void CmdLog ( char* args )
+{
+	EventPrint ( Serial, *args ? atoi ( args ) : 20 );
+}
+
+
+/*
+ *	'CmdStalls' is the "stalls" console command. It shows how many stalls of each
+ *	length there have been in each phase and the last few long ones.
+ */
+
+void CmdStalls ( char* args )
+{
+	Serial.print ( F ( "Phase   " ));
+
+	for ( uint8_t b = 0; b < WATCH_BUCKETS; b++ )
+		Serial.printf_P ( PSTR ( "%6u ms" ), WATCH_MS << b );
+
+	Serial.println ( F ( " and over" ));
+
+	for ( uint8_t p = 0; p < PHASES; p++ )
+	{
+		Serial.printf_P ( PSTR ( "%-8s" ), phaseNames[p] );
+
+		for ( uint8_t b = 0; b < WATCH_BUCKETS; b++ )
+			Serial.printf_P ( PSTR ( "%9u" ), watchHist[p][b] );
+
+		Serial.println ();
+	}
+
+	for ( uint8_t i = 1; i <= WATCH_KEEP; i++ )			// Newest first
+	{
+		const watchStall&	s = watchRecent[( watchNext + WATCH_KEEP - i ) % WATCH_KEEP];
+
+		if ( s.ms )
+			Serial.printf_P ( PSTR ( "Stuck %u ms in %s after line %u (line %u before that)\n" ),
+							s.ms, phaseNames[s.phase], s.line, s.last );
+	}
+}
+
+
+/*
+ *	Firmware update functions; added in Version 3.2.
+ *
+ *	With 'ota_url' set (in 'UserSettings.h', 'clock.cfg' or with 'set' on the
+ *	serial monitor; never from the web, see 'ConfigLine'), the clock looks there
+ *	once an hour (at 'OTA_MINUTE' past) for a small text file describing the
+ *	latest firmware ('ota_server.py' in the 'Software' folder makes one and serves
+ *	it). It's called "esp32.txt" or "esp8266.txt" and looks like this:
+ *
+ *		md5 = <MD5 of the '.bin' file>
+ *		sha256 = <SHA-256 of the file as sent>
+ *		file = <name of the gzipped '.bin' file>
+ *
+ *	If the MD5 isn't that of the program that's running, the file is downloaded
+ *	and written to the spare program space while the clock carries on. It's read
+ *	a slice at a time from 'loop' when 'IdleSlice' says there's time, and not at
+ *	all near an NTP update or a solar data fetch. The slices are made smaller if
+ *	they take longer than 'OTA_SLICE_MS' and bigger (a bit at a time) if not, so
+ *	the seconds keep changing on time whatever the network and flash are doing.
+ *
+ *	On the ESP8266 the gzipped file is written as it is; the boot loader unpacks
+ *	it. On the ESP32 it's unpacked as it arrives with the 'tinfl' decompressor in
+ *	the ROM, using a 32K window that's only there during the update. Nothing is
+ *	kept unless the SHA-256 (and on the ESP32 the MD5 of what was unpacked) is
+ *	right.
+ *
+ *	The ESP32 then starts the new program on trial: if it hasn't shown the time
+ *	(see 'OtaConfirm') within 'OTA_VERIFY_SECONDS', or crashes before then, it goes
+ *	back to the old one. The ESP8266 boot loader copies the new program over the
+ *	old, so there's nothing to go back to there.
+ */
+
+#if defined ( ESP32 )
+
+	extern "C" bool verifyRollbackLater ()				// We'll say if it worked
+	{
+		return true;
+	}
+
+#endif
+
+
+/*
+ *	'Sha256' hides the differences between the two processors' SHA-256 code.
+ */
+
+class Sha256
+{
+	public:
+
+		Sha256 ()
+		{
+			#if defined ( ESP32 )
+				mbedtls_sha256_init ( &ctx );
+				mbedtls_sha256_starts ( &ctx, 0 );
+			#elif defined ( ESP8266 )
+				br_sha256_init ( &ctx );
+			#endif
+		}
+
+		void Add ( const uint8_t* data, size_t n )
+		{
+			#if defined ( ESP32 )
+				mbedtls_sha256_update ( &ctx, data, n );
+			#elif defined ( ESP8266 )
+				br_sha256_update ( &ctx, data, n );
+			#endif
+		}
+
+		void Result ( char* hex )						// 65 characters
+		{
+			uint8_t	hash[32];
+
+			#if defined ( ESP32 )
+				mbedtls_sha256_finish ( &ctx, hash );
+				mbedtls_sha256_free ( &ctx );
+			#elif defined ( ESP8266 )
+				br_sha256_out ( &ctx, hash );
+			#endif
+
+			for ( uint8_t i = 0; i < 32; i++ )
+				sprintf ( hex + 2 * i, "%02x", hash[i] );
+		}
+
+	private:
+
+		#if defined ( ESP32 )
+			mbedtls_sha256_context	ctx;
+		#elif defined ( ESP8266 )
+			br_sha256_context		ctx;
+		#endif
+};
+
+
+/*
+ *	'otaState' is everything needed during an update; it's made when one starts
+ *	and deleted when it's done, so the 40K or so on the ESP32 is only borrowed.
+ */
+
+struct otaState
+{
+	WiFiClient	client;									// Plain HTTP on the LAN
+	HTTPClient	http;
+	Sha256		sha;									// Of what arrives
+	char		md5[33];								// What the manifest says
+	char		sha256[65];
+	uint8_t		buf[OTA_CHUNK];							// What was read
+	size_t		left;									// Bytes still to come
+	size_t		size;									// and all of them
+	size_t		budget;									// Bytes per slice
+	uint32_t	started;								// 'millis ()' at the start
+	uint32_t	lastData;								// and when we last got some
+	uint32_t	lateStart;								// 'stallCount' at the start
+	uint32_t	worstGap;								// Longest second since then
+	uint32_t	slices;									// Number of slices
+
+	#if defined ( ESP32 )
+		tinfl_decompressor	inflator;
+		uint8_t				window[TINFL_LZ_DICT_SIZE];	// Unpacked data
+		size_t				windowPos;
+		tinfl_status		status;
+		bool				header;						// gzip header skipped
+	#endif
+};
+
+otaState*	ota = nullptr;								// Update in progress
+bool		otaTrial = false;							// Running new firmware on trial
+
+#if defined ( ESP32 )
+	Ticker	otaTimer;									// For giving up on it
+#endif
+
+
+/*
+ *	'OtaBegin' is called at startup. If this is new firmware on trial, it starts
+ *	the clock on giving up on it.
+ */
+
+void OtaBegin ()
+{
+	#if defined ( ESP32 )
+
+		esp_ota_img_states_t	state;
+
+		if (( esp_ota_get_state_partition ( esp_ota_get_running_partition (), &state ) == ESP_OK )
+								&& ( state == ESP_OTA_IMG_PENDING_VERIFY ))
+		{
+			otaTrial = true;
+			otaTimer.once ( OTA_VERIFY_SECONDS, OtaRollback );
+			Serial.printf_P ( PSTR ( "OTA: new firmware, on trial for %u seconds\n" ), OTA_VERIFY_SECONDS );
+		}
+
+	#endif
+}
+
+
+/*
+ *	'OtaRollback' runs from 'otaTimer', which on the ESP32 is in the timer task
+ *	alongside the loop, so like 'WatchTick' it leaves the event log and the file
+ *	system alone. It just leaves a note in the RTC memory for 'WatchRecover' to
+ *	log once the old firmware has started. That only works if the old firmware
+ *	has 'rescue' in the same place, which it will if it's the same version.
+ */
+
+void OtaRollback ()
+{
+	#if defined ( ESP32 )
+		rescue.magic = ROLLBACK_MAGIC;
+		esp_ota_mark_app_invalid_rollback_and_reboot ();
+	#endif
+}
+
+
+/*
+ *	'OtaConfirm' is called once the time is on the screen; the new firmware has
+ *	passed its trial.
+ */
+
+void OtaConfirm ()
+{
+	if ( !otaTrial )
+		return;
+
+	#if defined ( ESP32 )
+		otaTimer.detach ();
+		esp_ota_mark_app_valid_cancel_rollback ();
+	#endif
+
+	otaTrial = false;
+	Serial.println ( F ( "OTA: new firmware is working" ));
+}
+
+
+/*
+ *	'OtaPoll' looks for new firmware at the right time and does the next slice of
+ *	an update that's going on.
+ */
+
+void OtaPoll ()
+{
+static	int8_t	checked = -1;							// Hour we last looked
+
+	if ( ota )
+		OtaSlice ();
+
+	else if ( cfg.otaUrl[0] && ( utcCal.minute == OTA_MINUTE ) && ( utcCal.hour != checked ))
+	{
+		checked = utcCal.hour;							// Once an hour
+		OtaCheck ();
+	}
+}
+
+
+/*
+ *	'OtaCheck' reads the manifest and starts the update if it's a different
+ *	program.
+ */
+
+void OtaCheck ()
+{
+	char		md5[33]     = "";
+	char		sha256[65]  = "";
+	char		file[48]    = "";
+	String		url         = String ( cfg.otaUrl ) + "/";
+	WiFiClient	client;
+	HTTPClient	http;
+
+	if ( ota || !cfg.otaUrl[0] )
+		return;
+
+	#if defined ( ESP32 )
+		url += "esp32";
+	#elif defined ( ESP8266 )
+		url += "esp8266";
+	#endif
+
+	if ( !OtaGet ( client, http, url + ".txt" ))
+	{
+		Serial.printf_P ( PSTR ( "OTA: can't get %s.txt\n" ), url.c_str ());
+		http.end ();
+		return;
+	}
+
+	String	manifest = http.getString ();
+	http.end ();
+
+	for ( char* line = strtok (( char* ) manifest.c_str (), "\n" ); line; line = strtok ( nullptr, "\n" ))
+	{
+		char	key[8];
+		char	value[65];
+
+		if ( sscanf ( line, " %7[a-z0-9] = %64s", key, value ) != 2 )
+			continue;
+
+		if ( !strcmp ( key, "md5" ))
+			strncpy ( md5, value, sizeof ( md5 ) - 1 );
+
+		else if ( !strcmp ( key, "sha256" ))
+			strncpy ( sha256, value, sizeof ( sha256 ) - 1 );
+
+		else if ( !strcmp ( key, "file" ))
+			strncpy ( file, value, sizeof ( file ) - 1 );
+	}
+
+	if ( strlen ( md5 ) != 32 || strlen ( sha256 ) != 64 || !file[0] )
+	{
+		Serial.println ( F ( "OTA: bad manifest" ));
+		return;
+	}
+
+	if ( ESP.getSketchMD5 () == md5 )					// Already running it
+	{
+		Serial.println ( F ( "OTA: up to date" ));
+		return;
+	}
+
+	OtaStart ( String ( cfg.otaUrl ) + "/" + file, md5, sha256 );
+}
+
+
+/*
+ *	'OtaGet' starts a GET without waiting long if the server isn't there, since
+ *	the display stops while it waits.
+ */
+
+bool OtaGet ( WiFiClient& client, HTTPClient& http, const String& url )
+{
+	RadioWake ( WAKE_HOLD_MS );
+
+	#if defined ( ESP32 )
+		http.setConnectTimeout ( OTA_CONNECT_MS );
+	#endif
+
+	http.setTimeout ( OTA_CONNECT_MS );
+
+	return http.begin ( client, url ) && ( http.GET () == HTTP_CODE_OK );
+}
+
+
+/*
+ *	'OtaStart' connects to the firmware file and gets the update going.
+ */
+
+void OtaStart ( const String& url, const char* md5, const char* sha256 )
+{
+	ota = new ( std::nothrow ) otaState;
+
+	if ( !ota )
+	{
+		Serial.println ( F ( "OTA: not enough memory" ));
+		return;
+	}
+
+	strcpy ( ota->md5, md5 );
+	strcpy ( ota->sha256, sha256 );
+
+	int32_t	size = OtaGet ( ota->client, ota->http, url ) ? ota->http.getSize () : -1;
+
+	#if defined ( ESP32 )								// Size unpacked isn't known
+		bool	ready = ( size > 0 ) && Update.begin ( UPDATE_SIZE_UNKNOWN ) && Update.setMD5 ( md5 );
+
+		tinfl_init ( &ota->inflator );
+		ota->windowPos = 0;
+		ota->status    = TINFL_STATUS_NEEDS_MORE_INPUT;
+		ota->header    = false;
+
+	#elif defined ( ESP8266 )							// Written as it comes
+		bool	ready = ( size > 0 ) && Update.begin ( size );
+	#endif
+
+	ota->size      = ota->left = size;
+	ota->budget    = OTA_BUDGET_MIN;
+	ota->started   = ota->lastData = millis ();
+	ota->lateStart = stallCount;
+	ota->worstGap  = 0;
+	ota->slices    = 0;
+
+	if ( !ready )
+	{
+		OtaEnd ( "can't start the update" );
+		return;
+	}
+
+	Serial.printf_P ( PSTR ( "OTA: downloading %s (%u bytes)\n" ), url.c_str (), size );
+	EventLog ( EV_OTA, 1, size, 0 );
+}
+
+
+/*
+ *	'OtaSlice' reads and writes up to 'budget' bytes and adjusts the budget for
+ *	next time by how long it took.
+ */
+
+void OtaSlice ()
+{
+	if ( !IdleSlice ()									// Seconds come first
+			|| ( SecondsToNtp () <= WAKE_AHEAD )		// then NTP
+			|| ( SecondsToFetch () <= WAKE_AHEAD )		// and the solar data
+			|| solarPending || fetchNow )
+		return;
+
+	RadioWake ( WAKE_HOLD_MS );
+	CpuBoost ();
+
+	uint32_t	us   = micros ();
+	WiFiClient*	in   = ota->http.getStreamPtr ();
+	size_t		want = min ( ota->budget, ota->left );
+
+	ota->worstGap = max ( ota->worstGap, lastGapMs );
+	ota->slices++;
+
+	while ( want && in->available ())
+	{
+		int	n = in->read ( ota->buf, min ( want, ( size_t ) OTA_CHUNK ));
+
+		if ( n <= 0 )
+			break;
+
+		ota->sha.Add ( ota->buf, n );
+
+		if ( !OtaWrite ( ota->buf, n, ota->left == ( size_t ) n ))
+		{
+			CpuRelax ();
+			OtaEnd ( "write failed" );
+			return;
+		}
+
+		ota->left    -= n;
+		want         -= n;
+		ota->lastData = millis ();
+	}
+
+	us = micros () - us;
+
+	if ( us > OTA_SLICE_MS * 1000UL )					// Too long; halve it
+		ota->budget = max ( ota->budget / 2, ( size_t ) OTA_BUDGET_MIN );
+
+	else if ( want == 0 )								// All used; a bit more
+		ota->budget = min ( ota->budget + OTA_BUDGET_MIN, ( size_t ) OTA_BUDGET_MAX );
+
+	CpuRelax ();
+
+	if ( ota->left == 0 )
+		OtaFinish ();
+
+	else if (( millis () - ota->lastData ) > OTA_TIMEOUT_MS )
+		OtaEnd ( "download stalled" );
+}
+
+
+/*
+ *	'OtaWrite' puts what was read into the update; on the ESP32 it's unpacked on
+ *	the way through the window.
+ */
+
+bool OtaWrite ( const uint8_t* data, size_t n, bool last )
+{
+	#if defined ( ESP32 )
+
+		if ( !ota->header )								// Skip the gzip header
+		{
+			size_t	skip = 10;							// Assume all in the first read
+			uint8_t	flags = data[3];
+
+			if ( n < 10 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8 )
+				return false;
+
+			if (( flags & 0x04 ) && ( n > 12 ))			// Extra field
+				skip += 2 + data[10] + ( data[11] << 8 );
+
+			for ( uint8_t z = 0x08; z <= 0x10; z <<= 1 )	// File name, comment
+				if ( flags & z )
+					while ( skip < n && data[skip++] );
+
+			if ( flags & 0x02 )							// Header CRC
+				skip += 2;
+
+			if ( skip >= n )
+				return false;
+
+			data += skip;
+			n    -= skip;
+			ota->header = true;
+		}
+
+		while ( ota->status != TINFL_STATUS_DONE )
+		{
+			size_t	inSize  = n;
+			size_t	outSize = TINFL_LZ_DICT_SIZE - ota->windowPos;
+
+			ota->status = tinfl_decompress ( &ota->inflator, data, &inSize, ota->window,
+							ota->window + ota->windowPos, &outSize,
+							last ? 0 : TINFL_FLAG_HAS_MORE_INPUT );
+
+			if ( ota->status < TINFL_STATUS_DONE )		// Bad data
+				return false;
+
+			if ( outSize && ( Update.write ( ota->window + ota->windowPos, outSize ) != outSize ))
+				return false;
+
+			ota->windowPos = ( ota->windowPos + outSize ) & ( TINFL_LZ_DICT_SIZE - 1 );
+			data += inSize;
+			n    -= inSize;
+
+			if (( ota->status == TINFL_STATUS_NEEDS_MORE_INPUT ) && ( n == 0 ))
+				break;
+		}
+
+		return true;									// Anything left is the gzip trailer
+
+	#elif defined ( ESP8266 )
+
+		return Update.write (( uint8_t* ) data, n ) == n;
+
+	#endif
+}
+
+
+/*
+ *	'OtaFinish' checks what arrived and, if it's right, restarts with it.
+ */
+
+void OtaFinish ()
+{
+	char	hash[65];
+
+	ota->sha.Result ( hash );
+
+	if ( strcmp ( hash, ota->sha256 ))
+	{
+		OtaEnd ( "SHA-256 doesn't match" );
+		return;
+	}
+
+	#if defined ( ESP32 )
+		if ( ota->status != TINFL_STATUS_DONE )
+		{
+			OtaEnd ( "file cut short" );
+			return;
+		}
+	#endif
+
+	if ( !Update.end ( true ))							// Checks the MD5 on the ESP32
+	{
+		OtaEnd ( "image check failed" );
+		return;
+	}
+
+	Serial.printf_P ( PSTR ( "OTA: %u bytes in %u ms, %u slices; %u late seconds, longest %u ms\n" ),
+					ota->size, millis () - ota->started, ota->slices,
+					stallCount - ota->lateStart, ota->worstGap );
+	Serial.println ( F ( "OTA: restarting with the new firmware" ));
+	EventLog ( EV_OTA, 2, ota->size, millis () - ota->started );
+
+	ota->http.end ();
+	delete ota;
+	ota = nullptr;
+
+	delay ( 500 );										// Let the message out
+	Restart ( RESTART_OTA );
+}
+
+
+/*
+ *	'OtaEnd' gives up on an update and cleans up.
+ */
+
+void OtaEnd ( const char* why )
+{
+	Serial.printf_P ( PSTR ( "OTA: %s after %u of %u bytes\n" ), why,
+					ota->size - ota->left, ota->size );
+	EventLog ( EV_OTA, 3, ota->size - ota->left, 0 );
+
+	#if defined ( ESP32 )
+		Update.abort ();
+	#elif defined ( ESP8266 )
+		Update.end ();									// Not finished, so it's dropped
+	#endif
+
+	ota->http.end ();
+	delete ota;
+	ota = nullptr;
+}
+
+
+/*
+ *	Event log functions; added in Version 3.2.
+ *
+ *	When a clock misbehaves overnight, the event log says what happened: each
+ *	startup (with the reason for it), restart, WiFi roam, NTP sync, solar data
+ *	fetch, settings change and firmware update. Each event is a fixed 16 byte
+ *	'event'; they're collected in a page in memory and the page is written to its
+ *	slot in 'EVENT_FILE' when it's full or has waited 'EVENT_FLUSH_SECONDS', and
+ *	always before we restart ourselves (see 'Restart').
+ *
+ *	The file is made full size the first time and then just overwritten, one page
+ *	at a time, round and round, so it never grows and the oldest page goes first.
+ *	LittleFS spreads the writes over the flash and either writes a page completely
+ *	or not at all; a page that's wrong anyway fails its CRC and is ignored. Each
+ *	page has a sequence number one higher than the page before, so at startup
+ *	'EventBegin' reads the pages once to make 'evSeq', the index of which sequence
+ *	number is in which slot, and carries on from the highest.
+ */
+
+/*
+ *	'EventBegin' is called at startup once the file system is mounted. It finds
+ *	where the log got to (or makes a new one) and logs the startup.
+ */
+
+void EventBegin ()
+{
+	uint8_t		newest = 0;								// Slot with the highest number
+	uint8_t		reason;
+
+	if ( fsReady )
+	{
+		File	f = LittleFS.open ( EVENT_FILE, "r" );
+
+		if ( f && ( f.size () == EVENT_PAGES * EVENT_PAGE ))
+		{
+			for ( uint8_t i = 0; i < EVENT_PAGES; i++ )
+			{
+				bool	good = ( f.read (( uint8_t* ) &evPage, EVENT_PAGE ) == EVENT_PAGE )
+										&& EventPageGood ( evPage );
+
+				evSeq[i] = good ? evPage.seq : 0;
+
+				if ( evSeq[i] > evSeq[newest] )
+					newest = i;
+			}
+
+			if ( evSeq[newest] && f.seek ( newest * EVENT_PAGE ))	// Carry on with that page
+				f.read (( uint8_t* ) &evPage, EVENT_PAGE );
+
+			f.close ();
+		}
+
+		else											// New (or the wrong size)
+		{
+			f.close ();
+			f = LittleFS.open ( EVENT_FILE, "w" );
+			memset ( &evPage, 0, EVENT_PAGE );
+
+			for ( uint8_t i = 0; f && ( i < EVENT_PAGES ); i++ )
+				f.write (( uint8_t* ) &evPage, EVENT_PAGE );
+
+			f.close ();
+			Serial.println ( F ( "Events: new log" ));
+		}
+	}
+
+	if ( evSeq[newest] == 0 )							// Nothing there
+	{
+		memset ( &evPage, 0, EVENT_PAGE );
+		evPage.seq = 1;
+	}
+
+	evSlot = newest;
+	evFlushed = millis ();
+
+	if ( evPage.count >= EVENTS_PER_PAGE )				// Full; start the next one
+		EventNextPage ();
+
+	WatchRecover ();									// Stuck last time?
+
+	#if defined ( ESP32 )
+		reason = esp_reset_reason ();
+	#elif defined ( ESP8266 )
+		reason = ESP.getResetInfoPtr ()->reason;
+	#endif
+
+	EventLog ( EV_BOOT, reason, 0, 0 );
+	EventFlush ();										// In case we don't last long
+	Serial.printf_P ( PSTR ( "Events: page %u, started by %s\n" ), evPage.seq,
+					reason < sizeof ( resetNames ) / sizeof ( resetNames[0] ) ? resetNames[reason] : "?" );
+}
+
+
+bool EventPageGood ( const eventPage& p )
+{
+	return p.seq && ( p.count <= EVENTS_PER_PAGE )
+				&& ( p.crc == Crc32 ( &p.count, EVENT_PAGE - offsetof ( eventPage, count )));
+}
+
+
+/*
+ *	'EventLog' adds an event to the page in memory. The time is UTC once we have
+ *	it and seconds since startup until then.
+ */
+
+void EventLog ( uint8_t type, int16_t a, int32_t b, int32_t c )
+{
+	if ( evPage.count >= EVENTS_PER_PAGE )				// Full and not written yet
+		EventFlush ();
+
+	event&	e = evPage.events[evPage.count++];
+
+	e.type  = type;
+	e.a     = a;
+	e.b     = b;
+	e.c     = c;
+	e.flags = ( timeStatus () == timeSet ) ? 0 : EV_UPTIME;
+	e.time  = e.flags ? millis () / 1000 : now ();
+
+	evDirty = true;
+}
+
+
+/*
+ *	'EventPoll' writes the page when it's full or has waited long enough, in an
+ *	idle slice as it can take a few tens of milliseconds.
+ */
+
+void EventPoll ()
+{
+	if ( evDirty && IdleSlice () && (( evPage.count >= EVENTS_PER_PAGE )
+				|| (( millis () - evFlushed ) > EVENT_FLUSH_SECONDS * 1000UL )))
+		EventFlush ();
+}
+
+
+/*
+ *	'EventFlush' writes the page in memory over its slot in the file; once a full
+ *	page is written, the next one goes in the next slot.
+ */
+
+void EventFlush ()
+{
+	if ( evDirty && fsReady )
+	{
+		File	f = LittleFS.open ( EVENT_FILE, "r+" );
+
+		evPage.crc = Crc32 ( &evPage.count, EVENT_PAGE - offsetof ( eventPage, count ));
+
+		if ( f && f.seek ( evSlot * EVENT_PAGE ) && ( f.write (( uint8_t* ) &evPage, EVENT_PAGE ) == EVENT_PAGE ))
+			evSeq[evSlot] = evPage.seq;
+		else
+			Serial.println ( F ( "Events: can't write the log" ));
+
+		f.close ();
+	}
+
+	evDirty   = false;
+	evFlushed = millis ();
+
+	if ( evPage.count >= EVENTS_PER_PAGE )
+		EventNextPage ();
+}
+
+
+void EventNextPage ()
+{
+	evSlot = ( evSlot + 1 ) % EVENT_PAGES;
+	evPage.seq++;
+	evPage.count = 0;
+	memset ( evPage.events, 0, sizeof ( evPage.events ));
+}
+
+
+/*
+ *	'Restart' logs why we're restarting and writes the log before doing it.
+ */
+
+void Restart ( uint8_t why )
+{
+	EventLog ( EV_RESTART, why, 0, 0 );
+	EventFlush ();
+	ESP.restart ();
+}
+
+
+/*
+ *	'NtpEvent' logs each NTP sync: how far our clock was out (the jump from what
+ *	it would have said otherwise) and how long the sync took, which is mostly the
+ *	round trip to the server. 'us' is how long the call that might have done the
+ *	sync ('events' or 'updateNTP') took, as ezTime doesn't say.
+ */
+
+void NtpEvent ( uint32_t us )
+{
+static	time_t		lastSync = 0;						// Last 'lastNtpUpdateTime'
+static	int64_t		refMs = 0;							// Our time a moment ago
+static	uint32_t	refMillis = 0;						// and 'millis ()' then
+
+	time_t	sync = lastNtpUpdateTime ();
+
+	if ( sync != lastSync )
+	{
+		int32_t	offset = lastSync ? EpochMs () - ( refMs + ( millis () - refMillis )) : 0;
+
+		EventLog ( EV_NTP, lastSync != 0, offset, lastSync ? us / 1000 : -1 );
+		lastSync = sync;
+	}
+
+	if (( millis () - refMillis ) > 1000 )				// Keep the reference fresh
+	{
+		refMs     = EpochMs ();
+		refMillis = millis ();
+	}
+}
+
+
+/*
+ *	'EventPrint' prints the newest 'n' events, newest first: the ones still in
+ *	memory, then the pages in the file in sequence number order, found with
+ *	'evSeq'. 'out' is 'Serial' or the web page.
+ */
+
+void EventPrint ( Print& out, uint16_t n )
+{
+	uint16_t	shown = 0;
+	eventPage	page;									// One from the file
+	File		f;
+
+	for ( int8_t i = evPage.count - 1; ( i >= 0 ) && ( shown < n ); i--, shown++ )
+		EventShow ( out, evPage.events[i] );
+
+	if ( fsReady )
+		f = LittleFS.open ( EVENT_FILE, "r" );
+
+	for ( uint32_t seq = evPage.seq - 1; f && seq && ( shown < n ); seq-- )
+	{
+		uint8_t	slot = 0;
+
+		while (( slot < EVENT_PAGES ) && ( evSeq[slot] != seq ))
+			slot++;
+
+		if ( slot == EVENT_PAGES )						// Written over or never was
+			break;
+
+		if ( !f.seek ( slot * EVENT_PAGE ) || ( f.read (( uint8_t* ) &page, EVENT_PAGE ) != EVENT_PAGE )
+					|| !EventPageGood ( page ) || ( page.seq != seq ))
+			break;
+
+		for ( int8_t i = page.count - 1; ( i >= 0 ) && ( shown < n ); i--, shown++ )
+			EventShow ( out, page.events[i] );
+	}
+
+	f.close ();
+
+	if ( shown == 0 )
+		out.println ( F ( "No events" ));
+}
+
+
+void EventShow ( Print& out, const event& e )
+{
+	calendar	c = {};
+
+	if ( e.flags & EV_UPTIME )
+		out.printf_P ( PSTR ( "%10u s after start  " ), e.time );
+
+	else
+	{
+		Breakdown ( e.time, c );
+		out.printf_P ( PSTR ( "%04d-%02d-%02d %02d:%02d:%02d  " ), c.year, c.month, c.day, c.hour, c.minute, c.second );
+	}
+
+	switch ( e.type )
+	{
+		case EV_BOOT:
+			out.printf_P ( PSTR ( "Started by %s\n" ),
+						( uint16_t ) e.a < sizeof ( resetNames ) / sizeof ( resetNames[0] ) ? resetNames[e.a] : "?" );
+			break;
+
+		case EV_RESTART:
+			out.printf_P ( PSTR ( "Restarting: %s\n" ),
+						( uint16_t ) e.a < sizeof ( restartNames ) / sizeof ( restartNames[0] ) ? restartNames[e.a] : "?" );
+			break;
+
+		case EV_ROAM:
+			if ( e.a < 0 )
+				out.println ( F ( "WiFi roam failed" ));
+			else
+				out.printf_P ( PSTR ( "WiFi roamed to channel %d, %d dBm\n" ), e.a, e.b );
+			break;
+
+		case EV_NTP:
+			if ( e.a )
+				out.printf_P ( PSTR ( "NTP sync, %+d ms, took %d ms\n" ), e.b, e.c );
+			else
+				out.println ( F ( "NTP first sync" ));
+			break;
+
+		case EV_FETCH:
+			out.printf_P ( PSTR ( "Fetch %s, code %d, %d ms\n" ), e.c ? "ok" : "failed", e.a, e.b );
+			break;
+
+		case EV_CONFIG:
+			out.printf_P ( PSTR ( "New settings from the %s\n" ), e.a == 1 ? "web" : "serial monitor" );
+			break;
+
+		case EV_OTA:
+			if ( e.a == 1 )
+				out.printf_P ( PSTR ( "Firmware update started, %d bytes\n" ), e.b );
+			else if ( e.a == 2 )
+				out.printf_P ( PSTR ( "Firmware update done, %d bytes in %d ms\n" ), e.b, e.c );
+			else
+				out.printf_P ( PSTR ( "Firmware update failed after %d bytes\n" ), e.b );
+			break;
+
+		case EV_STALL:
+			out.printf_P ( PSTR ( "Stuck %d ms in %s after line %d (line %d before that)\n" ), e.b,
+						( uint16_t ) e.a < PHASES ? phaseNames[e.a] : "?", e.c & 0xFFFF, ( uint32_t ) e.c >> 16 );
+			break;
+
+		default:
+			out.printf_P ( PSTR ( "Event %u: %d %d %d\n" ), e.type, e.a, e.b, e.c );
+	}
+}
+
+
+/*
+ *	'EventGet' shows the log on "http://<clock address>/events", the newest 100
+ *	events or "?n=" that many. It's only there with 'CONFIG_HTTP' turned on.
+ */
+
+void EventGet ()
+{
+	uint16_t	n = configServer.hasArg ( "n" ) ? configServer.arg ( "n" ).toInt () : 100;
+	ArenaWriter	text ( ARENA_SIZE );					// As much as there's room for
+
+	EventPrint ( text, n );
+	configServer.send ( 200, "text/plain", text.Text ());
+	ArenaReset ();
+}
+
+
+/*
+ *	Loop watchdog functions; added in Version 3.2.
+ *
+ *	Now and then a clock freezes for a few seconds, somewhere in a fetch, the WiFi
+ *	reconnect or 'events'. 'PHASE' checkpoints in 'loop' and the code it calls say
+ *	which 'PH_' phase we're in and which line we're on; 'Phase' is a 'millis' call
+ *	and a few stores, so they cost next to nothing. When a checkpoint comes more
+ *	than 'WATCH_MS' after the one before, the time in between is counted in
+ *	'watchHist', and if it was over 'WATCH_LOG_MS' it's logged along with the two
+ *	checkpoint lines, which between them pin down what it was stuck in.
+ *
+ *	That only sees a stall once it's over. With 'STALL_RESET' set, 'WatchTick' also
+ *	looks from a timer every 'WATCH_TICK_MS' and once we've been stuck that long,
+ *	it puts the stall and the unwritten event log page in the RTC memory and
+ *	restarts; 'WatchRecover' logs them at the next startup. On the ESP32 the timer
+ *	runs in its own task, so it works whatever the loop is doing. On the ESP8266
+ *	it only runs while the loop is waiting (in 'delay' or for the network), which
+ *	is where these stalls are; its own watchdog catches the rest.
+ */
+
+void WatchBegin ()
+{
+	phaseStart = millis ();								// Setup doesn't count
+
+	if ( STALL_RESET )
+		watchTimer.attach_ms ( WATCH_TICK_MS, WatchTick );
+}
+
+
+void Phase ( uint8_t id, uint16_t line )
+{
+	uint32_t	ms = millis ();
+
+	if (( ms - phaseStart ) >= WATCH_MS )				// Hardly ever
+	{
+		watchStall	s = { ms - phaseStart, phaseId, phaseLine, phaseLast };
+
+		WatchStall ( s );
+	}
+
+	phaseStart = ms;
+	phaseId    = id;
+	phaseLast  = phaseLine;
+	phaseLine  = line;
+}
+
+
+/*
+ *	'WatchStall' counts a stall and logs it if it was a long one.
+ */
+
+void WatchStall ( const watchStall& s )
+{
+	uint8_t		bucket = 0;
+
+	for ( uint32_t limit = WATCH_MS * 2; ( s.ms >= limit ) && ( bucket < WATCH_BUCKETS - 1 ); limit *= 2 )
+		bucket++;
+
+	if ( watchHist[s.phase][bucket] < UINT16_MAX )
+		watchHist[s.phase][bucket]++;
+
+	if ( s.ms < WATCH_LOG_MS )
+		return;
+
+	watchRecent[watchNext] = s;
+	watchNext = ( watchNext + 1 ) % WATCH_KEEP;
+
+	EventLog ( EV_STALL, s.phase, s.ms, ( s.last << 16 ) | s.line );
+	Serial.printf_P ( PSTR ( "Watch: stuck %u ms in %s after line %u (line %u before that)\n" ),
+					s.ms, phaseNames[s.phase], s.line, s.last );
+}
+
+
+/*
+ *	'WatchTick' runs from 'watchTimer'; see above.
+ */
+
+void WatchTick ()
+{
+	uint32_t	ms = millis () - phaseStart;
+
+	if ( ms < STALL_RESET * 1000UL )
+		return;
+
+	watchStall	s = { ms, phaseId, phaseLine, phaseLast };
+	uint32_t	magic = WATCH_MAGIC;
+
+	Serial.printf_P ( PSTR ( "Watch: stuck %u ms in %s after line %u, restarting\n" ),
+					ms, phaseNames[s.phase], s.line );
+
+	evPage.crc = Crc32 ( &evPage.count, EVENT_PAGE - offsetof ( eventPage, count ));
+
+	#if defined ( ESP32 )
+		rescue.stall = s;
+		rescue.page  = evPage;
+		rescue.magic = magic;
+		ESP.restart ();
+
+	#elif defined ( ESP8266 )							// Last, so it's only there if the rest is
+		ESP.rtcUserMemoryWrite ( offsetof ( watchRescue, stall ) / 4, ( uint32_t* ) &s, sizeof ( s ));
+		ESP.rtcUserMemoryWrite ( offsetof ( watchRescue, page ) / 4, ( uint32_t* ) &evPage, sizeof ( evPage ));
+		ESP.rtcUserMemoryWrite ( 0, &magic, sizeof ( magic ));
+		system_restart ();								// 'ESP.restart' can't be used here
+
+	#endif
+}
+
+
+/*
+ *	'WatchRecover' is called by 'EventBegin' once it has found its place in the
+ *	log. If we restarted because we were stuck, the event log page from then goes
+ *	back in place (it's the same page, with the events that weren't written yet)
+ *	and the stall is logged. If new firmware gave up on itself ('OtaRollback'),
+ *	that's logged.
+ */
+
+void WatchRecover ()
+{
+	watchStall	s;
+	eventPage	page;
+	uint32_t	magic = 0;
+
+	#if defined ( ESP32 )
+		magic = rescue.magic;
+		s     = rescue.stall;
+		page  = rescue.page;
+		rescue.magic = 0;								// Only once
+
+	#elif defined ( ESP8266 )
+		ESP.rtcUserMemoryRead ( 0, &magic, sizeof ( magic ));
+		ESP.rtcUserMemoryRead ( offsetof ( watchRescue, stall ) / 4, ( uint32_t* ) &s, sizeof ( s ));
+		ESP.rtcUserMemoryRead ( offsetof ( watchRescue, page ) / 4, ( uint32_t* ) &page, sizeof ( page ));
+		uint32_t	zero = 0;
+
+		ESP.rtcUserMemoryWrite ( 0, &zero, sizeof ( zero ));	// Only once
+
+	#endif
+
+	if ( magic == ROLLBACK_MAGIC )
+	{
+		Serial.println ( F ( "OTA: new firmware didn't start properly; went back to this one" ));
+		EventLog ( EV_RESTART, RESTART_ROLLBACK, 0, 0 );
+		return;
+	}
+
+	if (( magic != WATCH_MAGIC ) || ( s.phase >= PHASES ))
+		return;
+
+	if ( EventPageGood ( page ) && ( page.seq == evPage.seq ) && ( page.count >= evPage.count ))
+	{
+		evPage  = page;
+		evDirty = true;
+	}
+
+	WatchStall ( s );
+	EventLog ( EV_RESTART, RESTART_STALL, 0, 0 );
+}
+
+
+/*
+ *	Startup timing functions; added in Version 3.2.
+ *
+ *	'Mark' notes the time the first time the startup gets to some point (the same
+ *	name again is ignored) and prints it if the serial port is going; the ones
+ *	from before that are printed by 'MarkReport' once it is. The times are from
+ *	when the program started, so they leave out the boot loader.
+ */
+
+void Mark ( const char* name )
+{
+	for ( uint8_t i = 0; i < markCount; i++ )
+		if ( marks[i].name == name )					// Already been here
+			return;
+
+	if ( markCount >= MARKS )
+		return;
+
+	marks[markCount].name = name;
+	marks[markCount].us   = micros ();
+	markCount++;
+
+	if ( serialUp )
+		MarkReport ();
+}
+
+
+void MarkReport ()
+{
+	for ( ; markShown < markCount; markShown++ )
+	{
+		uint32_t	us   = marks[markShown].us;
+		uint32_t	step = markShown ? us - marks[markShown - 1].us : us;
+
+		Serial.printf_P ( PSTR ( "Timing: %s at %u.%03u s (+%u ms)\n" ), marks[markShown].name,
+						us / 1000000, ( us / 1000 ) % 1000, step / 1000 );
+	}
+}
+
+
+/*
+ *	Network test functions; added in Version 3.2.
+ *
+ *	These keep track of how the clock copes when the network misbehaves, whether
+ *	that's for real or caused by 'chaos.py' (see 'TEST_HOST').
+ *
+ *	'StallCheck' is called as each new second is shown and counts those that came
+ *	more than 'STALL_MS' after the one before, which the user would have noticed.
+ */
+
+void StallCheck ()
+{
+static	uint32_t	lastTick = 0;						// When the last second was shown
+
+	uint32_t	gap = millis () - lastTick;
+
+	if ( lastTick )
+	{
+		if ( gap > STALL_MS )
+			stallCount++;
+
+		stallMaxMs = max ( stallMaxMs, gap );
+		lastGapMs  = gap;
+	}
 
-	ShowClockStatus();								// And clock status
-	oldLt = lt;										// and current local time
+	lastTick = millis ();
+}
+
+
+/*
+ *	'FetchResult' counts the failed solar data fetches and times how long it takes
+ *	to get good data again after a failure. When testing, it reports every fetch.
+ */
+
+void FetchResult ( bool good, int16_t code, uint32_t ms )
+{
+	if ( !good )
+	{
+		fetchFailed++;
+
+		if ( !failSince )
+			failSince = millis () - ms;					// When the first one started
+	}
+
+	else if ( failSince )
+	{
+		recoveryMs = max ( recoveryMs, millis () - failSince );
+		failSince = 0;
+	}
+
+	if ( good )
+		Mark ( "first solar data" );
+
+	EventLog ( EV_FETCH, code, ms, good );
+
+	if ( TESTING )
+		Serial.printf_P ( PSTR ( "Test: fetch %s, code %d, %u ms, failed %u of %u, "
+						"late seconds %u, longest %u ms, longest recovery %u ms\n" ),
+						good ? "ok" : "failed", code, ms, fetchFailed, fetchCount,
+						stallCount, stallMaxMs, recoveryMs );
+}
+
+
+/*
+ *	'TestFlap' drops the WiFi connection every 'TEST_FLAP_SECONDS' and starts
+ *	connecting again straight away.
+ */
+
+void TestFlap ()
+{
+static	uint32_t	flapTime = 0;						// When we last did it
+
+	if ( !TEST_FLAP_SECONDS )
+		return;
+
+	if ( !flapTime )									// Start timing the first time
+		flapTime = millis ();
+
+	if (( millis () - flapTime ) >= TEST_FLAP_SECONDS * 1000UL )
+	{
+		flapTime = millis ();
+		Serial.println ( F ( "Test: dropping the WiFi connection" ));
+
+		WiFi.disconnect ();
+		WiFi.begin ( cfg.ssid[wifiIndex], cfg.pwd[wifiIndex] );
+		SetListenInterval ();
+	}
+}
+
+
+/*
+ *	'HeapCheck' records the heap fragmentation after a fetch. With 'SOAK_SECONDS'
+ *	set, it reports it every time.
+ */
+
+void HeapCheck ()
+{
+	uint8_t		frag = HeapFragmentation ();
+
+	if ( fetchCount == 1 )
+		fragFirst = frag;
+
+	fragWorst = max ( fragWorst, frag );
+
+	if (( heapLowest == 0 ) || ( ESP.getFreeHeap () < heapLowest ))
+		heapLowest = ESP.getFreeHeap ();
+
+	if ( SOAK_SECONDS )
+		Serial.printf_P ( PSTR ( "Soak: fetch %u, %u free, largest block %u, fragmentation %u%%\n" ),
+						fetchCount, ESP.getFreeHeap (),
+						ESP.getFreeHeap () * ( 100 - frag ) / 100, frag );
+}
+
+
+/*
+ *	Connection pool functions; added in Version 3.2.
+ *
+ *	Setting up a TLS connection is most of the time and heap a fetch takes: the
+ *	handshake is a lot of arithmetic and the secure client's buffers are most of
+ *	what it allocates. So the connections in 'pool' are kept open after a request
+ *	(with the HTTP client's 'setReuse'), and the next request to the same server
+ *	goes straight out on the same one if the server hasn't closed it. HTTP 1.1
+ *	servers keep a connection open for a while unless they say otherwise; the
+ *	requests go one after the other on it, as the HTTP client has no way to send
+ *	the next one before the last answer is in.
+ *
+ *	Servers don't keep idle connections for long (often 5 to 15 seconds), so this
+ *	helps with things fetched every few seconds, like 'SOAK_SECONDS' and the
+ *	benchmark in 'CmdPool', far more than with the solar data every half hour. On
+ *	the ESP8266 a closed connection keeps its TLS session, so even then the next
+ *	handshake is a short one if the server remembers it.
+ *
+ *	'PoolGet' finds the connection for the server in 'url' (or takes the one that's
+ *	been unused longest and sets it up with 'trust') and starts a request on it.
+ *	'PoolGET' sends it, trying again on a new connection if an open one turns out
+ *	to have been closed at the other end, and 'PoolDone' ends it, keeping the
+ *	connection only if all went well.
+ */
+
+poolConn* PoolGet ( const char* url, trustSetup trust )
+{
+	char		key[POOL_KEY];								// "host:port" for 'url'
+	const char*	host = strstr ( url, "://" );
+	poolConn*	c = nullptr;
+
+	host = host ? host + 3 : url;
+	strncpy ( key, host, POOL_KEY - 1 );
+	key[min ( strcspn ( host, "/" ), ( size_t ) POOL_KEY - 1 )] = 0;
+
+	for ( poolConn& p : pool )								// One for this server?
+		if ( !p.busy && !strcmp ( p.key, key ))
+			c = &p;
+
+	if ( !c )												// No; the one unused longest
+	{
+		for ( poolConn& p : pool )
+			if ( !p.busy && ( !c || !p.key[0]
+					|| ( c->key[0] && (( millis () - p.lastUsed ) > ( millis () - c->lastUsed )))))
+				c = &p;
+
+		if ( !c )											// Shouldn't happen
+			return nullptr;
+
+		PoolSetup ( *c, key, trust );
+	}
+
+	PoolMakeRoom ( c );										// Make room
+
+	if ( c->client.connected () && c->client.available ())	// Something left over
+		c->client.stop ();									// from last time
+
+	c->busy = true;
+	c->http.begin ( c->client, url );
+
+	return c;
+}
+
+
+/*
+ *	'PoolSetup' gets a connection ready for a different server.
+ */
+
+void PoolSetup ( poolConn& c, const char* key, trustSetup trust )
+{
+	c.client.stop ();
+	strcpy ( c.key, key );
+
+	c.requests = c.connects = c.failures = 0;
+	c.lastUsed = millis ();
+
+	trust ( c.client );
+	c.http.setReuse ( true );								// Keep it open
+
+	#if defined ( ESP8266 )
+
+		char		host[POOL_KEY];
+		char*		port;
+		uint16_t	portNum = 443;
+
+		strcpy ( host, key );
+
+		if (( port = strchr ( host, ':' )))
+		{
+			*port++ = 0;
+			portNum = atoi ( port );
+		}
+
+		c.session = BearSSL::Session ();					// Not for this server
+		c.client.setSession ( &c.session );
+
+		if ( BearSSL::WiFiClientSecure::probeMaxFragmentLength ( host, portNum, POOL_RX ))
+			c.client.setBufferSizes ( POOL_RX, POOL_TX );	// Small buffers will do
+
+		Serial.printf_P ( PSTR ( "Pool: %s, %s TLS buffers\n" ), key,
+						c.client.getMFLNStatus () ? "small" : "full size" );
+
+	#endif
+}
+
+
+int16_t PoolGET ( poolConn& c )
+{
+	bool		open = c.client.connected ();				// Still there?
+	uint32_t	ms = millis ();
+	int16_t		code = c.http.GET ();
+
+	if (( code < 0 ) && open )								// It wasn't after all;
+	{														// once more on a new one
+		c.client.stop ();
+		open = false;
+		code = c.http.GET ();
+	}
+
+	ms = millis () - ms;
+	c.requests++;
+
+	if ( open )
+	{
+		poolReused++;
+		poolReusedMs += ms;
+	}
+
+	else
+	{
+		c.connects++;
+		poolNew++;
+		poolNewMs += ms;
+	}
+
+	if ( code < 0 )
+		c.failures++;
+
+	return code;
+}
+
+
+void PoolDone ( poolConn& c, bool ok )
+{
+	c.http.end ();											// Leaves it open if it can
+
+	if ( !ok )												// Start afresh next time
+		c.client.stop ();
+
+	c.busy = false;
+	c.lastUsed = millis ();
+
+	if (( poolHeapLow == 0 ) || ( ESP.getFreeHeap () < poolHeapLow ))
+		poolHeapLow = ESP.getFreeHeap ();
+}
+
+
+/*
+ *	'PoolTidy' closes connections that have been idle for 'POOL_IDLE_MS', freeing
+ *	their TLS buffers. It's called every time around 'loop'.
+ */
+
+void PoolTidy ()
+{
+	for ( poolConn& p : pool )
+		if ( !p.busy && p.key[0] && (( millis () - p.lastUsed ) > POOL_IDLE_MS )
+				&& p.client.connected ())
+			p.client.stop ();
+}
+
+
+/*
+ *	'PoolMakeRoom' closes the idle connections other than 'keep' if there's less
+ *	than 'POOL_MIN_HEAP' free, so a new TLS connection has room for its buffers.
+ *	'SunFetch' and 'ConStart' make their own secure clients, so they call it too.
+ */
+
+void PoolMakeRoom ( const poolConn* keep )
+{
+	if ( ESP.getFreeHeap () >= POOL_MIN_HEAP )
+		return;
+
+	for ( poolConn& p : pool )
+		if ( !p.busy && ( &p != keep ) && p.client.connected ())
+			p.client.stop ();
+}
+
+
+/*
+ *	'SolarTrust' sets up a secure client for 'hamqsl.com' (or the test server).
+ */
+
+void SolarTrust ( WiFiClientSecure& client )
+{
+	#if defined ( ESP32 )						// Different for ESP32
+		client.setCACert ( HQSL_Root_Cert );
+
+	#elif defined ( ESP8266 )					// and ESP8266
+		client.setTrustAnchors ( &cert );
+
+	#endif
+
+	if ( TESTING )								// Test server's certificate
+		client.setInsecure ();					// is its own
+}
+
+
+/*
+ *	'CmdPool' shows the connections in the pool and how long requests took on an
+ *	open connection and on a new one. With "bench" (and only when testing, as it
+ *	hammers the server) it makes 'n' requests to the test server through the pool
+ *	and then 'n' the way they were made before, each on its own new connection,
+ *	and compares the times and the heap.
+ */
+
+void CmdPool ( char* args )
+{
+	if ( strncmp ( args, "bench", 5 ))
+	{
+		for ( poolConn& p : pool )
+			Serial.printf_P ( PSTR ( "  %-24s %-6s %5u requests, %4u connects, %4u failures\n" ),
+							p.key[0] ? p.key : "(unused)",
+							p.key[0] && p.client.connected () ? "open" : "closed",
+							p.requests, p.connects, p.failures );
+
+		Serial.printf_P ( PSTR ( "Open: %u requests, %u ms average; new: %u requests, %u ms average\n" ),
+						poolReused, poolReused ? poolReusedMs / poolReused : 0,
+						poolNew, poolNew ? poolNewMs / poolNew : 0 );
+		Serial.printf_P ( PSTR ( "Heap: %u free, %u lowest after a request\n" ),
+						ESP.getFreeHeap (), poolHeapLow );
+		return;
+	}
+
+	if ( !TESTING )
+	{
+		Serial.println ( F ( "Only with TESTING" ));
+		return;
+	}
+
+	uint16_t	n = max ( atoi ( args + 5 ), 1 );
+
+	for ( int8_t mode = 1; mode >= 0; mode-- )			// Pooled, then not
+	{
+		uint32_t	total = 0, most = 0, heapLow = ESP.getFreeHeap ();
+		uint16_t	ok = 0;
+
+		CpuBoost ();
+
+		for ( uint16_t i = 0; i < n; i++ )
+		{
+			uint32_t	ms = millis ();
+			int16_t		code;
+
+			ArenaReset ();
+
+			if ( mode )
+			{
+				poolConn*	conn = PoolGet ( TEST_URL, &SolarTrust );
+
+				if ( !conn )
+					break;
+
+				ArenaWriter	body ( XML_MAX );
+
+				if (( code = PoolGET ( *conn )) == HTTP_CODE_OK )
+					conn->http.writeToStream ( &body );
+
+				heapLow = min ( heapLow, ESP.getFreeHeap ());
+				PoolDone ( *conn, code == HTTP_CODE_OK );
+			}
+
+			else
+			{
+				void*	clientRoom = ArenaAlloc ( sizeof ( WiFiClientSecure ));
+				void*	httpRoom   = ArenaAlloc ( sizeof ( HTTPClient ));
+
+				if ( !clientRoom || !httpRoom )			// Arena too small
+					break;
+
+				PoolMakeRoom ( nullptr );				// Same rule as the pool
+
+				WiFiClientSecure* client = new ( clientRoom ) WiFiClientSecure;
+				HTTPClient* https = new ( httpRoom ) HTTPClient;
+				ArenaWriter	body ( XML_MAX );
+
+				SolarTrust ( *client );
+				https->begin ( *client, TEST_URL );
+
+				if (( code = https->GET ()) == HTTP_CODE_OK )
+					https->writeToStream ( &body );
+
+				heapLow = min ( heapLow, ESP.getFreeHeap ());
+				https->end ();
+				https->~HTTPClient ();
+				client->~WiFiClientSecure ();
+			}
+
+			ms = millis () - ms;
+			total += ms;
+			most = max ( most, ms );
+			ok += ( code == HTTP_CODE_OK );
+			yield ();
+		}
+
+		ArenaReset ();
+		CpuRelax ();
+
+		Serial.printf_P ( PSTR ( "%s: %u of %u OK, %u ms average, %u ms most, heap %u lowest, %u after\n" ),
+						mode ? "Pooled" : "New each time", ok, n, total / n, most,
+						heapLow, ESP.getFreeHeap ());
+	}
+}
+
+
+/*
+ *	The following functions are all part of the process of getting the solar
+ *	data from hamqsl.com and displaying it on the clock/
+ *
+ *	'GetSolarData' was added by Robert (AI6P) to grab solar conditions as XML from:
+ *	https://www.hamqsl.com/solarxml.php
+ *
+ *	Doing some testing, it looks like the 'AUR', 'BZ' and 'SSN' values are
+ *	updated hourly at about the top of the hour and the 'SFI', 'A', 'K',
+ *	'GMF' and 'S2N' values only update every three hours at about the half hour.
+ *	I don't know about other data items that are not currently being (optionally)
+ *	reported.
+ *
+ *	Checking with Paul (N0NBH), he informs me that quering the website every 15
+ *	minutes would not be a problem, but since it looks like twice an hour would
+ *	be adequate, so that's what we will do.
+ *
+ *	So, we're going to poll the solar data twice per hour shortly after the top
+ *	of the hour and shortly after the half hour. We're going to do that slightly
+ *	randomly using a modification of the algorithm provided by Robert (AI6P).
+ *
+ *	The connection is made with HTTPS encryption using a genuine SSL certificate
+ *	(see Certificate.h). *IF* hamqsl updates their HTTPS certificate you made
+ *	need to update it in the 'Certificate.h' header file.
+ *
+ *	Notice that the process is slightly different depending on whether the ESP32 or
+ *	ESP8266 is being used.
+ *
+ *	If the connection fails, we will retry it every 5 minutes. Once connected, the
+ *	normal polling times will resume.
+ */
+
+void GetSolarData()
+{
+static	int32_t	failTime;						// Time of last failed attempt
+static	bool	retry;							// Need to retry after 10 minutes
+
+	if ( solarPending )							// First time or a failure retry
+	{											// if no previous data
+		pollSec = second ( local.now ());		// We'll poll on this second
+		pollMin = 2 + ( pollSec % 5 );			// on a semi random minute
+		failTime = 0;							// No failures
+		retry = false;							// so no need to retry
+	}
+
+
+/*
+ *	If 'retry' is true and more than 5 minutes (300,000 milliseconds), reset the
+ *	'failTime' and 'retry' variables and and set 'solarPending' which will make
+ *	it look like this is the first time we got here.
+ */
+
+	if ( retry && (( millis () - failTime ) > 300000 ))
+	{
+		failTime = 0;							// Assume no failure
+		retry = false;							// so no need to retry
+		solarPending = true;					// Try again
+	}
+
+
+/*
+ *	If it's time to poll 'hamqsl.com' or the first time here or after
+ *	a failed attempt, do it.
+ *
+ *	'pollMin' has been set to somewhere between 2 and 6. In order to poll shortly
+ *	after the top of the hour and half hour, see see if the remainder of the
+ *	current minute and 'pollMin' divided by 30 are equal; if so, time to poll.
+ */
+
+	bool soak = false;							// Time for a heap test fetch?
+
+	#if SOAK_SECONDS
+		soak = (( t % SOAK_SECONDS ) == 0 );
+	#endif
+
+	if (((( utcCal.minute % 30 ) == ( pollMin % 30 ))
+					&& utcCal.second == pollSec ) || solarPending || soak || fetchNow )
+    {
+		fetchNow = false;
+    	Serial.print ( F ( "Connecting to website: " ));
+    	PrintTime ();
+		PHASE ( PH_FETCH );
+
+		RadioWake ( WAKE_HOLD_MS );					// Full speed radio for this
+		CpuBoost ();								// and processor for the TLS handshake
+
+		uint32_t fetchStart = millis ();			// Time the whole fetch
+
+		ArenaReset ();								// Everything for this fetch goes in the arena
+
+		poolConn* conn = PoolGet ( TESTING ? TEST_URL : SW_URL,	// Set up web connection, or
+							&SolarTrust );					// use the one still open
+		HTTPClient* https = conn ? &conn->http : nullptr;
+		bool fetched = false;								// Got usable data
+
+		PHASE ( PH_FETCH );									// Connect and ask
+		int16_t httpResponseCode = conn ? PoolGET ( *conn )	// Get the response code
+								: HTTPC_ERROR_CONNECTION_REFUSED;
+
+
+/*
+ *	Not sure trying 5 times in rapid succession makes a lot of sense.
+ */
+
+		for ( int16_t i = 0; i < 5; ++i )					// Try up to 5 times
+		{
+			if ( httpResponseCode == HTTP_CODE_OK )			// If we got the data try to use it
+			{
+				void* room = ArenaAlloc ( sizeof ( solarSnapshot ));
+				solarSnapshot* fresh =						// Decoded values
+					room ? new ( room ) solarSnapshot : nullptr;
+				ArenaWriter xml ( XML_MAX );				// Rest of the arena holds the XML
+
+				PHASE ( PH_FETCH );							// Read it
+				https->writeToStream ( &xml );				// Get the XML data
+//				Serial.println ( xml.Text ());				// For debugging
+
+				PHASE ( PH_PARSE );
+
+				solarPending = false;
+
+				if ( fresh && !xml.Overflow ()
+						&& ParseSolarData ( xml.Text (), xml.Length (), *fresh ))
+				{
+					solar = *fresh;							// Keep just what we show
+					fetched = true;
+					Serial.print ( F ( "\nSolar data updated: " ));
+					PrintTime ();
+				}
+
+				else										// Not what we expected; keep
+				{											// the old values and try again
+					Serial.println ( F ( "Solar data rejected, keeping the old values" ));
+					failTime = millis ();
+					retry = true;
+				}
+
+				break;										// Don't retry right away
+			}
 
 
 /*
- *	Get solar data first time or every hour at a random time shortly after
- *	the half hour which is when most of the data is updated.
+ *	If we couldn't connect to the web page, we record the failure time and set
+ *	the need to 'retry' flag.
+ *
+ *	We clear 'solarPending' so we won't retry every time the function is called
+ *	(which is everytime the time changes). Just as with data that got rejected,
+ *	the last good values stay on the display until the retry gets new ones.
+ *	(Until Version 3.2 they were all set to "??".)
  */
 
-	GetSolarData();								// Get new info
-}												// End of 'UpdateDisplay'
+			else											// Connection failed
+			{
+				Serial.print ( F ( "HTTP Error code: " ));	// Print the response code on the
+				Serial.println ( httpResponseCode );		// console if something goes wrong
+				failTime = millis ();						// Record time of failure
+				retry = true;								// and set the 'retry' flag
+				solarPending = false;
+			}
+
+			delay ( 100 );									// 0.1 second
+		}													// End of loop
+
+		PHASE ( PH_FETCH );									// Hang up
+		NetHealthFetch ( fetched );							// For the health monitor
+
+		if ( conn )											// Keep the connection
+			PoolDone ( *conn, fetched );					// if it's good
+
+		ArenaReset ();										// The rest all gone in one go
+
+		fetchStart = millis () - fetchStart;				// How long it took
+		fetchTotalMs += fetchStart;
+		fetchMaxMs = max ( fetchMaxMs, fetchStart );
+		fetchCount++;
+
+		FetchResult ( fetched, httpResponseCode, fetchStart );
+		HeapCheck ();										// See what the fetch left behind
+		CpuRelax ();
+		PHASE ( PH_RENDER );								// Back to the screen
+	}
+}															// End of 'GetSolarData'
 
 
 /*
- *	'ShowClockStatus' checks the WiFi connection and changes the color of the
- *	status circle in the local time header when the connection is lost for
- *	some time.
+ *	'ShowNextData' cycles through the list of pointers to the functions that
+ *	display the selected items from the 'solar' data received from 'hamqsl.com'
+ *	every 'CYCLE_TIME' seconds (or as changed by the settings file).
  *
- *	Modified by WA2FZW in Version 3.0:
+ *	Instructions on how to establish the list can be found in the 'UserSettings.h'
+ *	header file.
+ */
+
+void ShowNextData ()
+{
+	if (( cfg.items == 0 )						// If nothing to display
+				|| ( cfg.cycleTime == 0 ))		// or illegal time setting
+		return;									// do nothing
+
+	if (( utcCal.second % cfg.cycleTime ) == 0 )	// Only change every 'CYCLE_TIME' seconds
+	{
+		dataItems[dataIndex++]();				// Display something
+		PushRegion ( SOLAR_X, UTC_TOP, SCREEN_W - 1 - SOLAR_X, LY ( 34 ));	// and send it to the screen
+		SunDraw ();								// Goes straight to the screen
+		if ( dataIndex >= cfg.items )			// Don't exceed maximum number
+			dataIndex = 0;						// Reset list index
+	}
+}												// End of 'ShowNextData'
+
+
+/*
+ *	The following functions display the various items that the user has decided
+ *	to show in the heading block for the UTC time.
  *
- *		In previous versions, the WiFi signal strength was shown as the
- *		negative of the RSSI (Received Signal Strength Indicator). This
- *		was misleading as the number was always positive and one would
- *		think a larger number would be better, when in fact, the higher
- *		the number, the weaker the signal.
+ *	'ShowSFI' displays the solar flux ('SFI'), and the 'A' and 'K' indicies.
  *
- *		It now displays the actual signal strength in dBm.
+ *	The numbers are color coded to match the colors used in the bar graphs on
+ *	the NOAA solar data site, which are different that the colors that Paul
+ *	uses on the 'hamqsl.com' website.
+ */
+
+void ShowSFI ()
+{
+	const char* sflux = solar.sfi;						// Get the solar flux
+	const char* kindx = solar.kIndex;					// Get the K index
+	const char* aindx = solar.aIndex;					// Get the A index
+
+	int16_t	sfiInt = atoi ( sflux );				// Need numbers
+	int16_t	aInt   = atoi ( aindx );
+	int16_t	kInt   = atoi ( kindx );
+
+	const char* headings = FlashText ( PSTR ( "SFI:           A:           K:   " ));	// Header for the data
+
+
+/*
+ *	First, we handle the solar flux index. It will be shown as normal (< 200) or
+ *	high (200 or higher). Why did I pick those levels? I don't do much HF operating,
+ *	so I don't really know the effect of a high SFI on conditions, but on 6 meters,
+ *	when the SFI is greater than 200, there is a good chance of trans-equatorial
+ *	(TEP) or F2 propagation.
  *
- *	Note at startup it may take a few seconds for the status to be displayed
- *	as it is only checked every 10 seconds.
+ *	The breakpoints can be changed in the 'UserSettings.h' file (or 'clock.cfg').
  */
 
-void ShowClockStatus ()
+	ClearSolarData ();									// Erase previous data
+
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Set label colors
+	gfx->drawString ( headings, SOLAR_X, SOLAR_Y, 4 );			// Paint SFI headers
+
+	gfx->setTextColor ( Ink ( PAL_NORMAL ), Ink ( PAL_LABEL_BG ));	// Assume normal reading
+
+	if ( sfiInt >= cfg.mediumSfi )							// 175 or greater
+		gfx->setTextColor ( Ink ( PAL_MEDIUM ), Ink ( PAL_LABEL_BG ));	// Make number yellow
+
+	if ( sfiInt >= cfg.highSfi )							// 200 or greater
+		gfx->setTextColor ( Ink ( PAL_HIGH ), Ink ( PAL_LABEL_BG ));	// Make number red
+
+	gfx->drawString ( sflux, SOLAR_X + 45, SOLAR_Y + 1, 4 );					// Paint the number
+
+
+/*
+ *	The NOAA breakpoints for the 'A' index are 20 and 30:
+ */
+
+	gfx->setTextColor ( Ink ( PAL_NORMAL ), Ink ( PAL_LABEL_BG ));	// Assume normal reading
+
+	if ( aInt >= cfg.mediumA )								// 'A' 20 or higher?
+		gfx->setTextColor ( Ink ( PAL_MEDIUM ), Ink ( PAL_LABEL_BG ));	// Medium level
+
+	if ( aInt >= cfg.highA )								// 30 or higher?
+		gfx->setTextColor ( Ink ( PAL_HIGH ), Ink ( PAL_LABEL_BG ));	// Highest level
+
+	gfx->drawString ( aindx, SOLAR_X + 125, SOLAR_Y + 1, 4 );					// Show 'A'
+
+
+/*
+ *	The NOAA breakpoints for the 'K' index are 4 and 5:
+ */
+
+	gfx->setTextColor ( Ink ( PAL_NORMAL ), Ink ( PAL_LABEL_BG ));	// Assume normal reading
+
+	if ( kInt >= cfg.mediumK )								// 'K' 4 or higher?
+		gfx->setTextColor ( Ink ( PAL_MEDIUM ), Ink ( PAL_LABEL_BG ));	// Medium level
+
+	if ( kInt >= cfg.highK )								// 5 or higher?
+		gfx->setTextColor ( Ink ( PAL_HIGH ), Ink ( PAL_LABEL_BG ));	// Highest level
+
+	gfx->drawString ( kindx, SOLAR_X + 204, SOLAR_Y + 1, 4 );
+
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Set normal label colors
+}															// End of 'ShowSFI'
+
+
+/*
+ *	'ShowGMF' displays the Geomagnetic Field conditions. For now, there are
+ *	no color codes; I may change that.
+ */
+
+void ShowGMF ()
 {
-	const int16_t x = 257, y = 3, w = 59, h = 27;	// Position and size of the rectangle
-	int16_t	fontSz = 2;								// Font size
-	int16_t color;									// Color of the rectangle
-	int16_t	wifiSignal;								// Integer signal strength
-	String rssi ="";								// ASCII signal strength
+	const char* headings = FlashText ( PSTR ( "GMF:  " ));	// Header
 
-	if ( second () % 10 )				// If the remainder of seconds / 10 not zero
-		return;							// do nothing; i.e. only execute every 10 seconds
+	const char* gmf = solar.gmf;
 
-	if ( WiFi.status() != WL_CONNECTED )			// If WiFi connection lost
-	{
-		tft.setFreeFont  ( &FreeSansBold9pt7b );	// Easier to read than the default
-		WiFi.disconnect ();							// and drop current connection
-		StartupScreen ();							// Erase most of the screen
+	ClearSolarData ();									// Erase previous data
 
-		for ( int8_t i = 0; i < 5; i++ )			// Flash the error message
-		{
-			tft.setTextColor ( TFT_RED, TFT_BLACK );
-			tft.drawString ( "LOST WIFI CONNECTION!", 45, 100 );
-			delay ( 1000 );
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Set label colors
+	gfx->drawString ( headings, SOLAR_X, SOLAR_Y, 4 );			// Paint GMF Header
 
-			tft.setTextColor ( TFT_WHITE, TFT_BLACK );
-			tft.drawString ( "LOST WIFI CONNECTION!", 45, 100 );
-			delay ( 1000 );
-		}
-		
-		ESP.restart ();									// Just start all over!
-	}
+	gfx->setTextColor ( Ink ( PAL_NORMAL ), Ink ( PAL_LABEL_BG ));	// Assume normal reading
 
-	int16_t syncAge = now () - lastNtpUpdateTime ();	// how long has it been since last sync?
+	gfx->drawString ( gmf, SOLAR_X + 70, SOLAR_Y, 4 );				// Paint the value
 
-	if ( syncAge < SYNC_MARGINAL )					// GREEN: time is good & in sync
-		color = TFT_GREEN;
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Normal label colors
+}														// End of 'ShowGMF'
 
-	else if ( syncAge < SYNC_LOST )					// ORANGE: sync is 1-24 hours old
-		color = TFT_ORANGE;
 
-	else color = TFT_RED;							// RED: time is stale, over 24 hrs old
+/*
+ *	'ShowS2N' displays the dignal to noise level apparantely in 'S' units. Again
+ *	I have not added color coding here, but might.
+ */
 
-	tft.fillRoundRect ( x, y, w, h, 6, color );		// Show WiFi status as a color
-	tft.setTextColor ( TFT_BLACK, color );
+void ShowS2N ()											// Signal to noise level
+{
+	const char* headings = FlashText ( PSTR ( "S2N:  " ));	// Header for signal to noise
 
-	wifiSignal = WiFi.RSSI ();						// Read signal strength
-	
-	if ( wifiSignal < -99 )							// Limit to 2 digit value
-		wifiSignal = -99;							// for horizontal space limits
+	const char* s2n = solar.s2n;
 
-	rssi = wifiSignal;								// Assemble ASCII answer
-	rssi += " dBm";
+	ClearSolarData ();									// Erase previous data
 
-	tft.drawString ( rssi, x+6, y+6, fontSz );		// Display it
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Set label colors
+	gfx->drawString ( headings, SOLAR_X, SOLAR_Y, 4 );			// Paint S2N Header
 
-}													// End of 'ShowClockStatus'
+	gfx->setTextColor ( Ink ( PAL_NORMAL ), Ink ( PAL_LABEL_BG ));	// Assume normal reading
+
+	gfx->drawString ( s2n, SOLAR_X + 70, SOLAR_Y, 4 );				// Paint the value
+
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Normal label colors
+}														// End of 'ShowS2N'
 
 
 /*
- *	Modified by John Price (WA2FZW)
- *
- *		In the original code, this was an empty function. I added code to display either
- *		an 'A' or 'P' to the right of the local time. Later changed it to show 'AM'
- *		or 'PM'.
+ *	'ShowAUR' displays the Aurora level and the 'BZ'. Again I have not added
+ *	color coding here, but might will once I have a better understanding of
+ *	what the values mean.
  */
 
-void ShowAMPM ( int16_t hr, int16_t x, int16_t y )
+void ShowAUR ()											// Aurora level
 {
-	char ampm;									// Will be either 'A' or 'P'
+	const char* headings = FlashText ( PSTR ( "AUR:          BZ:" ));	// Header for Aurora & BZ
 
-	if ( hr <= 11 )								// If the hour is 11 or less
-		ampm = 'A';								// It's morning
-	else										// Otherwise,
-		ampm = 'P';								// it must be afternoon (DOH!)
+	const char* aur = solar.aurora;
+	const char* bz  = solar.bz;
 
-	tft.drawChar ( ampm, x + 2, y - 12, 4 );	// Show 'A' or 'P'
-	tft.drawChar ( 'M', x, y + 12, 4 );			// And 'M'
-}												// End of 'ShowAMPM'
+	ClearSolarData ();									// Erase previous data
 
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Set label colors
+	gfx->drawString ( headings, SOLAR_X, SOLAR_Y, 4 );			// Paint AUR Header
+
+	gfx->setTextColor ( Ink ( PAL_NORMAL ), Ink ( PAL_LABEL_BG ));	// Assume normal reading
+
+	gfx->drawString ( aur, SOLAR_X + 70, SOLAR_Y, 4 );				// Paint the AUR value
+	gfx->drawString ( bz,  SOLAR_X + 155, SOLAR_Y, 4 );				// and the BZ value
+
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Normal label colors
+}														// End of 'ShowAUR'
+
+
+/*
+ *	'ShowSSN' displays the current number of sunspots. Again I have not added color
+ *	coding here.
+ */
 
-void ShowTime ( time_t t, bool hr12, int16_t x, int16_t y )
+void ShowSSN ()											// Sunspot count
 {
-	const int16_t fontSz = 7;						// Font size
-	tft.setTextColor ( TIMECOLOR, TFT_BLACK );		// Set time color
+	const char* headings = FlashText ( PSTR ( "SSN:  " ));	// Header for sunspot count
 
-	int16_t h = hour ( t );						// Get hours, minutes, and seconds
-	int16_t m = minute ( t );
-	int16_t s = second ( t );
+	const char* ssn = solar.ssn;
 
-	if ( hr12 )										// If using 12hr time format,
-	{
-		if ( DISPLAY_AMPM )							// If showing AM/PM
-			ShowAMPM ( h, x + 220, y + 14 );		// Show it
- 
-		if ( h == 0 )								// 00:00 becomes 12:00
-			h = 12;
+	ClearSolarData ();									// Erase previous data
 
-		if ( h > 12 )								// 13:00 becomes 01:00
-			h -= 12;
-	}
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Set label colors
+	gfx->drawString ( headings, SOLAR_X, SOLAR_Y, 4 );			// Paint SSN Header
 
-	if ( h < 10 )										// Is hour a single digit?
-	{
-		if (( !hr12 ) || ( HOUR_LEADING_ZERO ))			// 24hr format: always use leading 0
-			x += tft.drawChar ( '0', x, y, fontSz );	// Show leading zero for hours
+	gfx->setTextColor ( Ink ( PAL_NORMAL ), Ink ( PAL_LABEL_BG ));	// Assume normal reading
 
-		else
-		{
-			tft.setTextColor ( TFT_BLACK, TFT_BLACK );	// Black on black text
-			x += tft.drawChar ( '8', x, y, fontSz );	// Will erase the old digit
-			tft.setTextColor ( TIMECOLOR, TFT_BLACK );	// Reset proper color
-		}
+	gfx->drawString ( ssn, SOLAR_X + 70, SOLAR_Y, 4 );				// Paint the value
+
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Normal label colors
+}														// End of 'ShowSSN'
+
+
+/*
+ *	Simple function to erase any previous solar data that was in the UTC
+ *	header block. Assumes that the solar data always starts at 'SOLAR_X'.
+ */
+
+void ClearSolarData ()
+{
+	sunShowing = false;									// Unless 'ShowSUN' puts it back
+	gfx->fillRoundRect ( SOLAR_X, UTC_TOP, SCREEN_W - 1, LY ( 32 ), 10, Ink ( PAL_LABEL_BG ));	// Title bar for UTC
+	gfx->drawRoundRect ( 0, UTC_TOP, SCREEN_W - 1, BOX_H, 10, Ink ( PAL_EDGE ));	// Draw edge around UTC
+}
+
+
+/*
+ *	Sun picture functions; added in Version 3.2.
+ *
+ *	'ShowSUN' is the solar data item for the picture of the sun from 'SUN_URL'. It
+ *	only paints the heading and the time the picture was fetched; 'PushRegion'
+ *	would cover the picture itself with the sprite's copy of the title bar, so
+ *	'SunDraw' puts that straight on the screen afterwards. If the picture is more
+ *	than 'SUN_REFRESH' seconds old (or there isn't one), 'SunPoll' gets a new one
+ *	on the next pass through 'loop'.
+ */
+
+void ShowSUN ()
+{
+static	bool	looked = false;								// For one in the file system
+
+	const char* headings = FlashText ( PSTR ( "SUN:  " ));	// Header for the picture
+	char		when[8] = "??";								// Time it was fetched
+
+	ClearSolarData ();										// Erase previous data
+	sunShowing = true;
+
+	if ( !looked )											// First time here
+	{
+		sunFetched = SunCacheTime ();
+		looked = true;
 	}
 
-	x += tft.drawNumber ( h, x, y, fontSz );			// Show hours
-	x += tft.drawChar ( ':', x, y, fontSz );			// Show ':'
+	if ( sunFetched )
+		sprintf ( when, "%02u:%02u", ( uint16_t ) (( sunFetched / 3600 ) % 24 ),
+								( uint16_t ) (( sunFetched / 60 ) % 60 ));
 
-	if ( m < 10)										// Single digit minutes?
-		x += tft.drawChar ( '0', x, y, fontSz );		// Always a leading zero for minutes
+	if ( !sunFetched || (( t - sunFetched ) >= SUN_REFRESH ))
+		sunWanted = true;									// Time for a new one
 
-	x += tft.drawNumber ( m, x, y, fontSz );			// Show minutes
-	x += tft.drawChar ( ':', x, y, fontSz );			// Another ':'
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Set label colors
+	gfx->drawString ( headings, SOLAR_X, SOLAR_Y, 4 );			// Paint SUN Header
 
-	if ( s < 10 )										// Single digit seconds?
-		x += tft.drawChar ( '0', x, y, fontSz );		// Always a leading zero for seconds
+	gfx->setTextColor ( Ink ( PAL_NORMAL ), Ink ( PAL_LABEL_BG ));
+	gfx->drawString ( when, SUN_X + SUN_SIZE + 10, SOLAR_Y, 4 );	// and the time
 
-	x += tft.drawNumber ( s, x, y, fontSz );			// Show seconds
-}														// End of ShowTIme
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Normal label colors
+}														// End of 'ShowSUN'
 
 
-void ShowDate ( time_t t, int16_t x, int16_t y )
+/*
+ *	'SunCacheTime' gives the time the picture in 'SUN_FILE' was fetched, or 0 if
+ *	there isn't a good one.
+ */
+
+time_t SunCacheTime ()
 {
-	const int16_t fontSz = 4;							// Font size
-	const int16_t yspacing = 30;						// Vertical spacing
-	const char* months[] = { "JAN", "FEB", "MAR",		// Should be obvious!
-							 "APR", "MAY", "JUN",
-							 "JUL", "AUG", "SEP",
-							 "OCT", "NOV", "DEC" };
+	sunCache	head;
 
-	int16_t i = 0;										// ???
-	int16_t m = month ( t ) - 1;						// Index to above array
-	int16_t d = day ( t );								// Just a number
+	if ( !fsReady || !LittleFS.exists ( SUN_FILE ))
+		return 0;
 
-	tft.setTextColor ( DATECOLOR, TFT_BLACK );			// Set proper colors
-	tft.fillRect ( x, y, 50, 60, TFT_BLACK );			// Erase previous date
+	File	f = LittleFS.open ( SUN_FILE, "r" );
 
-	if ( DATE_ABOVE_MONTH )								// Show date on top?
+	if ( !f || ( f.read (( uint8_t* ) &head, sizeof ( head )) != sizeof ( head ))
+			|| ( head.magic != SUN_MAGIC ))
+		return 0;
+
+	return head.time;
+}
+
+
+/*
+ *	'SunDraw' unpacks the picture in 'SUN_FILE' a row at a time onto the screen, if
+ *	'ShowSUN' is showing.
+ */
+
+void SunDraw ()
+{
+	sunCache	head;
+	uint16_t	line[SUN_SIZE];								// One row of the picture
+	bool		swap;										// Caller's byte swapping
+
+	if ( !sunShowing || !sunFetched || !fsReady )
+		return;
+
+	File	f = LittleFS.open ( SUN_FILE, "r" );
+
+	if ( !f || ( f.read (( uint8_t* ) &head, sizeof ( head )) != sizeof ( head ))
+			|| ( head.magic != SUN_MAGIC ) || ( head.w > SUN_SIZE ) || ( head.h > SUN_SIZE ))
+		return;
+
+	swap = tft.getSwapBytes ();
+	tft.setSwapBytes ( true );								// Packed as normal RGB565
+	tft.startWrite ();
+
+	for ( uint16_t row = 0; row < head.h; row++ )
 	{
-		if (( DATE_LEADING_ZERO ) && ( d < 10 ))		// Do we need a leading zero?
-			i = tft.drawNumber ( 0, x, y, fontSz );		// Draw leading zero
+		if ( !SunUnpack ( f, line, head.w ))				// Cut short; show what
+			break;											// there is
 
-		tft.drawNumber ( d, x + i, y, fontSz );			// Draw date
-		y += yspacing;									// Y position for month
-		tft.drawString ( months[m], x, y, fontSz );		// Draw month
+		tft.pushImage ( SUN_X + ( SUN_SIZE - head.w ) / 2,
+						SUN_Y + ( SUN_SIZE - head.h ) / 2 + row, head.w, 1, line );
+		pushedPixels += head.w;
 	}
 
-	else												// Month goes on top		
+	tft.endWrite ();
+	tft.setSwapBytes ( swap );
+}
+
+
+/*
+ *	'SunPack' packs a row of the new picture into 'SUN_TEMP' (see 'SunPack.h' for
+ *	how) and 'SunUnpack' gets one back out of 'SUN_FILE'.
+ */
+
+void SunPack ( sunJob& job, const uint16_t* px )
+{
+	uint8_t		packed[SUN_PACKED ( SUN_SIZE )];			// The row packed
+
+	job.packed += job.file.write ( packed, SunPackRow ( px, job.w, packed ));
+}
+
+
+bool SunUnpack ( File& f, uint16_t* px, uint16_t w )
+{
+	uint16_t	i = 0;										// Next pixel to fill
+	uint16_t	n;											// How many this time
+	uint16_t	pixel;
+	int16_t		count;
+
+	while ( i < w )
 	{
-		tft.drawString ( months[m], x, y, fontSz );		// Draw month
-		y += yspacing;									// Vertical space for day
-
-		if (( DATE_LEADING_ZERO ) && ( d < 10 ))		// Do we need a leading zero?
-			x += tft.drawNumber ( 0, x, y, fontSz );	// Yep, draw it
+		count = f.read ();
 
-		tft.drawNumber ( d, x, y, fontSz );				// Draw date
-	}
-}														// End of 'ShowDate'
+		if ( count < 0 )									// Ran out
+			return false;
 
+		n = ( count < 128 ) ? count + 1 : count - 126;
 
-void ShowTimeZone ( int16_t x, int16_t y )
-{
-	const int16_t fontSz = 4;							// Font size
+		if ( i + n > w )									// Not ours
+			return false;
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );	// Set text colors
+		if ( count < 128 )
+		{
+			if ( f.read (( uint8_t* ) ( px + i ), n * 2 ) != n * 2 )
+				return false;
+		}
 
-	if ( !useLocalTime )
-		tft.drawString ( "UTC", x, y + 3, fontSz );		// UTC time
-	else
-	{
-		tft.fillRoundRect ( 2, 2, 75, 33, 10, LABEL_BGCOLOR );
-		tft.drawString ( local.getTimezoneName(),
-								x, y + 2, fontSz);		// Show local time zone
-	}
-}														// End of 'ShowTimeZone'
+		else
+		{
+			if ( f.read (( uint8_t* ) &pixel, 2 ) != 2 )
+				return false;
 
+			for ( uint16_t k = 0; k < n; k++ )
+				px[i + k] = pixel;
+		}
 
-void ShowTimeDate ( time_t t, time_t oldT, bool hr12, int16_t x, int16_t y )
-{
-	ShowTime ( t, hr12, x, y );							// Display time HH:MM:SS
+		i += n;
+	}
 
-	if (( !oldT ) || ( hour ( t ) != hour ( oldT )))	// Did hour change?
-		ShowTimeZone ( x, y - 42 );						// Yes, update time zone
+	return true;
+}
 
-	if (( !oldT ) || ( day ( t ) != day ( oldT )))		// Did date change?
-		ShowDate ( t, x + 250, y );						// Yes, update it
-}														// End of 'ShowTimeDate'
 
-										
 /*
- *	Currently gives the option to show UTC or local time; why not both?
+ *	'SunPoll' gets a new picture if 'ShowSUN' wants one, the network is up, a
+ *	firmware update isn't coming in and it's been 'SUN_RETRY_MS' since the last
+ *	try that failed.
  */
 
-void PrintTime ()											// Print time to serial port
+void SunPoll ()
 {
-	if ( !PRINTED_TIME )									// Option 0: dont print
+	if ( !sunWanted || ota || ( WiFi.status () != WL_CONNECTED ))
 		return;
 
-	if ( PRINTED_TIME == 1 )								// Option 1: print UTC time
-		Serial.println ( dateTime ( TIME_FORMAT ));
+	sunWanted = false;
 
-	else
-		Serial.println ( local.dateTime ( TIME_FORMAT ));	// Option 2: print local time
-}															// End of 'PrintTime'
+	if ( sunFailed && (( millis () - sunFailed ) < SUN_RETRY_MS ))
+		return;
+
+	SunFetch ();
+}
 
 
 /*
- *	The following functions are all part of the process of getting the solar
- *	data from hamqsl.com and displaying it on the clock/
- *
- *	'GetSolarData' was added by Robert (AI6P) to grab solar conditions as XML from:
- *	https://www.hamqsl.com/solarxml.php
- *
- *	Doing some testing, it looks like the 'AUR', 'BZ' and 'SSN' values are
- *	updated hourly at about the top of the hour and the 'SFI', 'A', 'K',
- *	'GMF' and 'S2N' values only update every three hours at about the half hour.
- *	I don't know about other data items that are not currently being (optionally)
- *	reported.
+ *	'SunFetch' gets the JPEG picture and decodes it as it comes in with ChaN's
+ *	'tjpgd' (from the 'TJpg_Decoder' library), so the whole picture is never in
+ *	memory at once; 'SunInput' feeds it from the HTTPS stream and 'SunOutput' gets
+ *	each block of pixels as it's decoded, puts it on the screen and packs it into
+ *	'SUN_TEMP' a row of blocks at a time. The decoder scales the picture down by
+ *	1/2, 1/4 or 1/8 to fit in 'SUN_SIZE' pixels; the usual 256 pixel one comes out
+ *	32 pixels square.
  *
- *	Checking with Paul (N0NBH), he informs me that quering the website every 15
- *	minutes would not be a problem, but since it looks like twice an hour would
- *	be adequate, so that's what we will do.
- *
- *	So, we're going to poll the solar data twice per hour shortly after the top
- *	of the hour and shortly after the half hour. We're going to do that slightly
- *	randomly using a modification of the algorithm provided by Robert (AI6P).
- *
- *	The connection is made with HTTPS encryption using a genuine SSL certificate
- *	(see Certificate.h). *IF* hamqsl updates their HTTPS certificate you made
- *	need to update it in the 'Certificate.h' header file.
- *
- *	Notice that the process is slightly different depending on whether the ESP32 or
- *	ESP8266 is being used.
- *
- *	If the connection fails, we will retry it every 5 minutes. Once connected, the
- *	normal polling times will resume.
+ *	Everything, the decoder's work area included, comes out of the arena, like the
+ *	solar data fetch. The decoder needs about 3K of it; how much it really used is
+ *	printed with the result ('sun_bench.sh' in the 'Software' folder does the same
+ *	decoding on a computer). Only a complete picture replaces 'SUN_FILE'.
  */
 
-void GetSolarData()
+void SunFetch ()
 {
-static	int16_t pollMin = 2;					// Or 32 plus up to 4 minutes
-static	int16_t pollSec = 0;					// The second at which we'll update
+	JDEC		jd;											// Decoder's state
+	JRESULT		result = JDR_INP;							// and how it went
+	sunCache	head = {};
+	size_t		poolSize = 0;								// Decoder's work area
+	uint8_t		scale = 0;									// 1/2 ^ 'scale'
+	uint32_t	ms = millis ();								// Time the whole thing
 
-static	int32_t	failTime;						// Time of last failed attempt
-static	bool	retry;							// Need to retry after 10 minutes
+	Serial.print ( F ( "Sun: fetching at " ));
+	PrintTime ();
+	PHASE ( PH_FETCH );
 
-	if ( xmlData == "" )						// First time or a failure retry
-	{											// if no previous data
-		pollSec = second ( local.now ());		// We'll poll on this second
-		pollMin = 2 + ( pollSec % 5 );			// on a semi random minute
-		failTime = 0;							// No failures
-		retry = false;							// so no need to retry
-	}
+	RadioWake ( WAKE_HOLD_MS );								// Full speed radio for this
+	CpuBoost ();											// and processor for the TLS handshake
+	PoolMakeRoom ( nullptr );								// Idle connections go first
 
+	ArenaReset ();
 
-/*
- *	If 'retry' is true and more than 5 minutes (300,000 milliseconds), reset the
- *	'failTime' and 'retry' variables and and make 'xmlData' a null string which
- *	will make it look like this is the first time we got here.
- */
+	void*	clientRoom = ArenaAlloc ( sizeof ( WiFiClientSecure ));
+	void*	httpRoom   = ArenaAlloc ( sizeof ( HTTPClient ));
+	void*	jobRoom    = ArenaAlloc ( sizeof ( sunJob ));
 
-	if ( retry && (( millis () - failTime ) > 300000 ))
+	if ( !clientRoom || !httpRoom || !jobRoom )				// Arena too small
 	{
-		failTime = 0;							// Assume no failure
-		retry = false;							// so no need to retry
-		xmlData = "";							// Erase the data
+		Serial.println ( F ( "Sun: not enough room in the arena" ));
+		sunFailed = millis () | 1;							// Not 0
+		ArenaReset ();
+		CpuRelax ();
+		PHASE ( PH_LOOP );
+		return;
 	}
 
+	WiFiClientSecure* client = new ( clientRoom ) WiFiClientSecure;
+	HTTPClient* https = new ( httpRoom ) HTTPClient;
+	sunJob* job = new ( jobRoom ) sunJob ();
+
 
 /*
- *	If it's time to poll 'hamqsl.com' or the first time here or after
- *	a failed attempt, do it.
- *
- *	'pollMin' has been set to somewhere between 2 and 6. In order to poll shortly
- *	after the top of the hour and half hour, see see if the remainder of the
- *	current minute and 'pollMin' divided by 30 are equal; if so, time to poll.
+ *	We don't have a certificate for the picture's server; a bad picture is the
+ *	worst it can do, and the decoder checks everything it reads. HTTP 1.0 means
+ *	the JPEG comes without any chunk headers mixed in.
  */
 
-	if (((( minute(t) % 30 ) == ( pollMin % 30 ))
-					&& second(t) == pollSec ) || xmlData == "" )
-    {
-    	Serial.print ( "Connecting to website: " );
-    	PrintTime ();
-   
-		WiFiClientSecure client;					// Set up web connection
-		HTTPClient https;
+	client->setInsecure ();
+	https->useHTTP10 ( true );
+	https->begin ( *client, TESTING ? TEST_SUN_URL : SUN_URL );
 
-		#if defined ( ESP32 )						// Different for ESP32
-			client.setCACert ( HQSL_Root_Cert );	
+	int16_t code = https->GET ();
 
-		#elif defined ( ESP8266 )					// and ESP8266
-			client.setTrustAnchors ( &cert );
-
-		#endif
+	if ( code == HTTP_CODE_OK )
+	{
+		job->stream = https->getStreamPtr ();
+		job->stream->setTimeout ( SUN_TIMEOUT_MS );
 
-		bool connected = https.begin ( client, SW_URL );	// Open the URL connection
+		void*	work = nullptr;								// Decoder's work area
 
-		int16_t httpResponseCode = https.GET ();			// Get the response code
+		if ( ArenaRoom () >= SUN_ROWS + SUN_WORK )			// Leave room for 'rows'
+		{
+			poolSize = ( ArenaRoom () - SUN_ROWS ) & ~7;
+			work = ArenaAlloc ( poolSize );
+		}
 
+		result = work ? jd_prepare ( &jd, SunInput, work, poolSize, job ) : JDR_MEM1;
 
-/*
- *	Not sure trying 5 times in rapid succession makes a lot of sense.
- */
+		while (( result == JDR_OK ) && ( scale < 3 )
+				&& ((( jd.width >> scale ) > SUN_SIZE ) || (( jd.height >> scale ) > SUN_SIZE )))
+			scale++;
 
-		for ( int16_t i = 0; i < 5; ++i )					// Try up to 5 times
+		if (( result == JDR_OK )
+				&& ((( jd.width >> scale ) > SUN_SIZE ) || (( jd.height >> scale ) > SUN_SIZE )))
 		{
-			if ( httpResponseCode > 0 )						// If we got a response try to use it
-			{
-				xmlData = https.getString ();				// Get the XML data
-//				Serial.println ( xmlData );					// For debugging
+			Serial.printf_P ( PSTR ( "Sun: %u x %u is too big\n" ), jd.width, jd.height );
+			result = JDR_PAR;
+		}
 
-				Serial.print ( "\nSolar data updated: " );
-				PrintTime ();
+		if ( result == JDR_OK )
+		{
+			job->w = jd.width >> scale;
+			job->h = jd.height >> scale;
+			job->x = ( SUN_SIZE - job->w ) / 2;
+			job->y = ( SUN_SIZE - job->h ) / 2;
+			job->rowsH = max (( jd.msy * 8 ) >> scale, 1 );
+			job->rows = ( uint16_t* ) ArenaAlloc ( job->w * job->rowsH * 2 );
+		}
 
-				break;										// OK we're good, don't retry
-			}
+		if (( result == JDR_OK ) && !job->rows )			// Shouldn't happen
+			result = JDR_MEM1;
 
+		if ( result == JDR_OK )
+		{
+			if ( fsReady )
+				job->file = LittleFS.open ( SUN_TEMP, "w" );
 
-/*
- *	If we couldn't connect to the web page, we record the failure time and set
- *	the need to 'retry' flag.
- *
- *	We put the string "Missing' into the 'xmlData'. That accomplishes two things.
- *	Because 'xmlData' is not a null string, we won't retry every time the function
- *	is called (which is everytime the time changes). 
- *
- *	Since there is no valid solar data in 'xmlData' all the displayed info will
- *	show '??' indicating we couldn't get the data.
- */
+			head.w = job->w;
+			head.h = job->h;
+			job->file.write (( const uint8_t* ) &head, sizeof ( head ));	// Not good yet
 
-			else											// Connection failed
-			{
-				Serial.print ( "HTTP Error code: ");		// Print the response code on the
-				Serial.println ( httpResponseCode );		// console if something goes wrong
-				failTime = millis ();						// Record time of failure
-				retry = true;								// and set the 'retry' flag
-				xmlData = "Missing";						// No valid data
-			}
+			bool	swap = tft.getSwapBytes ();
+			tft.setSwapBytes ( true );						// 'tjpgd' gives normal RGB565
 
-			delay ( 100 );									// 0.1 second
-		}													// End of loop
+			result = jd_decomp ( &jd, SunOutput, scale );
 
-		https.end ();										// Free resources
+			tft.setSwapBytes ( swap );
+		}
 	}
-}															// End of 'GetSolarData'
 
+	PHASE ( PH_FETCH );										// Hang up
+	ms = millis () - ms;
 
-/*
- *	'GetXmlData' is a poor man's xml tag extraction function added by Robert (AI6P)
- *	rather than pulling in an entire XML library when it wasn't really that necessary.
- *	It's pretty straightforward. Just use 'indexof' to find the tag locations and pull
- *	out the value with substring.
- *
- *	Note that this only works on the items in the XML data that are in the form:
- *
- *		<sunspots>51</sunspots>
- *
- *	There is data in the XML data that takes different forms.
- */
+	if (( result == JDR_OK ) && ( job->rowTop == job->h ))
+	{
+		sunFetched = t;
+		sunFailed = 0;
 
-String GetXmlData ( String xml, String tag )
-{
-	int16_t i = xml.indexOf ( "<" + tag + ">" );			// Where the beginning tag is
-	int16_t j = xml.indexOf ( "</" + tag + ">" );			// and the ending tag
+		if ( job->file )
+		{
+			head.magic = SUN_MAGIC;							// Now it's good
+			head.time = t;
+			job->file.seek ( 0 );
+			job->file.write (( const uint8_t* ) &head, sizeof ( head ));
+			job->file.close ();
+
+			LittleFS.remove ( SUN_FILE );
+			LittleFS.rename ( SUN_TEMP, SUN_FILE );
+		}
 
-	String val = "";										// Data value
+		Serial.printf_P ( PSTR ( "Sun: %u bytes, %u x %u at 1/%u in %u ms; decoder used %u of %u bytes, %u packed\n" ),
+						job->bytes, jd.width, jd.height, 1 << scale, ms,
+						poolSize - jd.sz_pool, poolSize, job->packed + sizeof ( head ));
+	}
 
-	if ( i > 0 && j > i && j < xml.length ())				// Sanity check
+	else
 	{
-		val = xml.substring (i + tag.length() + 2, j );		// Get the data between the tags
-		val.trim ();										// Eliminate whitespace
-		return val;
+		sunFailed = millis () | 1;							// Not 0
+		job->file.close ();
+
+		Serial.printf_P ( PSTR ( "Sun: failed after %u ms, HTTP code %d, decoder result %d\n" ),
+						ms, code, result );
 	}
 
-	else
-		return "??";					// If we didn't find anything then use this
-}										// End of 'GetXmlData'
+	job->~sunJob ();										// Free everything
+	https->end ();
+	https->~HTTPClient ();
+	client->~WiFiClientSecure ();
+	ArenaReset ();
+
+	CpuRelax ();
+	PHASE ( PH_LOOP );
+}
 
 
 /*
- *	'ShowNextData' cycles through the list of pointers to the functions that
- *	display the selected items from the 'xmlData' received from 'hamqsl.com'
- *	every 'CYCLE_TIME' seconds.
- *
- *	Instructions on how to establish the list can be found in the 'UserSettings.h'
- *	header file.
+ *	'SunInput' is how 'tjpgd' reads the JPEG: 'len' bytes into 'buf', or skipped
+ *	if 'buf' is null. Anything short of 'len' tells it the stream has stopped.
  */
 
-void ShowNextData ()
+size_t SunInput ( JDEC* jd, uint8_t* buf, size_t len )
 {
-	if (( DATA_ITEMS == 0 )						// If nothing to display
-				|| ( CYCLE_TIME == 0 ))			// or illegal time setting
-		return;									// do nothing
+	sunJob*		job = ( sunJob* ) jd->device;
+	uint8_t		skip[64];									// For the skipped bytes
+	size_t		got = 0;									// Bytes so far
+	size_t		n;
 
-	if (( second ( t ) % CYCLE_TIME ) == 0 )	// Only change every 'CYCLE_TIME' seconds
+	PHASE ( PH_FETCH );										// Still coming in
+
+	while ( got < len )
 	{
-		dataItems[dataIndex++]();				// Display something
-		if ( dataIndex >= DATA_ITEMS )			// Don't exceed maximum number
-			dataIndex = 0;						// Reset list index
+		n = buf ? job->stream->readBytes ( buf + got, len - got )
+				: job->stream->readBytes ( skip, min ( len - got, sizeof ( skip )));
+
+		if ( n == 0 )										// Waited 'SUN_TIMEOUT_MS'
+			break;
+
+		got += n;
 	}
-}												// End of 'ShowNextData'
+
+	job->bytes += got;
+	return got;
+}
 
 
 /*
- *	The following functions display the various items that the user has decided
- *	to show in the heading block for the UTC time.
- *
- *	'ShowSFI' displays the solar flux ('SFI'), and the 'A' and 'K' indicies.
- *
- *	The numbers are color coded to match the colors used in the bar graphs on
- *	the NOAA solar data site, which are different that the colors that Paul
- *	uses on the 'hamqsl.com' website.
+ *	'SunOutput' gets each decoded block from 'tjpgd', in order across and then down
+ *	the picture. The blocks are pushed straight to their place on the screen and
+ *	kept in 'rows' until the end of the row of blocks, which is then packed into
+ *	'SUN_TEMP'. Returning 0 stops the decoder.
  */
 
-void ShowSFI ()
+int SunOutput ( JDEC* jd, void* bitmap, JRECT* rect )
 {
-	String sflux = GetXmlData ( xmlData, "solarflux" );	// Get the solar flux
-	String kindx = GetXmlData ( xmlData, "kindex" );	// Get the K index
-	String aindx = GetXmlData ( xmlData, "aindex" );	// Get the A index
-
-	int16_t	sfiInt = sflux.toInt ();				// Need numbers
-	int16_t	aInt   = aindx.toInt ();
-	int16_t	kInt   = kindx.toInt ();
+	sunJob*		job = ( sunJob* ) jd->device;
+	uint16_t*	px = ( uint16_t* ) bitmap;
+	uint16_t	w = rect->right - rect->left + 1;
+	uint16_t	h = rect->bottom - rect->top + 1;
 
-	String headings = "SFI:           A:           K:   ";	// Header for the data
+	if (( rect->right >= job->w ) || ( rect->top < job->rowTop )
+			|| ( rect->bottom >= job->rowTop + job->rowsH ))	// Shouldn't happen
+		return 0;
 
+	if ( sunShowing )
+	{
+		tft.pushImage ( SUN_X + job->x + rect->left, SUN_Y + job->y + rect->top, w, h, px );
+		pushedPixels += w * h;
+	}
 
-/*
- *	First, we handle the solar flux index. It will be shown as normal (< 200) or
- *	high (200 or higher). Why did I pick those levels? I don't do much HF operating,
- *	so I don't really know the effect of a high SFI on conditions, but on 6 meters,
- *	when the SFI is greater than 200, there is a good chance of trans-equatorial
- *	(TEP) or F2 propagation.
- *
- *	The breakpoints can be changed in the 'UserSettings.h' file.
- */
-
-	ClearSolarData ();									// Erase previous data
+	for ( uint16_t r = 0; r < h; r++ )
+		memcpy ( job->rows + ( rect->top - job->rowTop + r ) * job->w + rect->left,
+				 px + r * w, w * 2 );
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );	// Set label colors
-	tft.drawString ( headings, 80, 133, 4 );			// Paint SFI headers
+	if ( rect->right == job->w - 1 )						// End of a row of blocks
+	{
+		for ( uint16_t r = job->rowTop; r <= rect->bottom; r++ )
+			SunPack ( *job, job->rows + ( r - job->rowTop ) * job->w );
 
-	tft.setTextColor ( COLOR_NORMAL	, LABEL_BGCOLOR );	// Assume normal reading
+		job->rowTop = rect->bottom + 1;
+	}
 
-	if ( sfiInt >= MEDIUM_SFI )								// 175 or greater
-		tft.setTextColor ( COLOR_MEDIUM, LABEL_BGCOLOR );	// Make number yellow
+	return 1;
+}
 
-	if ( sfiInt >= HIGH_SFI )								// 200 or greater
-		tft.setTextColor ( COLOR_HIGH, LABEL_BGCOLOR );		// Make number red
 
-	tft.drawString ( sflux, 125, 134, 4 );					// Paint the number
+void CmdSun ( char* args )
+{
+	sunFailed = 0;
+	SunFetch ();										// Prints how it went
+}
 
 
 /*
- *	The NOAA breakpoints for the 'A' index are 20 and 30:
+ *	Contest calendar functions; added in Version 3.2.
+ *
+ *	'ShowCON' is the solar data item for the next contest in 'conList' (see
+ *	'Contests.h'): the time until it starts, in hours and minutes (or days, if it's
+ *	more than 99 hours off), and as much of its name as fits. If the list is old,
+ *	or it has run out and there could be more in the calendar, 'ConPoll' reads the
+ *	calendar again.
  */
 
-	tft.setTextColor ( COLOR_NORMAL	, LABEL_BGCOLOR );		// Assume normal reading
+void ShowCON ()
+{
+	const char* headings = FlashText ( PSTR ( "CON:  " ));	// Header for the contests
+	char		when[8] = "??";								// Time to the next one
+	char		name[CON_NAME] = "";						// and what it is
+	uint8_t		next = ConNext ( conList, conCount, t );	// Which one that is
+	int16_t		room = SCREEN_W - 10 - ( SOLAR_X + 150 );	// Pixels for the name
 
-	if ( aInt >= MEDIUM_A )									// 'A' 20 or higher?
-		tft.setTextColor ( COLOR_MEDIUM, LABEL_BGCOLOR );	// Medium level
+	ClearSolarData ();										// Erase previous data
 
-	if ( aInt >= HIGH_A )									// 30 or higher?
-		tft.setTextColor ( COLOR_HIGH, LABEL_BGCOLOR );		// Highest level
+	if ( !conFetched || (( t - conFetched ) >= CON_REFRESH )
+			|| (( next == conCount ) && ( conCount == CON_MAX )))
+		conWanted = true;									// Time to read it again
 
-	tft.drawString ( aindx, 205, 134, 4 );					// Show 'A'
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Set label colors
+	gfx->drawString ( headings, SOLAR_X, SOLAR_Y, 4 );			// Paint CON Header
 
+	gfx->setTextColor ( Ink ( PAL_NORMAL ), Ink ( PAL_LABEL_BG ));	// Assume it's a while off
 
-/*
- *	The NOAA breakpoints for the 'K' index are 4 and 5:
- */
+	if ( next < conCount )
+	{
+		uint32_t	wait = ( conList[next].start - t ) / 60;	// Minutes to go
 
-	tft.setTextColor ( COLOR_NORMAL, LABEL_BGCOLOR );		// Assume normal reading
+		if ( wait < 100 * 60 )
+			sprintf ( when, "%02u:%02u", ( uint16_t ) ( wait / 60 ), ( uint16_t ) ( wait % 60 ));
+		else
+			sprintf ( when, "%ud", ( uint16_t ) ( wait / ( 24 * 60 )));
+
+		if ( wait < 60 )										// Within the hour
+			gfx->setTextColor ( Ink ( PAL_MEDIUM ), Ink ( PAL_LABEL_BG ));
 
-	if ( kInt >= MEDIUM_K )									// 'K' 4 or higher?
-		tft.setTextColor ( COLOR_MEDIUM, LABEL_BGCOLOR );	// Medium level
+		strcpy ( name, conList[next].name );
 
-	if ( kInt >= HIGH_K )									// 5 or higher?
-		tft.setTextColor ( COLOR_HIGH, LABEL_BGCOLOR );		// Highest level
+		for ( int16_t n = strlen ( name ); ( n > 0 ) && ( gfx->textWidth ( name, 2 ) > room ); )
+			name[--n] = 0;									// Cut it to fit
+	}
 
-	tft.drawString ( kindx, 284, 134, 4 );
+	else if ( conFetched )									// None coming up
+		strcpy ( when, "none" );
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );		// Set normal label colors
-}															// End of 'ShowSFI'
+	gfx->drawString ( when, SOLAR_X + 70, SOLAR_Y, 4 );			// Paint the time
+	gfx->drawString ( name, SOLAR_X + 150, SOLAR_Y + 3, 2 );		// and the name
+
+	gfx->setTextColor ( Ink ( PAL_LABEL_FG ), Ink ( PAL_LABEL_BG ));	// Normal label colors
+}														// End of 'ShowCON'
 
 
 /*
- *	'ShowGMF' displays the Geomagnetic Field conditions. For now, there are
- *	no color codes; I may change that.
+ *	'conRead' is everything needed while the calendar is coming in; like 'otaState'
+ *	it's made when a reading starts and deleted when it's done, so the TLS client
+ *	and the parser are only borrowed from the heap.
  */
 
-void ShowGMF ()
+struct conRead
 {
-	String headings = "GMF:  ";							// Header
+	WiFiClientSecure	client;
+	HTTPClient			https;
+	conParser			parser;
+	char				buf[CON_CHUNK];						// What was read
+	int32_t				left;								// Bytes still to come (-1 if not known)
+	uint32_t			bytes;								// and read so far
+	uint32_t			started;							// 'millis ()' at the start
+	uint32_t			lastData;							// and when we last got some
+	uint32_t			slices;								// Number of slices
+};
 
-	String gmf = GetXmlData ( xmlData, "geomagfield" );
+conRead*	conNow = nullptr;								// Reading in progress
 
-	ClearSolarData ();									// Erase previous data
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );	// Set label colors
-	tft.drawString ( headings, 80, 133, 4 );			// Paint GMF Header
+/*
+ *	'ConPoll' starts reading the calendar if 'ShowCON' wants it read, the network
+ *	is up, a firmware update isn't coming in and it's been 'CON_RETRY_MS' since
+ *	a reading that failed; and does the next slice of one that's going on.
+ */
 
-	tft.setTextColor ( COLOR_NORMAL, LABEL_BGCOLOR );	// Assume normal reading
+void ConPoll ()
+{
+	if ( conNow )
+		ConSlice ();
 
-	tft.drawString ( gmf, 150, 133, 4 );				// Paint the value
+	else if ( conWanted && !ota && ( WiFi.status () == WL_CONNECTED ))
+	{
+		conWanted = false;
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );	// Normal label colors
-}														// End of 'ShowGMF'
+		if ( !conFailed || (( millis () - conFailed ) >= CON_RETRY_MS ))
+			ConStart ();
+	}
+}
 
 
 /*
- *	'ShowS2N' displays the dignal to noise level apparantely in 'S' units. Again
- *	I have not added color coding here, but might.
+ *	'ConStart' connects to the calendar. We don't have a certificate for its
+ *	server; a wrong list of contests is the worst it can do. HTTP 1.0 means the
+ *	calendar comes without any chunk headers mixed in.
  */
 
-void ShowS2N ()											// Signal to noise level
+void ConStart ()
 {
-	String headings = "S2N:  ";							// Header for signal to noise
+	PoolMakeRoom ( nullptr );								// Idle connections go first
 
-	String s2n = GetXmlData ( xmlData, "signalnoise" );
+	conNow = new ( std::nothrow ) conRead;
 
-	ClearSolarData ();									// Erase previous data
+	if ( !conNow )
+	{
+		Serial.println ( F ( "Contests: not enough memory" ));
+		conFailed = millis () | 1;							// Not 0
+		return;
+	}
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );	// Set label colors
-	tft.drawString ( headings, 80, 133, 4 );			// Paint S2N Header
+	Serial.print ( F ( "Contests: reading the calendar at " ));
+	PrintTime ();
+	PHASE ( PH_FETCH );
 
-	tft.setTextColor ( COLOR_NORMAL	, LABEL_BGCOLOR );	// Assume normal reading
+	RadioWake ( WAKE_HOLD_MS );								// Full speed radio for this
+	CpuBoost ();											// and processor for the TLS handshake
 
-	tft.drawString ( s2n, 150, 133, 4 );				// Paint the value
+	conNow->client.setInsecure ();
+	conNow->https.useHTTP10 ( true );
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );	// Normal label colors
-}														// End of 'ShowS2N'
+	int16_t	code = conNow->https.begin ( conNow->client, TESTING ? TEST_CON_URL : CONTEST_URL )
+						? conNow->https.GET () : -1;
+
+	ConBegin ( conNow->parser, t );
+	conNow->left     = conNow->https.getSize ();
+	conNow->bytes    = 0;
+	conNow->started  = conNow->lastData = millis ();
+	conNow->slices   = 0;
+
+	CpuRelax ();
+	PHASE ( PH_LOOP );
+
+	if ( code != HTTP_CODE_OK )
+	{
+		Serial.printf_P ( PSTR ( "Contests: HTTP code %d\n" ), code );
+		ConDone ( false );
+	}
+}
 
 
 /*
- *	'ShowAUR' displays the Aurora level and the 'BZ'. Again I have not added
- *	color coding here, but might will once I have a better understanding of
- *	what the values mean.
+ *	'ConSlice' feeds what has arrived to the parser for up to 'CON_SLICE_MS',
+ *	when there's nothing more important to do (as 'OtaSlice' does).
  */
 
-void ShowAUR ()											// Aurora level
+void ConSlice ()
 {
-	String headings = "AUR:          BZ:";				// Header for Aurora & BZ
+	if ( !IdleSlice ()									// Seconds come first
+			|| ( SecondsToNtp () <= WAKE_AHEAD )		// then NTP
+			|| ( SecondsToFetch () <= WAKE_AHEAD )		// and the solar data
+			|| solarPending || fetchNow )
+		return;
 
-	String aur = GetXmlData ( xmlData, "aurora" );
-	String bz  = GetXmlData ( xmlData, "magneticfield" );
+	RadioWake ( WAKE_HOLD_MS );
+	CpuBoost ();
 
-	ClearSolarData ();									// Erase previous data
+	uint32_t	us = micros ();
+	WiFiClient*	in = conNow->https.getStreamPtr ();
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );	// Set label colors
-	tft.drawString ( headings, 80, 133, 4 );			// Paint AUR Header
+	conNow->slices++;
 
-	tft.setTextColor ( COLOR_NORMAL	, LABEL_BGCOLOR );	// Assume normal reading
+	while ( conNow->left && in->available () && (( micros () - us ) < CON_SLICE_MS * 1000UL ))
+	{
+		size_t	want = ( conNow->left > 0 ) ? min (( size_t ) conNow->left, sizeof ( conNow->buf ))
+											: sizeof ( conNow->buf );
+		int		n = in->read (( uint8_t* ) conNow->buf, want );
 
-	tft.drawString ( aur, 150, 133, 4 );				// Paint the AUR value
-	tft.drawString ( bz,  235, 133, 4 );				// and the BZ value
+		if ( n <= 0 )
+			break;
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );	// Normal label colors
-}														// End of 'ShowAUR'
+		ConFeed ( conNow->parser, conNow->buf, n );
+
+		conNow->bytes   += n;
+		conNow->lastData = millis ();
+
+		if ( conNow->left > 0 )
+			conNow->left -= n;
+	}
+
+	CpuRelax ();
+
+	if (( conNow->left == 0 ) || ( !in->connected () && !in->available ()))	// All in
+		ConDone ( true );
+
+	else if (( millis () - conNow->lastData ) > CON_TIMEOUT_MS )
+	{
+		Serial.println ( F ( "Contests: the calendar stopped coming" ));
+		ConDone ( false );
+	}
+}
 
 
 /*
- *	'ShowSSN' displays the current number of sunspots. Again I have not added color
- *	coding here.
+ *	'ConDone' takes the new list if the whole calendar came in and cleans up.
  */
 
-void ShowSSN ()											// Sunspot count
+void ConDone ( bool ok )
 {
-	String	headings = "SSN:  ";						// Header for sunspot count
+	conParser&	p = conNow->parser;
 
-	String ssn = GetXmlData ( xmlData, "sunspots" );
+	if ( ok && !ConEnd ( p ))
+	{
+		Serial.printf_P ( PSTR ( "Contests: calendar cut short after %u bytes\n" ), conNow->bytes );
+		ok = false;
+	}
 
-	ClearSolarData ();									// Erase previous data
+	if ( ok )
+	{
+		memcpy ( conList, p.list, sizeof ( conList ));
+		conCount   = p.count;
+		conFetched = t;
+		conFailed  = 0;
+
+		Serial.printf_P ( PSTR ( "Contests: %u bytes in %u ms (%u slices), %u contests, %u kept, longest line %u\n" ),
+						conNow->bytes, millis () - conNow->started, conNow->slices,
+						p.events, p.count, p.longest );
+	}
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );	// Set label colors
-	tft.drawString ( headings, 80, 133, 4 );			// Paint SSN Header
+	else
+		conFailed = millis () | 1;
 
-	tft.setTextColor ( COLOR_NORMAL	, LABEL_BGCOLOR );	// Assume normal reading
+	conNow->https.end ();
+	delete conNow;
+	conNow = nullptr;
+}
 
-	tft.drawString ( ssn, 150, 133, 4 );				// Paint the value
 
-	tft.setTextColor ( LABEL_FGCOLOR, LABEL_BGCOLOR );	// Normal label colors
-}														// End of 'ShowSSN'
+void CmdContest ( char* args )
+{
+	if ( !strcmp ( args, "fetch" ))
+	{
+		conFailed = 0;
+		conWanted = true;									// 'ConPoll' does it
+		Serial.println ( F ( "Reading the calendar" ));
+		return;
+	}
 
+	if ( !conFetched )
+	{
+		Serial.println ( F ( "No calendar yet" ));
+		return;
+	}
 
-/*
- *	Simple function to erase any previous solar data that was in the UTC
- *	header block. Assumes that the solar data always starts at x = 80.
- */
+	for ( uint8_t i = ConNext ( conList, conCount, t ); i < conCount; i++ )
+	{
+		calendar	c = {};
 
-void ClearSolarData ()
-{
-	tft.fillRoundRect (80, 126, 319, 32, 10, LABEL_BGCOLOR );	// Title bar for UTC
-	tft.drawRoundRect ( 0, 126, 319, 110, 10, TFT_WHITE );		// Draw edge around UTC
+		Breakdown ( conList[i].start, c );
+		Serial.printf_P ( PSTR ( "%02d/%02d %02d:%02dZ %5u min  %s\n" ), c.month, c.day, c.hour, c.minute,
+						( conList[i].end - conList[i].start ) / 60, conList[i].name );
+	}
 }
@@ -0,0 +1,145 @@
+#ifndef	_POWERMODEL_H_					// Prevent double include
+#define	_POWERMODEL_H_
+
+
+/*
+ *	Power estimates; added in Version 3.2.
+ *
+ *	The clock can't measure its own current, so the hourly report (see
+ *	'HourlyReport') estimates it from how long each part spends in each state and
+ *	rough figures for the current in that state. The figures are for the whole
+ *	board (less the backlight) with the radio awake or in modem sleep.
+ *
+ *	It's in here rather than in the main program so 'power_sim.sh' (in the
+ *	'Software' folder) can run a day of the clock's schedule on a computer with
+ *	exactly the same figures and rules as the report. Nothing in here touches the
+ *	radio or the backlight; 'RadioAwake' says whether the radio should be awake,
+ *	'BacklightPercent' how bright the backlight should be, and 'RadioMa' and
+ *	'BacklightMa' turn the time spent in each state into an average current.
+ */
+
+#include <stdint.h>
+
+#define WAKE_AHEAD			5					// Seconds before NTP or fetch to wake
+#define WAKE_HOLD_MS	10000					// Stay awake this long after activity
+
+#if defined ( ESP32 )
+	#define RADIO_MA_AWAKE	  115					// mA with the radio awake
+	#define RADIO_MA_SLEEP	   35					// and in modem sleep
+#elif defined ( ESP8266 )
+	#define RADIO_MA_AWAKE	   75
+	#define RADIO_MA_SLEEP	   18
+#endif
+
+#define BOARD_VOLTS		  3.3					// For converting mA to mW
+
+#define BL_STEP_MS		   20					// Time between brightness steps
+#define BL_TWILIGHT		  900					// Seconds either side of sunrise/set to fade
+#define BL_MA_FULL		   70					// Backlight current at full brightness
+
+
+/*
+ *	'RadioAwake' is the rule 'RadioPower' goes by: the radio stays awake in the
+ *	'WAKE_AHEAD' seconds before an NTP update ('toNtp') or solar data fetch
+ *	('toFetch'), while a fetch is due ('pending') or a roam is going on, while
+ *	'holdMs' from 'RadioWake' hasn't run out and while we're leading other clocks.
+ */
+
+bool RadioAwake ( int32_t toNtp, int32_t toFetch, bool pending, bool roaming,
+				  int32_t holdMs, bool leading )
+{
+	return ( toNtp <= WAKE_AHEAD ) || ( toFetch <= WAKE_AHEAD )
+		|| pending || roaming || ( holdMs > 0 ) || leading;
+}
+
+
+/*
+ *	'RadioMa' is the average current for 'awakeMs' with the radio awake and
+ *	'sleepMs' with it asleep.
+ */
+
+float RadioMa ( uint64_t awakeMs, uint64_t sleepMs )
+{
+	if ( awakeMs + sleepMs == 0 )
+		return 0;
+
+	return ( float ) ( awakeMs * RADIO_MA_AWAKE + sleepMs * RADIO_MA_SLEEP ) / ( awakeMs + sleepMs );
+}
+
+
+/*
+ *	'DaylightFade' returns how much daylight there is from 0 (night) to 100 (day)
+ *	'fromRise' seconds after sunrise and 'toSet' seconds before sunset (negative
+ *	outside them), fading linearly over 'BL_TWILIGHT' seconds either side of each.
+ */
+
+int16_t DaylightFade ( int32_t fromRise, int32_t toSet )
+{
+	int32_t	light;
+
+	fromRise += BL_TWILIGHT;
+	toSet    += BL_TWILIGHT;
+	light     = ( fromRise < toSet ) ? fromRise : toSet;
+
+	if ( light < 0 )
+		light = 0;
+
+	if ( light > 2 * BL_TWILIGHT )
+		light = 2 * BL_TWILIGHT;
+
+	return ( 100 * light ) / ( 2 * BL_TWILIGHT );
+}
+
+
+/*
+ *	'QuietHour' says whether hour 'hr' is in the quiet hours from 'start' up to
+ *	'end', which may span midnight.
+ */
+
+bool QuietHour ( int16_t hr, int16_t start, int16_t end )
+{
+	if ( start <= end )
+		return ( hr >= start ) && ( hr < end );
+
+	return ( hr >= start ) || ( hr < end );
+}
+
+
+/*
+ *	'BacklightPercent' is the brightness 'Backlight' aims for: 'day' percent in
+ *	daylight and 'night' percent at night, going by 'daylight' (0 to 100 from
+ *	'Daylight'), then scaled to 'ambient' percent for the room light and off in
+ *	the quiet hours. 'BacklightDuty' turns it into a PWM duty; the percentage is
+ *	squared so equal steps look equal to the eye.
+ */
+
+int16_t BacklightPercent ( int16_t day, int16_t night, int16_t daylight,
+						   int16_t ambient, bool quiet )
+{
+	if ( quiet )
+		return 0;
+
+	return (( night + (( day - night ) * daylight ) / 100 ) * ambient ) / 100;
+}
+
+uint8_t BacklightDuty ( int16_t percent )
+{
+	return ( percent * percent * 255L ) / 10000;
+}
+
+
+/*
+ *	'BacklightMa' is the average backlight current for a total duty of 'dutyMs'
+ *	(PWM counts times milliseconds) over 'totalMs', assuming the current is
+ *	proportional to the duty.
+ */
+
+float BacklightMa ( uint64_t dutyMs, uint64_t totalMs )
+{
+	if ( totalMs == 0 )
+		return 0;
+
+	return ( float ) BL_MA_FULL * dutyMs / ( totalMs * 255 );
+}
+
+#endif
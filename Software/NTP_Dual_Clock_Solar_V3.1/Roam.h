@@ -0,0 +1,176 @@
+#ifndef	_ROAM_H_						// Prevent double include
+#define	_ROAM_H_
+
+
+/*
+ *	WiFi roaming decisions; added in Version 3.2.
+ *
+ *	If there are several access points with the same SSID, the ESP will happily
+ *	stay connected to a weak one until the connection drops completely. The
+ *	signal strength is averaged, and when it drops below the threshold the
+ *	channels are swept one at a time looking for a stronger access point with the
+ *	same SSID. If after a complete sweep one at least the margin stronger than the
+ *	current one was found, we move to it. After a sweep (successful or not), we
+ *	wait 'ROAM_SWEEP_MS' before considering another one so that a marginal signal
+ *	doesn't keep us scanning all the time.
+ *
+ *	A move that hasn't connected within 'ROAM_GRACE_MS' is retried once without
+ *	asking for a particular access point, so the ESP can pick any of them; if that
+ *	doesn't connect either, we give up and leave it to 'ShowClockStatus'.
+ *
+ *	It's in here rather than in the main program so 'roam_sim.sh' (in the
+ *	'Software' folder) can build it on a computer and feed it made up signal
+ *	strengths and scan results. Nothing in here touches the radio; 'WiFiRoam'
+ *	reads the signal strength and scan results, passes them in along with its
+ *	'millis ()' and does whatever 'RoamNext' or 'RoamFailed' says.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define ROAM_SAMPLE_MS	 1000					// How often we read the RSSI
+#define ROAM_SWEEP_MS	60000					// Minimum time between channel sweeps
+#define ROAM_GRACE_MS	15000					// How long a roam may take
+#define ROAM_CHANNELS	   13					// Channels to sweep
+#define ROAM_DWELL_MS	  120					// Time spent listening on each channel
+
+#define ROAM_NONE			0					// Nothing to do
+#define ROAM_SCAN			1					// Scan 'channel'
+#define ROAM_MOVE			2					// Connect to 'bestBssid' on 'bestChannel'
+
+
+/*
+ *	'wifiRoam' is everything we know about the signal and the sweep. Start it off
+ *	all zeroes.
+ */
+
+struct wifiRoam
+{
+	int16_t		smoothRssi;				// Averaged signal strength (dBm * 16)
+	uint32_t	sampleTime;				// 'millis ()' when we last read the RSSI
+	uint32_t	sweepTime;				// and when the last sweep ended
+	uint32_t	start;					// and when a roam started (0 = none)
+	uint8_t		channel;				// Channel being swept (0 = none)
+	bool		scanning;				// Scan running on 'channel'
+	bool		fallback;				// Tried without a BSSID
+	uint8_t		bestBssid[6];			// Best access point found
+	int32_t		bestChannel;			// its channel
+	int16_t		bestRssi;				// and its signal strength
+};
+
+
+/*
+ *	'RoamSample' adds a signal strength reading to the running average. It's kept
+ *	multiplied by 16 so we can average with a weight of 1/16 without losing
+ *	precision. It should be called every 'ROAM_SAMPLE_MS' while connected.
+ */
+
+void RoamSample ( wifiRoam& r, int16_t rssi, uint32_t ms )
+{
+	r.sampleTime = ms;
+
+	if ( r.smoothRssi == 0 )							// First reading
+		r.smoothRssi = rssi * 16;
+
+	else
+		r.smoothRssi += rssi - ( r.smoothRssi / 16 );
+}
+
+
+/*
+ *	'RoamFound' is called with each access point with our SSID in the results of a
+ *	scan, along with the one we're connected to ('current'), and 'RoamScanned'
+ *	once they've all been seen.
+ */
+
+void RoamFound ( wifiRoam& r, const uint8_t* bssid, int32_t channel, int16_t rssi,
+				 const uint8_t* current )
+{
+	if ( memcmp ( bssid, current, 6 ) && ( rssi > r.bestRssi ))
+	{
+		r.bestRssi    = rssi;
+		r.bestChannel = channel;
+		memcpy ( r.bestBssid, bssid, 6 );
+	}
+}
+
+void RoamScanned ( wifiRoam& r )
+{
+	r.scanning = false;
+	r.channel++;										// On to the next channel
+}
+
+
+/*
+ *	'RoamNext' gets called while we're connected and no scan is running. It
+ *	returns 'ROAM_SCAN' when a scan of 'channel' should be started, which is only
+ *	done in an 'idle' slice, and 'ROAM_MOVE' at the end of a sweep that found an
+ *	access point at least 'margin' dB stronger than our average. A sweep starts
+ *	when the average drops below 'threshold'.
+ */
+
+uint8_t RoamNext ( wifiRoam& r, int16_t threshold, int16_t margin, bool idle, uint32_t ms )
+{
+	if ( r.channel == 0 )								// Not sweeping now
+	{
+		if (( r.smoothRssi / 16 ) >= threshold )		// Signal is fine
+			return ROAM_NONE;
+
+		if ( r.sweepTime && (( ms - r.sweepTime ) < ROAM_SWEEP_MS ))
+			return ROAM_NONE;							// Swept not long ago
+
+		r.channel  = 1;									// Start a new sweep
+		r.bestRssi = -127;
+	}
+
+	if ( r.channel > ROAM_CHANNELS )					// Sweep done?
+	{
+		r.channel   = 0;
+		r.sweepTime = ms;
+
+		if ( r.bestRssi < (( r.smoothRssi / 16 ) + margin ))
+			return ROAM_NONE;							// Nothing clearly better
+
+		r.start = ms;
+		return ROAM_MOVE;
+	}
+
+	if ( !idle )										// Only start a scan when
+		return ROAM_NONE;								// the display is idle
+
+	r.scanning = true;
+	return ROAM_SCAN;
+}
+
+
+/*
+ *	While a roam is in progress ('start' isn't 0), 'RoamDone' gets called once
+ *	we're connected with the new signal strength, and until then 'RoamFailed',
+ *	which returns 'true' when it's time to try again without a BSSID.
+ */
+
+void RoamDone ( wifiRoam& r, int16_t rssi, uint32_t ms )
+{
+	r.start      = 0;
+	r.fallback   = false;
+	r.smoothRssi = rssi * 16;							// Start averaging over
+	r.sweepTime  = ms;
+}
+
+bool RoamFailed ( wifiRoam& r, uint32_t ms )
+{
+	if (( ms - r.start ) <= ROAM_GRACE_MS )				// Give it time
+		return false;
+
+	if ( r.fallback )									// Already tried any AP; let
+	{													// 'ShowClockStatus' handle it
+		r.start = 0;
+		return false;
+	}
+
+	r.start    = ms;									// Let the ESP pick any AP
+	r.fallback = true;
+	return true;
+}
+
+#endif
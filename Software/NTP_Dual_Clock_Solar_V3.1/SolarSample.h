@@ -0,0 +1,60 @@
+#ifndef	_SOLAR_SAMPLE_H_				// Prevent double include
+#define	_SOLAR_SAMPLE_H_
+
+
+/*
+ *	This is a copy of a reply from 'https://www.hamqsl.com/solarxml.php'. It is
+ *	only used by the benchmark (see 'BENCHMARK' in the main program) so that the
+ *	XML parsing is always timed on the same data; the compiler leaves it out of
+ *	normal builds.
+ *
+ *	If the format of the real data changes, paste a new copy in here.
+ */
+
+
+const char solarSample[] PROGMEM = R"XML(<?xml version="1.0" encoding="ISO-8859-1"?>
+<solar>
+	<solardata>
+		<source url="http://www.hamqsl.com/solar.html">N0NBH</source>
+		<updated> 18 Oct 2026 1533 GMT</updated>
+		<solarflux>148</solarflux>
+		<aindex> 8</aindex>
+		<kindex> 2</kindex>
+		<kindexnt>No Report</kindexnt>
+		<xray>B7.6</xray>
+		<sunspots>112</sunspots>
+		<heliumline>139.2</heliumline>
+		<protonflux>19</protonflux>
+		<electonflux>1270</electonflux>
+		<aurora> 3</aurora>
+		<normalization>1.99</normalization>
+		<latdegree>67.5</latdegree>
+		<solarwind>412.3</solarwind>
+		<magneticfield> -2.1</magneticfield>
+		<calculatedconditions>
+			<band name="80m-40m" time="day">Fair</band>
+			<band name="30m-20m" time="day">Good</band>
+			<band name="17m-15m" time="day">Good</band>
+			<band name="12m-10m" time="day">Fair</band>
+			<band name="80m-40m" time="night">Good</band>
+			<band name="30m-20m" time="night">Good</band>
+			<band name="17m-15m" time="night">Fair</band>
+			<band name="12m-10m" time="night">Poor</band>
+		</calculatedconditions>
+		<calculatedvhfconditions>
+			<phenomenon name="vhf-aurora" location="northern_hemi">Band Closed</phenomenon>
+			<phenomenon name="E-Skip" location="europe">Band Closed</phenomenon>
+			<phenomenon name="E-Skip" location="north_america">Band Closed</phenomenon>
+			<phenomenon name="E-Skip" location="europe_6m">Band Closed</phenomenon>
+			<phenomenon name="E-Skip" location="europe_4m">Band Closed</phenomenon>
+		</calculatedvhfconditions>
+		<geomagfield>QUIET</geomagfield>
+		<signalnoise>S1-S2</signalnoise>
+		<fof2>7.81</fof2>
+		<muffactor>NoRpt</muffactor>
+		<muf>NoRpt</muf>
+	</solardata>
+</solar>
+)XML";
+
+#endif
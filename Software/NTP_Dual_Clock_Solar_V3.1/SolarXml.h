@@ -0,0 +1,309 @@
+#ifndef	_SOLARXML_H_					// Prevent double include
+#define	_SOLARXML_H_
+
+
+/*
+ *	Solar data XML parser; added in Version 3.2.
+ *
+ *	It's in here rather than in the main program so 'xml_fuzz.sh' (in the
+ *	'Software' folder) can build it on a computer and throw a few hundred thousand
+ *	mangled and random replies at it. Nothing in here fetches anything; the caller
+ *	passes in the reply and gets back the values in a 'solarSnapshot'.
+ *
+ *	Anything bigger than 'XML_MAX' bytes, with more than 'XML_MAX_TAGS' tags or a
+ *	value longer than 'XML_VALUE_MAX' is thrown away (see 'ParseSolarData'). The
+ *	real thing is about 3K with 90 tags. 'SOLAR_VALUE' is the longest value (plus
+ *	1) kept from it.
+ */
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SOLAR_VALUE		   12					// Size of each solar data value
+#define XML_MAX			 8192					// Most bytes we'll look at
+#define XML_MAX_TAGS	  256					// Most tags
+#define XML_VALUE_MAX	   32					// Longest value, including whitespace
+
+#ifndef	XML_COUNT
+#define	XML_COUNT(n)							// Work counter for 'xml_fuzz.sh'
+#endif
+
+
+/*
+ *	'solarSnapshot' holds the solar data values that get displayed. They're copied
+ *	out of the XML data after each fetch; anything that wasn't there is "??".
+ */
+
+struct solarSnapshot
+{
+	char	sfi[SOLAR_VALUE];			// Solar flux
+	char	aIndex[SOLAR_VALUE];		// 'A' index
+	char	kIndex[SOLAR_VALUE];		// 'K' index
+	char	gmf[SOLAR_VALUE];			// Geomagnetic field
+	char	s2n[SOLAR_VALUE];			// Signal to noise
+	char	aurora[SOLAR_VALUE];		// Aurora level
+	char	bz[SOLAR_VALUE];			// Magnetic field ('BZ')
+	char	ssn[SOLAR_VALUE];			// Sunspot number
+};
+
+
+/*
+ *	'CopyXmlValue' copies the value between an opening tag at 'i' (of length 'len')
+ *	and the closing tag at 'j' into 'val' less any whitespace around it, or "??"
+ *	if the tags are missing or in the wrong order. (Until Version 3.2 a tag right
+ *	at the start of the data wasn't found.)
+ */
+
+void CopyXmlValue ( const char* i, const char* j, size_t len, char* val )
+{
+	if ( i && ( j > i ))									// Sanity check
+	{
+		i += len;											// Start of the data
+
+		while (( i < j ) && isspace (( uint8_t ) *i ))		// Eliminate whitespace
+			i++;
+
+		while (( j > i ) && isspace (( uint8_t ) j[-1] ))
+			j--;
+
+		len = j - i;
+
+		if ( len > SOLAR_VALUE - 1 )							// Only what fits
+			len = SOLAR_VALUE - 1;
+
+		memcpy ( val, i, len );
+		val[len] = 0;
+	}
+
+	else
+		strcpy ( val, "??" );			// If we didn't find anything then use this
+}
+
+
+/*
+ *	'GetXmlData' is a poor man's xml tag extraction function added by Robert (AI6P)
+ *	rather than pulling in an entire XML library when it wasn't really that necessary.
+ *	It's pretty straightforward. Just use 'strstr' to find the tag locations and copy
+ *	the value between them into 'val' (which must hold 'SOLAR_VALUE' characters).
+ *
+ *	Note that this only works on the items in the XML data that are in the form:
+ *
+ *		<sunspots>51</sunspots>
+ *
+ *	There is data in the XML data that takes different forms.
+ */
+
+void GetXmlData ( const char* xml, const char* tag, char* val )
+{
+	char		open[24], close[24];						// The tags
+	const char*	i;											// Where the beginning tag is
+	const char*	j;											// and the ending tag
+
+	snprintf ( open,  sizeof ( open ),  "<%s>",  tag );
+	snprintf ( close, sizeof ( close ), "</%s>", tag );
+
+	i = strstr ( xml, open );
+	j = strstr ( xml, close );
+
+	CopyXmlValue ( i, j, strlen ( open ), val );
+}										// End of 'GetXmlData'
+
+
+/*
+ *	'ParseSolarDataRef' gets the values one at a time with 'GetXmlData', which means
+ *	going through the XML data twice for each of them. It's the way it used to be
+ *	done and is kept for the benchmark to check 'ParseSolarData' against.
+ */
+
+void ParseSolarDataRef ( const char* xml, solarSnapshot& s )
+{
+	GetXmlData ( xml, "solarflux",     s.sfi );
+	GetXmlData ( xml, "aindex",        s.aIndex );
+	GetXmlData ( xml, "kindex",        s.kIndex );
+	GetXmlData ( xml, "geomagfield",   s.gmf );
+	GetXmlData ( xml, "signalnoise",   s.s2n );
+	GetXmlData ( xml, "aurora",        s.aurora );
+	GetXmlData ( xml, "magneticfield", s.bz );
+	GetXmlData ( xml, "sunspots",      s.ssn );
+}
+
+
+/*
+ *	XML scanner; added in Version 3.2.
+ *
+ *	'ParseSolarData' finds all the values we show in one pass over the XML data.
+ *	Most of the time goes in looking for the next '<', so 'FindByte' does that 4
+ *	bytes at a time. XOR-ing a word with 4 copies of the character we want turns
+ *	any byte that matches into a zero, and
+ *
+ *		( w - 0x01010101 ) & ~w & 0x80808080
+ *
+ *	is non-zero only if one of the bytes in 'w' is zero. Only then do we look at
+ *	the bytes one at a time.
+ *
+ *	At each '<' the tag name is checked against 'solarFields'; the lengths are
+ *	worked out by the compiler and the first character weeds out most of the
+ *	mismatches before 'memcmp' gets called. The first opening and closing tag
+ *	found for each field are then handled just like 'GetXmlData' would.
+ *
+ *	Whatever arrives is checked before any of it is used. An HTML error page, a
+ *	reply that got cut off or anything else that isn't a complete <solardata>
+ *	block makes 'ParseSolarData' return 'false' without touching 's'. The limits
+ *	on the size, the number of tags and the value lengths mean the time it can take
+ *	is limited too, whatever the data looks like. 'XML_COUNT' is how 'xml_fuzz.sh'
+ *	checks that; it counts the words and tags looked at and does nothing here.
+ */
+
+#define XML_FIELD(tag,member) { tag, sizeof ( tag ) - 1, offsetof ( solarSnapshot, member ) }
+
+struct xmlField
+{
+	const char*		tag;						// Tag name
+	uint8_t			len;						// and its length
+	size_t			offset;						// Where the value goes in 'solarSnapshot'
+};
+
+const xmlField solarFields[] =
+{
+	XML_FIELD ( "solarflux",     sfi ),
+	XML_FIELD ( "aindex",        aIndex ),
+	XML_FIELD ( "kindex",        kIndex ),
+	XML_FIELD ( "geomagfield",   gmf ),
+	XML_FIELD ( "signalnoise",   s2n ),
+	XML_FIELD ( "aurora",        aurora ),
+	XML_FIELD ( "magneticfield", bz ),
+	XML_FIELD ( "sunspots",      ssn )
+};
+
+#define XML_FIELDS	( sizeof ( solarFields ) / sizeof ( solarFields[0] ))
+
+
+const char* FindByte ( const char* p, const char* end, char ch )
+{
+	const uint32_t	ones  = 0x01010101UL;
+	const uint32_t	highs = 0x80808080UL;
+	const uint32_t	match = ones * ( uint8_t ) ch;		// 4 copies of 'ch'
+	uint32_t		w;									// 4 bytes of the data
+
+	while (( p < end ) && (( uintptr_t ) p & 3 ))		// Up to a word boundary
+	{
+		if ( *p == ch )
+			return p;
+		p++;
+	}
+
+	while (( end - p ) >= 4 )							// Whole words
+	{
+		XML_COUNT ( 1 );
+		memcpy ( &w, p, 4 );							// Aligned so just a load
+		w ^= match;
+
+		if (( w - ones ) & ~w & highs )					// It's in this one
+			break;
+
+		p += 4;
+	}
+
+	while ( p < end )									// Find it or finish off
+	{
+		if ( *p == ch )
+			return p;
+		p++;
+	}
+
+	return end;
+}
+
+
+bool MatchTag ( const char* name, const char* end, const char* tag, uint8_t len )
+{
+	return ( end - name > len ) && ( *name == *tag )
+			&& ( name[len] == '>' ) && !memcmp ( name, tag, len );
+}
+
+
+bool ParseSolarData ( const char* xml, size_t size, solarSnapshot& s )
+{
+	const char*		end = xml + size;					// End of the data
+	const char*		open[XML_FIELDS]  = {};				// First opening tags
+	const char*		close[XML_FIELDS] = {};				// and closing tags
+	const char*		docOpen  = nullptr;					// <solardata>
+	const char*		docClose = nullptr;					// </solardata>
+	const char*		p = xml;							// Where we are
+	const char*		name;								// Tag name
+	bool			closing;							// It's a closing tag
+	uint16_t		tags = 0;							// How many we've seen
+
+	if ( size > XML_MAX )								// Too big to be real
+		return false;
+
+	while (( p = FindByte ( p, end, '<' )) < end )
+	{
+		if ( ++tags > XML_MAX_TAGS )					// Too many to be real
+			return false;
+
+		XML_COUNT ( XML_FIELDS );
+
+		name = p + 1;
+		closing = ( name < end ) && ( *name == '/' );
+
+		if ( closing )
+			name++;
+
+		if ( MatchTag ( name, end, "solardata", 9 ))
+		{
+			if ( closing && !docClose )
+				docClose = p;
+
+			else if ( !closing && !docOpen )
+				docOpen = p;
+		}
+
+		else for ( uint8_t f = 0; f < XML_FIELDS; f++ )
+		{
+			if ( MatchTag ( name, end, solarFields[f].tag, solarFields[f].len ))
+			{
+				if ( closing && !close[f] )
+					close[f] = p;
+
+				else if ( !closing && !open[f] )
+					open[f] = p;
+
+				break;
+			}
+		}
+
+		p++;
+	}
+
+
+/*
+ *	It has to be all there, which means the <solardata> block has to be complete
+ *	and every value we found has to have both tags, in the right order and not too
+ *	far apart. A value that's missing altogether is OK; it'll show as "??".
+ */
+
+	if ( !docOpen || !docClose || ( docClose < docOpen ))
+		return false;
+
+	for ( uint8_t f = 0; f < XML_FIELDS; f++ )
+	{
+		if ( !open[f] && !close[f] )
+			continue;
+
+		if ( !open[f] || !close[f] || ( close[f] < open[f] )
+				|| ( close[f] - open[f] > solarFields[f].len + 2 + XML_VALUE_MAX ))
+			return false;
+	}
+
+	for ( uint8_t f = 0; f < XML_FIELDS; f++ )
+		CopyXmlValue ( open[f], close[f], solarFields[f].len + 2,
+					   ( char* ) &s + solarFields[f].offset );
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef	_SUNPACK_H_						// Prevent double include
+#define	_SUNPACK_H_
+
+
+/*
+ *	Packing the picture of the sun; added in Version 3.2.
+ *
+ *	The rows of the picture are packed the way "PackBits" does it, but with 16 bit
+ *	pixels: a count byte under 128 is followed by that many plus 1 pixels as they
+ *	are, and one of 128 or more by one pixel repeated 126 fewer times than that.
+ *	The dark sky around the sun packs to almost nothing, and the worst a row can
+ *	do is 1 byte more for every 128 pixels than not packing it at all, which is
+ *	what 'SUN_PACKED' allows for.
+ *
+ *	It's in here rather than in the main program so 'sun_bench.sh' (in the
+ *	'Software' folder) packs the rows with exactly the same code as the clock.
+ *	Nothing in here reads or writes a file; 'SunPackRow' packs a row of 'w' pixels
+ *	into 'out' and returns how many bytes that took.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define SUN_PACKED(w)	(( w ) * 2 + (( w ) + 127 ) / 128 )		// Most bytes for a row
+
+
+size_t SunPackRow ( const uint16_t* px, uint16_t w, uint8_t* out )
+{
+	uint16_t	i = 0;										// Next pixel to pack
+	uint16_t	n;											// How many go together
+	size_t		len = 0;									// Bytes packed
+
+	while ( i < w )
+	{
+		n = 1;
+
+		while (( i + n < w ) && ( n < 128 ) && ( px[i + n] == px[i] ))
+			n++;
+
+		if ( n > 1 )										// A run of the same one
+		{
+			out[len++] = n + 126;
+			memcpy ( out + len, px + i, 2 );
+			len += 2;
+		}
+
+		else												// Different ones, up to
+		{													// the next pair the same
+			while (( i + n < w ) && ( n < 128 )
+					&& !(( i + n + 1 < w ) && ( px[i + n] == px[i + n + 1] )))
+				n++;
+
+			out[len++] = n - 1;
+			memcpy ( out + len, px + i, n * 2 );
+			len += n * 2;
+		}
+
+		i += n;
+	}
+
+	return len;
+}
+
+#endif
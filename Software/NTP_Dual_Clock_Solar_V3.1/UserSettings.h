@@ -73,7 +73,7 @@ wifiData ssid_pwd [] =
  *	seconds.
  */
 
-char timeZones[][50] = {							// List of timezones to be displayed
+const char timeZones[][50] PROGMEM = {				// List of timezones to be displayed
 	"EST5EDT,M3.2.0/2:00:00,M11.1.0/2:00:00",
 	"AEST-10AEDT,M10.1.0/2:00:00,M4.1.0/2:00:00" };
 
@@ -112,6 +112,16 @@ uint8_t tzCount = ELEMENTS ( timeZones );			// How many in the list
 #define PRINTED_TIME		1			// 0 = NONE, 1 = UTC, or 2 = LOCAL
 
 
+/*
+ *	Version 3.2 can show the local time on an analog clock face instead of the
+ *	7-segment digits. The face is drawn from two 16 bit sprites which need about
+ *	21K of memory; that's no problem on the ESP32 but may be too much on an ESP8266.
+ *	If there isn't enough memory, the clock quietly goes back to the digits.
+ */
+
+#define ANALOG_FACE			false		// Show local time on an analog clock face
+
+
 /*
  *	The normal colors of the foregrounds and backgrounds of the stuff
  *	displayed on the screen:
@@ -137,6 +147,23 @@ uint8_t tzCount = ELEMENTS ( timeZones );			// How many in the list
 #define	COLOR_HIGH		TFT_RED				// Maximum
 
 
+/*
+ *	Version 3.2 added a night mode. Between dusk and dawn (computed from 'LATITUDE'
+ *	and 'LONGITUDE' below) the colors above are replaced by these, which are easier
+ *	on the eyes in a dark room. Set 'LATITUDE' and 'LONGITUDE' to where you are
+ *	before setting 'NIGHT_MODE' to 'true', or the colors will change at somebody
+ *	else's dusk and dawn.
+ */
+
+#define	NIGHT_MODE			false			// Switch colors at dusk and dawn
+
+#define	NIGHT_TIMECOLOR		TFT_RED			// Color of 7-segment time display
+#define	NIGHT_DATECOLOR		TFT_MAROON		// Color of displayed month & day
+#define	NIGHT_LABEL_FG		TFT_RED			// Color of label text
+#define	NIGHT_LABEL_BG		TFT_BLACK		// Color of label background
+#define	NIGHT_EDGE			TFT_MAROON		// Color of the edges around the blocks
+
+
 /*
  *	These define the breakpoints for the things that are color coded. Those
  *	for the 'A' and 'K' values correspond to the NOAA breakpoints. The SFI
@@ -177,6 +204,8 @@ uint8_t tzCount = ELEMENTS ( timeZones );			// How many in the list
 #define	SHOW_S2N	3						// Display signal to noise
 #define	SHOW_AUR	4						// Display Aurora level
 #define	SHOW_SSN	5						// Display sunspot count
+#define	SHOW_SUN	0						// Picture of the sun (from NASA's SDO)
+#define	SHOW_CON	0						// Time to the next contest ('CONTEST_URL')
 
 #define	DATA_ITEMS	5						// How many we are displaying
 
@@ -190,4 +219,168 @@ uint8_t tzCount = ELEMENTS ( timeZones );			// How many in the list
 
 #define	CYCLE_TIME	2						// Seconds to show each solar data item
 
+
+/*
+ *	Version 3.2 adds the ability for several clocks on the same LAN to agree on
+ *	when the seconds change, so a wall full of them all flip together. The clocks
+ *	find each other automatically; the one with the lowest chip ID becomes the
+ *	leader and the others follow it.
+ *
+ *	It's only any use with two or more clocks (a clock on its own would just keep
+ *	announcing itself every couple of seconds), so set 'LAN_SYNC' to 'true' on
+ *	each of them to turn it on. All the clocks must use the same 'LAN_SYNC_PORT',
+ *	and your router must not block UDP broadcasts between them.
+ */
+
+#define	LAN_SYNC		false				// Synchronize with other clocks on the LAN
+#define	LAN_SYNC_PORT	4123				// UDP port the clocks talk on
+
+
+/*
+ *	If there are several access points with the same SSID (common in larger
+ *	houses, clubs and offices), the clock can move to a stronger one without
+ *	dropping off the network. When the signal strength (averaged over a while)
+ *	falls below 'ROAM_RSSI', the clock quietly scans the channels one at a time
+ *	and switches to an access point that is at least 'ROAM_MARGIN' dB stronger.
+ *	Set 'WIFI_ROAMING' to 'true' to turn it on.
+ */
+
+#define	WIFI_ROAMING	false				// Look for stronger access points
+#define	ROAM_RSSI		-70					// Start looking below this (dBm)
+#define	ROAM_MARGIN		  8					// New one must be this much better (dB)
+
+
+/*
+ *	The WiFi radio uses more power than anything else except the display
+ *	backlight. With 'RADIO_SLEEP' set to 'true', the radio naps between beacons
+ *	from the access point when there's nothing going on, and is woken up a few
+ *	seconds before NTP updates and solar data fetches.
+ *
+ *	'LISTEN_INTERVAL' is how many beacons (about 102 mS each) the radio may sleep
+ *	through. Anything sent to the clock (e.g., by other clocks on the LAN) may be
+ *	delayed by up to that long. Values from 1 to 10 are allowed.
+ */
+
+#define	RADIO_SLEEP		false				// Let the radio sleep when idle
+#define	LISTEN_INTERVAL	   3				// Beacons between wakeups
+
+
+/*
+ *	The processor spends almost all its time waiting for the next second. With
+ *	'CPU_SCALING' set to 'true', it runs at 80 MHz while idle and speeds up only
+ *	while it's repainting the display or fetching and decoding the solar data.
+ */
+
+#define	CPU_SCALING		false				// Slow the processor down when idle
+
+
+/*
+ *	On displays with a controllable backlight (the Cheap Yellow Display for one;
+ *	the setup file has to define 'TFT_BL'), the brightness can follow the sun. It
+ *	is 'BL_DAY' percent between sunrise and sunset, 'BL_NIGHT' percent at night,
+ *	and the backlight can be turned off completely between 'QUIET_START' and
+ *	'QUIET_END' (hours in the first timezone in the list). They're the same here,
+ *	which never turns it off; 1 and 6 would turn it off from 1 AM to 6 AM.
+ *	'BL_NIGHT' is the same as 'BL_DAY' here too, which never dims it; 25 would
+ *	dim it to a quarter at night.
+ *
+ *	'LATITUDE' and 'LONGITUDE' are used to compute sunrise and sunset; north and
+ *	east are positive, south and west negative. Set them to where you are before
+ *	lowering 'BL_NIGHT' (or turning on 'NIGHT_MODE'), or the clock will dim at
+ *	somebody else's sunset.
+ *
+ *	If your display has a light sensor (the Cheap Yellow Display has one on GPIO 34),
+ *	set 'LIGHT_SENSOR' to its pin number; leave it at -1 if not, as an unconnected
+ *	pin reads whatever it picks up. 'LIGHT_DARK' and
+ *	'LIGHT_BRIGHT' are the readings in a dark and a brightly lit room; the
+ *	brightness is reduced to as little as 'BL_AMBIENT_MIN' percent of the above
+ *	levels when it's dark.
+ */
+
+#define	LATITUDE		 40.0				// Your location (degrees)
+#define	LONGITUDE		-75.0
+
+#define	BL_DAY			100					// Daytime brightness (percent)
+#define	BL_NIGHT		100					// Nighttime brightness (percent)
+
+#define	QUIET_START		  0					// Backlight off at this hour
+#define	QUIET_END		  0					// and back on at this one
+
+#define	LIGHT_SENSOR	 -1					// Light sensor pin (-1 if none)
+#define	LIGHT_DARK		600					// Reading in a dark room
+#define	LIGHT_BRIGHT	  0					// Reading in a bright room
+#define	BL_AMBIENT_MIN	 30					// Dimmest in the dark (percent)
+
+
+/*
+ *	Version 3.2 can also take some of the settings above from a file called
+ *	'clock.cfg' in the flash file system, so they can be changed without rebuilding
+ *	the program (on an ESP8266, pick a flash size with some "FS" space in the
+ *	'Tools' menu). Anything not in the file keeps the value set in here. It looks
+ *	like this:
+ *
+ *		# Lines starting with '#' are ignored
+ *		ssid = SSID_1					WiFi networks, in the order they're tried;
+ *		password = PWD_1				each 'ssid' needs its 'password' after it
+ *		zone = EST5EDT,M3.2.0/2:00:00,M11.1.0/2:00:00
+ *		zone = AEST-10AEDT,M10.1.0/2:00:00,M4.1.0/2:00:00
+ *		tz_interval = 5					'TZ_INTERVAL'
+ *		items = sfi, gmf, s2n, aur, ssn	Solar data shown, in order ('SHOW_xxx');
+ *										'sun' is the picture of the sun and
+ *										'con' the next contest
+ *		cycle_time = 2					'CYCLE_TIME'
+ *		medium_k = 4					Also 'high_k', 'medium_a', 'high_a',
+ *										'medium_sfi' and 'high_sfi'
+ *		ota_url = http://192.168.1.10:8080	'OTA_URL' (below)
+ *
+ *	If the file has any 'ssid' (or 'zone') lines, they replace the whole list
+ *	above. A password of "*" means keep the one the clock already has.
+ *
+ *	With 'CONFIG_HTTP' set to 'true', going to "http://<clock address>/config" in
+ *	a browser shows the settings (without the passwords), and a new file can be
+ *	sent there with:
+ *
+ *		curl -H 'Content-Type: text/plain' --data-binary @clock.cfg http://<clock address>/config
+ *
+ *	(without the 'Content-Type' it doesn't arrive as a file). Settings can also be
+ *	typed on the serial monitor as "set name = value", followed by "apply"
+ *	(type "help" there for the other commands). Either way they take effect
+ *	straight away and are saved in the file. Anybody on your network can change
+ *	them through the web page, including the WiFi list, which could take the clock
+ *	off your network, so it's off unless you turn it on.
+ */
+
+#define	CONFIG_HTTP		false				// Settings can be changed from a browser
+
+
+/*
+ *	The clock can update itself from a web server on your network (run
+ *	'ota_server.py' from the 'Software' folder on any computer). Set 'OTA_URL' to
+ *	where it is, for example "http://192.168.1.10:8080", and the clock will look
+ *	there once an hour; leave it "" to never look. It can also be set with
+ *	'ota_url' in 'clock.cfg' or typed on the serial monitor, but not sent from a
+ *	browser; whoever can set it decides what the clock runs.
+ */
+
+#define	OTA_URL			""					// Where to look for new firmware
+
+
+/*
+ *	'CONTEST_URL' is the contest calendar the 'SHOW_CON' item counts down to the
+ *	next contest from. It can be any iCalendar ('.ics') feed with the times in
+ *	UTC; WA7BNM's has all the ham radio contests.
+ */
+
+#define	CONTEST_URL		"https://www.contestcalendar.com/calendar.ics"
+
+
+/*
+ *	If the clock ever gets stuck (in the middle of a solar data fetch, say) for
+ *	'STALL_RESET' seconds, it can note where it was stuck and restart itself; type
+ *	"stalls" on the serial monitor or "log" afterwards to see where. 0 leaves it
+ *	stuck, so you can see it happen.
+ */
+
+#define	STALL_RESET		0					// Seconds stuck before restarting (0 = never)
+
 #endif
@@ -0,0 +1,403 @@
+#!/usr/bin/env python3
+#
+#	chaos.py - Stands in for the NTP server and the solar data server so the
+#	clock's network code can be tried with bad connections; added in Version 3.2.
+#
+#	Set 'TEST_HOST' in the clock program to the address of the computer running
+#	this and load it. The clock then gets its time from here (UDP port 123, so run
+#	this as root or give python the right to use low ports) and its solar data
+#	from 'https://TEST_HOST:8443/solarxml.php'. The reply is the sample in
+#	'SolarSample.h'. With '--sun' it also serves that JPEG file as the picture of
+#	the sun ('https://TEST_HOST:8443/sun.jpg') and with '--contests' that calendar
+#	('https://TEST_HOST:8443/contests.ics'), with the same faults; type "sun" or
+#	"contest fetch" on the clock's serial monitor to fetch them.
+#
+#	Each scenario runs for a while and then the next one starts:
+#
+#		clean		Everything works
+#		latency		Every NTP and HTTPS reply is held back a few seconds
+#		loss		Some NTP packets and HTTPS connections are just dropped
+#		truncate	The XML stops part way through
+#		status		The server answers "503 Service Unavailable"
+#		html		An HTML error page instead of the XML
+#		drip		The XML trickles out a few bytes at a time
+#		badcert		The TLS handshake is cut off (the test clock doesn't check
+#					the certificate, so this is how a bad one looks to it)
+#
+#	The server speaks HTTP 1.1 and keeps a connection open for 15 seconds between
+#	requests, as most web servers do, so the clock's connection pool (type "pool"
+#	on the clock) gets used; in the scenarios with a fault it hangs up after each
+#	reply. The report counts the TLS connections, so "HTTPS" requests over fewer
+#	"Connects" means connections were kept.
+#
+#	Dropping the WiFi can't be done from here; set 'TEST_FLAP_SECONDS' in the
+#	clock for that. Use 'SOAK_SECONDS' so the clock fetches often enough to see
+#	each scenario a few times.
+#
+#	With '--serial' (needs the 'pyserial' package) it also reads the "Test:"
+#	lines the clock prints and ends with a report for each scenario: how many
+#	fetches worked, how many seconds were shown late and how long the clock took
+#	to get good data again after the trouble stopped. The clock counts from when
+#	it started, so reset it just after starting this.
+#
+#	Usage:	./chaos.py										All scenarios, 10 minutes each
+#			./chaos.py --minutes 3 loss drip				Just these
+#			./chaos.py --serial /dev/ttyUSB0				And report what the clock saw
+#			./chaos.py --sun latest_256_0193.jpg drip		Picture of the sun, slowly
+#
+
+import argparse
+import http.server
+import os
+import random
+import re
+import socket
+import socketserver
+import ssl
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SAMPLE = os.path.join(HERE, "NTP_Dual_Clock_Solar_V3.1", "SolarSample.h")
+
+NTP_EPOCH = 2208988800							# 1900 to 1970 in seconds
+
+SCENARIOS = {
+	"clean":	{},
+	"latency":	{"latency": 4.0},
+	"loss":		{"loss": 0.4},
+	"truncate":	{"truncate": 0.5},
+	"status":	{"status": 503},
+	"html":		{"html": True},
+	"drip":		{"drip": 32},					# Bytes a second
+	"badcert":	{"badcert": True},
+	"recover":	{},								# Always run last
+}
+
+HTML_PAGE = b"<html><head><title>Error</title></head><body>Try again later</body></html>\n"
+
+
+class Chaos:
+	"""What's being done to the replies right now and what has happened so far."""
+
+	def __init__(self):
+		self.lock = threading.Lock()
+		self.name = "clean"
+		self.fault = {}
+		self.counts = {}
+
+	def start(self, name):
+		with self.lock:
+			self.name = name
+			self.fault = SCENARIOS[name]
+			self.counts.setdefault(name, {"ntp": 0, "ntp_dropped": 0, "https": 0, "https_faulted": 0,
+									"connects": 0})
+		log("scenario", name)
+
+	def get(self, key, default=None):
+		with self.lock:
+			return self.fault.get(key, default)
+
+	def count(self, key):
+		with self.lock:
+			self.counts[self.name][key] += 1
+
+	def dropped(self):
+		return random.random() < self.get("loss", 0.0)
+
+
+chaos = Chaos()
+
+
+def log(*words):
+	print(time.strftime("%H:%M:%S"), *words, flush=True)
+
+
+def load_sample():
+	"""Pull the XML out of the raw string in 'SolarSample.h'."""
+
+	with open(SAMPLE, encoding="latin-1") as f:
+		text = f.read()
+
+	match = re.search(r'R"XML\((.*?)\)XML"', text, re.S)
+
+	if not match:
+		sys.exit("Can't find the sample XML in " + SAMPLE)
+
+	return match.group(1).encode("latin-1")
+
+
+def make_cert(folder):
+	"""A throw-away self-signed certificate for the HTTPS server."""
+
+	cert = os.path.join(folder, "cert.pem")
+	key = os.path.join(folder, "key.pem")
+
+	subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "30",
+					"-subj", "/CN=chaos", "-keyout", key, "-out", cert],
+					check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+	return cert, key
+
+
+#	NTP: answer each request with our own clock, late or not at all if the
+#	scenario says so. The replies go out from their own threads so a held back
+#	one doesn't hold up the rest.
+
+def ntp_reply(sock, request, address, received):
+	delay = chaos.get("latency", 0.0)
+
+	if delay:
+		time.sleep(delay)
+
+	def stamp(t):
+		t += NTP_EPOCH
+		return struct.pack("!II", int(t), int((t % 1) * 2**32))
+
+	reply = struct.pack("!BBbbII4s", 0x24, 2, 6, -20, 0, 0, b"CHAO")	# Server, stratum 2
+	reply += stamp(received)											# Reference
+	reply += request[40:48]												# Originate = their transmit
+	reply += stamp(received)											# Receive
+	reply += stamp(time.time())											# Transmit
+
+	sock.sendto(reply, address)
+
+
+def ntp_server(port):
+	sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+	sock.bind(("", port))
+
+	while True:
+		request, address = sock.recvfrom(512)
+		received = time.time()
+
+		if len(request) < 48:
+			continue
+
+		chaos.count("ntp")
+
+		if chaos.dropped():
+			chaos.count("ntp_dropped")
+			continue
+
+		threading.Thread(target=ntp_reply, args=(sock, request, address, received), daemon=True).start()
+
+
+#	HTTPS: the solar data with whatever is wrong with it this time.
+
+class SolarHandler(http.server.BaseHTTPRequestHandler):
+	protocol_version = "HTTP/1.1"					# Keep connections open
+	timeout = 15									# but not for long when idle
+	sample = b""
+	files = {}										# Path: (contents, type)
+
+	def do_GET(self):
+		chaos.count("https")
+
+		if chaos.dropped():								# Hang up without a word
+			chaos.count("https_faulted")
+			self.close_connection = True
+			return
+
+		delay = chaos.get("latency", 0.0)
+
+		if delay:
+			time.sleep(delay)
+
+		body = self.sample
+		status = chaos.get("status", 200)
+		kind = "text/xml"
+
+		if self.path in self.files:
+			body, kind = self.files[self.path]
+
+		elif self.path != "/solarxml.php":
+			self.send_error(404)
+			return
+
+		if chaos.get("html"):
+			body, kind = HTML_PAGE, "text/html"
+
+		if status != 200:								# A short page saying why
+			body, kind = ("%u %s\n" % (status, self.responses[status][0])).encode(), "text/plain"
+
+		faulted = status != 200 or chaos.get("html") or chaos.get("truncate") or chaos.get("drip")
+
+		if faulted:
+			chaos.count("https_faulted")
+			self.close_connection = True				# Start afresh after trouble
+
+		self.send_response(status)
+		self.send_header("Content-Type", kind)
+		self.send_header("Content-Length", str(len(body)))
+
+		if faulted:
+			self.send_header("Connection", "close")
+
+		self.end_headers()
+
+		cut = chaos.get("truncate")
+
+		if cut:											# Promise it all, send some
+			body = body[:int(len(body) * cut)]
+
+		drip = chaos.get("drip")
+
+		try:
+			if drip:
+				for i in range(0, len(body), drip):
+					self.wfile.write(body[i:i + drip])
+					self.wfile.flush()
+					time.sleep(1)
+			else:
+				self.wfile.write(body)
+
+		except OSError:									# The clock gave up on us
+			self.close_connection = True
+
+	def log_message(self, format, *args):
+		log("https", self.address_string(), format % args)
+
+
+class SolarServer(socketserver.ThreadingMixIn, http.server.HTTPServer):
+	daemon_threads = True
+
+	def __init__(self, port, context):
+		super().__init__(("", port), SolarHandler)
+		self.context = context
+
+	def get_request(self):
+		sock, address = self.socket.accept()
+
+		if chaos.get("badcert"):						# Cut the handshake off
+			chaos.count("https")
+			chaos.count("https_faulted")
+			sock.close()
+			raise OSError("handshake refused")
+
+		chaos.count("connects")
+		sock.settimeout(30)								# Handshake in the handler thread
+
+		return self.context.wrap_socket(sock, server_side=True, do_handshake_on_connect=False), address
+
+	def handle_error(self, request, address):
+		log("https", address[0], "error", sys.exc_info()[1])
+
+
+#	Serial: keep the last "Test:" line the clock printed during each scenario.
+
+TEST_LINE = re.compile(r"Test: fetch (\w+), code (-?\d+), (\d+) ms, failed (\d+) of (\d+), "
+						r"late seconds (\d+), longest (\d+) ms, longest recovery (\d+) ms")
+
+
+def serial_reader(port, baud, seen):
+	import serial									# Only needed for this
+
+	latest = (0, 0, 0, 0, 0)						# The clock's counts start at zero
+
+	with serial.Serial(port, baud, timeout=1) as line:
+		while True:
+			text = line.readline().decode("latin-1", "replace").strip()
+
+			if not text:
+				continue
+
+			if text.startswith("Test:"):
+				log("clock", text[6:])
+
+			match = TEST_LINE.match(text)
+
+			if match:
+				ok, code, ms, failed, fetches, late, longest, recovery = match.groups()
+				row = seen.setdefault(chaos.name, {"first": latest, "last": None, "ms": 0})
+				now = (int(failed), int(fetches), int(late), int(longest), int(recovery))
+				row["last"] = latest = now
+				row["ms"] = max(row["ms"], int(ms))
+
+
+def report(order, seen):
+	print()
+	print("%-10s %6s %8s %8s %8s %8s %8s %12s %14s" % ("Scenario", "NTP", "Dropped", "HTTPS", "Connects",
+			"Faulted", "Fetches", "Failed", "Late seconds"))
+
+	previous = None
+
+	for name in order:
+		c = chaos.counts.get(name, {})
+		row = seen.get(name)
+		fetches = failed = late = "-"
+
+		if row:											# Counted from the last line
+			start = row["first"]						# before it started
+			failed = row["last"][0] - start[0]
+			fetches = row["last"][1] - start[1]
+			late = row["last"][2] - start[2]
+			previous = row["last"]
+
+		print("%-10s %6s %8s %8s %8s %8s %8s %12s %14s" % (name, c.get("ntp", 0), c.get("ntp_dropped", 0),
+				c.get("https", 0), c.get("connects", 0), c.get("https_faulted", 0), fetches, failed, late))
+
+	if previous:
+		print()
+		print("Longest second %u ms, longest recovery %u s" % (previous[3], previous[4] // 1000))
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Bad network stand-in for the clock")
+	parser.add_argument("scenarios", nargs="*", default=list(SCENARIOS)[:-1], help="scenarios to run, in order")
+	parser.add_argument("--minutes", type=float, default=10, help="how long each one runs")
+	parser.add_argument("--ntp-port", type=int, default=123)
+	parser.add_argument("--https-port", type=int, default=8443)
+	parser.add_argument("--serial", help="the clock's serial port, to read its \"Test:\" lines")
+	parser.add_argument("--baud", type=int, default=115200)
+	parser.add_argument("--seed", type=int, help="for the same drops each time")
+	parser.add_argument("--sun", help="a JPEG file to serve as the picture of the sun")
+	parser.add_argument("--contests", help="an iCalendar file to serve as the contest calendar")
+	args = parser.parse_args()
+
+	for name in args.scenarios:
+		if name not in SCENARIOS or name == "recover":
+			sys.exit("No scenario called '%s'; there's %s" % (name, ", ".join(SCENARIOS)))
+
+	random.seed(args.seed)
+	SolarHandler.sample = load_sample()
+
+	for path, kind, name in (("/sun.jpg", "image/jpeg", args.sun), ("/contests.ics", "text/calendar", args.contests)):
+		if name:
+			with open(name, "rb") as f:
+				SolarHandler.files[path] = (f.read(), kind)
+
+	folder = tempfile.mkdtemp(prefix="chaos")
+	context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+	context.load_cert_chain(*make_cert(folder))
+
+	threading.Thread(target=ntp_server, args=(args.ntp_port,), daemon=True).start()
+	threading.Thread(target=SolarServer(args.https_port, context).serve_forever, daemon=True).start()
+
+	seen = {}
+
+	if args.serial:
+		threading.Thread(target=serial_reader, args=(args.serial, args.baud, seen), daemon=True).start()
+
+	log("listening", "ntp", args.ntp_port, "https", args.https_port)
+
+	try:
+		for name in args.scenarios:
+			chaos.start(name)
+			time.sleep(args.minutes * 60)
+
+		chaos.start("recover")							# See how long it takes
+		time.sleep(args.minutes * 60)
+
+	except KeyboardInterrupt:
+		pass
+
+	report(args.scenarios + ["recover"], seen)
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,256 @@
+#!/bin/bash
+#
+#	contest_bench.sh - Feeds a whole contest calendar through the clock's parser
+#	('Contests.h') on this computer, times it and checks what it kept; added in
+#	Version 3.2.
+#
+#	Without a calendar it makes up a big one (a couple of years of contests in no
+#	particular order, with folded lines, escapes, all-day events and alarms) and
+#	checks the list against the one it should get. With a real calendar (a file,
+#	or a URL to fetch it from) it checks that the list is in order and in the
+#	window, that it comes out the same however the calendar is split up as it
+#	arrives, and that 'ConNext' always agrees with looking through the list.
+#
+#	The parser allocates nothing, so the memory it needs is the size of its
+#	'conParser', which is printed; the clock borrows that (and the TLS client)
+#	from the heap while it's reading the calendar.
+#
+#	It needs a C++ compiler, python3 and 'curl' for a URL.
+#
+#	Usage:	./contest_bench.sh								A made up calendar
+#			./contest_bench.sh calendar.ics					A real one
+#			./contest_bench.sh https://www.contestcalendar.com/calendar.ics
+#
+
+HERE=$(dirname "$0")
+CALENDAR=$1
+BUILD=${TMPDIR:-/tmp}/contest_bench
+NOW=$(date +%s)
+
+mkdir -p "$BUILD"
+
+case "$CALENDAR" in
+	http*)	curl -sfL -o "$BUILD/calendar.ics" "$CALENDAR" || { echo "Can't get $CALENDAR"; exit 1; }
+			CALENDAR="$BUILD/calendar.ics" ;;
+
+	"")		CALENDAR="$BUILD/made_up.ics"
+			EXPECTED="$BUILD/expected.txt"
+
+			python3 - "$NOW" "$CALENDAR" "$EXPECTED" <<'EOF' || exit 1
+import random, sys, time
+
+now, calendar, expected = int(sys.argv[1]), sys.argv[2], sys.argv[3]
+random.seed(1)
+events = []
+
+for i in range(6000):
+	start = now + random.randint(-365, 365) * 86400 + random.randint(0, 95) * 900
+	length = random.choice([0, 3600, 4 * 3600, 24 * 3600, 48 * 3600])
+	day_only = random.random() < 0.1
+
+	if day_only:
+		start -= start % 86400
+		length = 86400
+
+	name = "Contest %u, part %s; %s" % (i, random.choice("ABC"), "x" * random.randint(0, 60))
+	events.append((start, length, day_only, name))
+
+def stamp(t, day_only):
+	return time.strftime("%Y%m%d" if day_only else "%Y%m%dT%H%M%SZ", time.gmtime(t))
+
+def fold(line):
+	out = line[:75]
+	line = line[75:]
+	while line:
+		out += "\r\n " + line[:74]
+		line = line[74:]
+	return out + "\r\n"
+
+with open(calendar, "w", newline="") as f:
+	f.write("BEGIN:VCALENDAR\r\nVERSION:2.0\r\nPRODID:-//contest_bench//EN\r\n")
+
+	for start, length, day_only, name in events:
+		value = ";VALUE=DATE:" if day_only else ":"
+		f.write("BEGIN:VEVENT\r\n")
+		f.write(fold("UID:%u-%s@contest_bench" % (start, "y" * 80)))
+		f.write("DTSTART%s%s\r\n" % (value, stamp(start, day_only)))
+		if length:
+			f.write("DTEND%s%s\r\n" % (value, stamp(start + length, day_only)))
+		f.write(fold("SUMMARY:" + name.replace(",", "\\,").replace(";", "\\;")))
+		f.write(fold("DESCRIPTION:" + "Rules at https://example.com/" + "z" * random.randint(0, 300)))
+		f.write("BEGIN:VALARM\r\nTRIGGER:-PT15M\r\nACTION:DISPLAY\r\nEND:VALARM\r\n")
+		f.write("END:VEVENT\r\n")
+
+	f.write("END:VCALENDAR\r\n")
+
+kept = [(s, i, n) for i, (s, l, d, n) in enumerate(events)
+		if s + max(l, 1) > now and s < now + 14 * 86400]
+
+with open(expected, "w") as f:
+	for s, i, n in sorted(kept)[:32]:
+		f.write("%u %s\n" % (s, n[:23]))
+EOF
+			;;
+esac
+
+cat > "$BUILD/bench.cpp" <<'EOF'
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Contests.h"
+
+static double Seconds ()
+{
+	struct timespec	ts;
+
+	clock_gettime ( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool Same ( const conParser& a, const conParser& b )
+{
+	return ( a.count == b.count ) && !memcmp ( a.list, b.list, a.count * sizeof ( contest ));
+}
+
+int main ( int argc, char** argv )
+{
+	static conParser	whole, bits;
+	FILE*				f = fopen ( argv[1], "rb" );
+	uint32_t			now = strtoul ( argv[2], nullptr, 10 );
+	int					runs = 20, failed = 0;
+
+	if ( !f )
+	{
+		perror ( argv[1] );
+		return 1;
+	}
+
+	fseek ( f, 0, SEEK_END );
+	size_t	size = ftell ( f );
+	char*	data = ( char* ) malloc ( size );
+	rewind ( f );
+
+	if ( fread ( data, 1, size, f ) != size )
+		return 1;
+
+	double	start = Seconds ();
+
+	for ( int run = 0; run < runs; run++ )
+	{
+		ConBegin ( whole, now );
+		ConFeed ( whole, data, size );
+
+		if ( !ConEnd ( whole ))
+		{
+			printf ( "FAILED: no END:VCALENDAR\n" );
+			return 1;
+		}
+	}
+
+	double	parse = ( Seconds () - start ) / runs;
+
+
+/*
+ *	The same again in pieces of 1 to 512 bytes, the way it comes off the network.
+ */
+
+	srand ( 1 );
+	ConBegin ( bits, now );
+
+	for ( size_t i = 0, n; i < size; i += n )
+	{
+		n = 1 + rand () % 512;
+		ConFeed ( bits, data + i, ( i + n > size ) ? size - i : n );
+	}
+
+	ConEnd ( bits );
+
+	if ( !Same ( whole, bits ))
+	{
+		printf ( "FAILED: a different list when it comes in pieces\n" );
+		failed++;
+	}
+
+	for ( uint8_t i = 0; i < whole.count; i++ )
+	{
+		const contest&	c = whole.list[i];
+
+		if (( i && ( c.start < whole.list[i - 1].start ))
+				|| ( c.end <= now ) || ( c.start >= now + CON_DAYS * 86400UL ))
+		{
+			printf ( "FAILED: '%s' out of order or out of the window\n", c.name );
+			failed++;
+		}
+	}
+
+	for ( uint32_t t = now; t < now + CON_DAYS * 86400UL; t += 60 )	// Every minute
+	{
+		uint8_t	next = ConNext ( whole.list, whole.count, t );
+		uint8_t	slow = 0;
+
+		while (( slow < whole.count ) && ( whole.list[slow].start <= t ))
+			slow++;
+
+		if ( next != slow )
+		{
+			printf ( "FAILED: 'ConNext' gave %u, not %u\n", next, slow );
+			failed++;
+			break;
+		}
+	}
+
+	volatile uint32_t	sum = 0;								// So they're not left out
+	uint32_t			lookups = 0;
+
+	start = Seconds ();
+
+	for ( uint32_t t = now; t < now + CON_DAYS * 86400UL; t += 60, lookups++ )
+		sum += ConNext ( whole.list, whole.count, t );
+
+	double	lookup = ( Seconds () - start ) / lookups;
+
+	if ( argc > 3 )										// What it should have kept
+	{
+		FILE*		e = fopen ( argv[3], "r" );
+		char		name[CON_NAME + 2];
+		unsigned	at;
+		uint8_t		n = 0;
+
+		while ( fscanf ( e, "%u %[^\n]\n", &at, name ) == 2 )
+		{
+			if (( n >= whole.count ) || ( whole.list[n].start != at ) || strcmp ( whole.list[n].name, name ))
+			{
+				printf ( "FAILED: number %u should be %u '%s'\n", n + 1, at, name );
+				failed++;
+				break;
+			}
+
+			n++;
+		}
+
+		if ( n != whole.count )
+		{
+			printf ( "FAILED: kept %u, should be %u\n", whole.count, n );
+			failed++;
+		}
+	}
+
+	printf ( "Calendar:   %zu bytes, %u contests, longest line %u\n", size, whole.events, whole.longest );
+	printf ( "Kept:       %u (up to %u, %u days ahead)\n", whole.count, CON_MAX, CON_DAYS );
+	printf ( "Parse:      %.1f ms (%.1f M bytes a second)\n", parse * 1e3, size / parse / 1e6 );
+	printf ( "Lookup:     %.1f ns\n", lookup * 1e9 );
+	printf ( "Memory:     %zu bytes ('conParser'), nothing allocated\n", sizeof ( conParser ));
+
+	uint8_t	next = ConNext ( whole.list, whole.count, now );
+
+	for ( uint8_t i = next; ( i < whole.count ) && ( i < next + 3 ); i++ )
+		printf ( "Next:       in %u min, %s\n", ( whole.list[i].start - now ) / 60, whole.list[i].name );
+
+	printf ( failed ? "FAILED\n" : "Passed\n" );
+	return failed ? 1 : 0;
+}
+EOF
+
+g++ -O2 -Wall -o "$BUILD/bench" -I "$HERE/NTP_Dual_Clock_Solar_V3.1" "$BUILD/bench.cpp" || exit 1
+
+"$BUILD/bench" "$CALENDAR" "$NOW" $EXPECTED
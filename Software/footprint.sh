@@ -0,0 +1,94 @@
+#!/bin/bash
+#
+#	footprint.sh - Builds the clock for each of the boards and reports how much
+#	static RAM, IRAM and flash memory it uses; added in Version 3.2.
+#
+#	It needs 'arduino-cli' with the ESP32 and ESP8266 board packages and the
+#	'TFT_eSPI' and 'ezTime' libraries installed. Each board is built with its own
+#	setup file from 'User_Setup FIles', so there is no need to change the library's
+#	'User_Setup_Select.h' between builds.
+#
+#	The RAM figure is everything that's in RAM before the sketch starts running
+#	(initialized data, constants that aren't in flash and zeroed variables); what's
+#	left over is the heap. If any board's RAM goes over its budget in the list
+#	below, the script says so and exits with a status of 1.
+#
+#	Usage:	./footprint.sh					Build all the boards
+#			./footprint.sh d1mini cyd		Build just these
+#
+
+cd "$(dirname "$0")" || exit 1
+
+SKETCH=NTP_Dual_Clock_Solar_V3.1
+SETUPS="../User_Setup FIles"
+WORK=${TMPDIR:-/tmp}/clock_footprint
+
+
+#	Board name, FQBN, TFT_eSPI setup file and RAM budget (bytes):
+
+PROFILES=(
+	"esp32pcb	esp32:esp32:esp32			ESP32_NTP_Clock_Setup.h			65536"
+	"cyd		esp32:esp32:esp32			ESP32_Cheap_Yellow_Display.h	65536"
+	"d1mini		esp8266:esp8266:d1_mini		ESP8266_Generic_Setup.h			40960"
+	"nodemcu	esp8266:esp8266:nodemcuv2	ESP8266_Generic_Setup.h			40960"
+)
+
+
+#	'sizes' adds up the sections of an ELF file into RAM, IRAM and flash totals.
+#	The section names are different for the two processors.
+
+sizes ()
+{
+	"$1" -A "$2" | awk '
+		/^\.dram0\.(data|bss)|^\.noinit/		{ ram   += $2 }		# ESP32
+		/^\.iram0\./							{ iram  += $2 }
+		/^\.flash\./							{ flash += $2 }
+		/^\.(data|rodata|bss) /					{ ram   += $2 }		# ESP8266
+		/^\.text /								{ iram  += $2 }
+		/^\.irom0\.text/						{ flash += $2 }
+		END										{ print ram + 0, iram + 0, flash + 0 }'
+}
+
+
+status=0
+
+printf "%-10s %10s %10s %10s %10s\n" "Board" "RAM" "Budget" "IRAM" "Flash"
+
+for profile in "${PROFILES[@]}"
+do
+	read -r name fqbn setup budget <<< "$profile"
+
+	if [ $# -gt 0 ] && [[ ! " $* " =~ " $name " ]]
+	then
+		continue
+	fi
+
+	build="$WORK/$name"
+	mkdir -p "$build"
+	cp "$SETUPS/$setup" "$build/Setup.h"		# No spaces in the path for the compiler
+
+	if ! arduino-cli compile --fqbn "$fqbn" --build-path "$build" \
+			--build-property "compiler.cpp.extra_flags=-DUSER_SETUP_LOADED=1 -include $build/Setup.h" \
+			"$SKETCH" > "$build/build.log" 2>&1
+	then
+		echo "$name: build failed, see $build/build.log"
+		status=1
+		continue
+	fi
+
+	tool=$(find ~/.arduino15/packages/"${fqbn%%:*}"/tools -name 'xtensa-*-size' -type f | head -n 1)
+
+	read -r ram iram flash <<< "$(sizes "$tool" "$build/$SKETCH.ino.elf")"
+
+	printf "%-10s %10u %10u %10u %10u" "$name" "$ram" "$budget" "$iram" "$flash"
+
+	if [ "$ram" -gt "$budget" ]
+	then
+		printf "   OVER BUDGET by %u" $(( ram - budget ))
+		status=1
+	fi
+
+	printf "\n"
+done
+
+exit $status
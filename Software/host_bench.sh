@@ -0,0 +1,253 @@
+#!/bin/bash
+#
+#	host_bench.sh - Times the parts of the clock program that build on a computer
+#	and prints the results as JSON, the same way 'BENCHMARK' does on the clock;
+#	added in Version 3.2.
+#
+#	The results have the same names and format as the clock's, and the same
+#	'BENCH_VERSION' (taken from the clock program), so the two can be put side by
+#	side, but the times are a computer's. Each is the best of 'TRIES' goes so that
+#	runs with different versions of the program can be compared with a script:
+#
+#		xml.parse, xml.parse.ref	'ParseSolarData' and 'ParseSolarDataRef' on
+#									the sample reply ('SolarSample.h')
+#		xml.parse.indexof			The parser before Version 3.2 on the same
+#		xml.tag						'GetXmlData' for one value of the sample
+#		xml.worst, xml.worst.ref	The parsers on 4K of "<sunspot" over and over
+#		xml.worst.indexof
+#		xml.scan					'ParseSolarData' on 4K with no tags at all
+#		xml.max, xml.max.ref		The parsers on a reply padded out to near
+#		xml.max.indexof				'XML_MAX' with tags we don't want
+#
+#	The ".indexof" ones are the way it was done before Version 3.2: the whole reply
+#	copied for each value (the old 'GetXmlData' took a 'String') and both tags
+#	looked for from the start a byte at a time, which is how 'String::indexOf'
+#	ends up searching on the clocks. 'ParseSolarDataRef' uses the computer's
+#	'strstr' instead, which is a lot cleverer than the one on the clocks, so on a
+#	computer it keeps up with the scanner; the ".indexof" ones are closer to what
+#	the scanner replaced.
+#		calendar.breakdown			'Breakdown' ('Calendar.h') through a year
+#		calendar.gmtime				The computer's 'gmtime' doing the same
+#
+#	Before the calendar is timed, 'Breakdown' is checked against 'gmtime' every
+#	hour and a bit from 1970 to 2106.
+#
+#	The local time conversion and the drawing use the ezTime and TFT_eSPI
+#	libraries, which don't build on a computer, so only the clock's 'BENCHMARK'
+#	times those.
+#
+#	It needs a C++ compiler.
+#
+#	Usage:	./host_bench.sh > results.json
+#
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+BUILD=${TMPDIR:-/tmp}/host_bench
+
+mkdir -p "$BUILD"
+
+cat > "$BUILD/bench.cpp" <<'EOF'
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define PROGMEM
+
+#include "Calendar.h"
+#include "SolarXml.h"
+#include "SolarSample.h"
+
+#define TRIES			5								/* Best of */
+
+static uint32_t				count;						/* Results printed so far */
+static volatile uint32_t	sink;						/* Stops the compiler skipping the work */
+
+static double Now ()
+{
+	timespec	t;
+
+	clock_gettime ( CLOCK_MONOTONIC, &t );
+	return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+static void Result ( const char* name, uint32_t runs, double us )
+{
+	printf ( "%s\n    { \"name\": \"%s\", \"runs\": %u, \"us\": %.3f, \"pixels\": -1, \"budget\": 0 }",
+			 count++ ? "," : "", name, runs, us / runs );
+}
+
+
+/*
+ *	'IndexOf' finds 'find' in 's' a byte at a time, and 'ParseSolarDataIndexOf'
+ *	gets the values with it the way the clock did before Version 3.2.
+ */
+
+static int IndexOf ( const char* s, const char* find )
+{
+	for ( const char* p = s; *p; p++ )
+	{
+		size_t	k = 0;
+
+		while ( find[k] && ( p[k] == find[k] ))
+			k++;
+
+		if ( !find[k] )
+			return p - s;
+	}
+
+	return -1;
+}
+
+static void ParseSolarDataIndexOf ( const char* xml, solarSnapshot& s )
+{
+	size_t	size = strlen ( xml ) + 1;
+	char	open[24], close[24];
+
+	for ( uint8_t f = 0; f < XML_FIELDS; f++ )
+	{
+		char*	copy = ( char* ) malloc ( size );				/* The 'String' copy */
+		int		i, j;
+
+		memcpy ( copy, xml, size );
+		snprintf ( open,  sizeof ( open ),  "<%s>",  solarFields[f].tag );
+		snprintf ( close, sizeof ( close ), "</%s>", solarFields[f].tag );
+
+		i = IndexOf ( copy, open );
+		j = IndexOf ( copy, close );
+
+		CopyXmlValue ( i < 0 ? nullptr : copy + i, j < 0 ? nullptr : copy + j,
+					   strlen ( open ), ( char* ) &s + solarFields[f].offset );
+		free ( copy );
+	}
+}
+
+
+/*
+ *	'TIME' runs 'what' 'runs' times, 'TRIES' times over, and prints the best.
+ */
+
+#define TIME(name,runs,what)								\
+	{														\
+		double	best = 1e30;								\
+															\
+		for ( int t = 0; t < TRIES; t++ )					\
+		{													\
+			double	us = Now ();							\
+															\
+			for ( uint32_t r = 0; r < ( runs ); r++ )		\
+				{ what; }									\
+															\
+			us = Now () - us;								\
+			best = us < best ? us : best;					\
+		}													\
+															\
+		Result ( name, runs, best );						\
+	}
+
+int main ()
+{
+	const size_t	sampleLen = sizeof ( solarSample ) - 1;
+	const char		note[] = "<note>Band conditions are calculated from the solar flux"
+							 " and K index every three hours.</note>\n";
+	static char		worst[4096 + 1], scan[4096 + 1], max[XML_MAX + 1];
+	const time_t	start = 1792108800;					/* 10/16/26 00:00:00 UTC */
+	solarSnapshot	snap, check;
+	char			value[SOLAR_VALUE];
+	calendar		c = {};
+	tm				g;
+	size_t			at;
+
+
+/*
+ *	'Breakdown' has to get the same as 'gmtime' before there's any point timing it.
+ */
+
+	for ( time_t t = 0; t < 0xFFFFFFFFLL; t += 3571 )
+	{
+		Breakdown ( t, c );
+		gmtime_r ( &t, &g );
+
+		if (( c.year != g.tm_year + 1900 ) || ( c.month != g.tm_mon + 1 ) || ( c.day != g.tm_mday )
+				|| ( c.weekday != g.tm_wday + 1 ) || ( c.hour != g.tm_hour )
+				|| ( c.minute != g.tm_min ) || ( c.second != g.tm_sec ))
+		{
+			fprintf ( stderr, "'Breakdown' is wrong for %lld\n", ( long long ) t );
+			return 1;
+		}
+	}
+
+	memset ( &snap,  0, sizeof ( snap ));				/* The old way gets the same */
+	memset ( &check, 0, sizeof ( check ));
+	ParseSolarDataRef ( solarSample, snap );
+	ParseSolarDataIndexOf ( solarSample, check );
+
+	if ( memcmp ( &snap, &check, sizeof ( snap )))
+	{
+		fprintf ( stderr, "'ParseSolarDataIndexOf' doesn't get the same as 'ParseSolarDataRef'\n" );
+		return 1;
+	}
+
+	printf ( "{ \"benchmark\": %u, \"board\": \"host\", \"mhz\": 0, \"sprite\": false, \"screen\": \"0x0\",\n"
+			 "  \"results\": [", BENCH_VERSION );
+
+	TIME ( "xml.parse",     20000, sink += ParseSolarData ( solarSample, sampleLen, snap ));
+	TIME ( "xml.parse.ref", 20000, ParseSolarDataRef ( solarSample, snap ); sink += snap.ssn[0] );
+	TIME ( "xml.parse.indexof", 20000, ParseSolarDataIndexOf ( solarSample, snap ); sink += snap.ssn[0] );
+	TIME ( "xml.tag",      100000, GetXmlData ( solarSample, "sunspots", value ); sink += value[0] );
+
+	for ( size_t i = 0; i < 4096; i++ )					/* Tags that almost match */
+	{
+		worst[i] = "<sunspot"[i % 8];
+		scan[i]  = "sunspots"[i % 8];					/* and no tags at all */
+	}
+
+	TIME ( "xml.worst",     20000, sink += ParseSolarData ( worst, 4096, snap ));
+	TIME ( "xml.scan",      20000, sink += ParseSolarData ( scan, 4096, snap ));
+	TIME ( "xml.worst.ref", 20000, ParseSolarDataRef ( worst, snap ); sink += snap.ssn[0] );
+	TIME ( "xml.worst.indexof", 2000, ParseSolarDataIndexOf ( worst, snap ); sink += snap.ssn[0] );
+
+
+/*
+ *	The sample with notes we don't look at put in after <solardata> until it's
+ *	nearly as big as we'll take (and well under 'XML_MAX_TAGS').
+ */
+
+	at = strstr ( solarSample, "<solardata>" ) + 11 - solarSample;
+	memcpy ( max, solarSample, at );
+
+	while ( at + 2 * sizeof ( note ) + sampleLen < XML_MAX )
+	{
+		memcpy ( max + at, note, sizeof ( note ) - 1 );
+		at += sizeof ( note ) - 1;
+	}
+
+	strcpy ( max + at, strstr ( solarSample, "<solardata>" ) + 11 );
+
+	if ( !ParseSolarData ( max, strlen ( max ), snap ))
+	{
+		fprintf ( stderr, "The padded reply (%zu bytes) should have been accepted\n", strlen ( max ));
+		return 1;
+	}
+
+	TIME ( "xml.max",       20000, sink += ParseSolarData ( max, strlen ( max ), snap ));
+	TIME ( "xml.max.ref",   20000, ParseSolarDataRef ( max, snap ); sink += snap.ssn[0] );
+	TIME ( "xml.max.indexof", 2000, ParseSolarDataIndexOf ( max, snap ); sink += snap.ssn[0] );
+
+	TIME ( "calendar.breakdown", 100000,
+		   Breakdown ( start + r * 317UL, c ); sink += c.hour + c.minute + c.second + c.day + c.month );
+
+	TIME ( "calendar.gmtime", 100000,
+		   time_t t = start + r * 317UL; gmtime_r ( &t, &g );
+		   sink += g.tm_hour + g.tm_min + g.tm_sec + g.tm_mday + g.tm_mon );
+
+	printf ( "\n  ]\n}\n" );
+	return 0;
+}
+EOF
+
+VERSION=$(sed -n 's/^#define BENCH_VERSION[[:space:]]*\([0-9]*\).*/\1/p' "$HERE/NTP_Dual_Clock_Solar_V3.1/NTP_Dual_Clock_Solar_V3.1.ino")
+
+g++ -O2 -Wall -DBENCH_VERSION="$VERSION" -o "$BUILD/bench" -I "$HERE/NTP_Dual_Clock_Solar_V3.1" "$BUILD/bench.cpp" || exit 1
+
+"$BUILD/bench"
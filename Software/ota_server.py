@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+#
+#	ota_server.py - Serves new firmware to the clocks on your network; added in
+#	Version 3.2.
+#
+#	Build the clock in the Arduino IDE with "Sketch / Export Compiled Binary" (or
+#	'arduino-cli compile --output-dir') and point this at the '.bin' file(s). Each
+#	one is gzipped and described in "esp32.txt" or "esp8266.txt" (see 'OtaPoll' in
+#	the clock program), and everything is served over plain HTTP. Then set
+#	'OTA_URL' (or 'ota_url' in 'clock.cfg') to "http://<this computer>:8080" and
+#	the clocks pick it up within the hour, or straight away if you type "update"
+#	on a clock's serial monitor.
+#
+#	'--rate' holds the download speed down, to see how the clock copes with a
+#	slow network. Each download's time is printed; the clock prints how long it
+#	took at its end and how many seconds were shown late while it was going on.
+#
+#	Usage:	./ota_server.py --esp32 NTP_Dual_Clock_Solar_V3.1.ino.bin
+#			./ota_server.py --esp8266 d1mini.bin --port 8000 --rate 20
+#
+
+import argparse
+import gzip
+import hashlib
+import http.server
+import os
+import sys
+import time
+
+files = {}										# Name: contents
+
+
+def add_firmware(chip, path):
+	"""Gzip one '.bin' file and describe it in '<chip>.txt'."""
+
+	with open(path, "rb") as f:
+		image = f.read()
+
+	packed = gzip.compress(image, 9, mtime=0)
+	name = chip + ".bin.gz"
+
+	files[name] = packed
+	files[chip + ".txt"] = ("md5 = %s\nsha256 = %s\nfile = %s\n" % (
+		hashlib.md5(image).hexdigest(), hashlib.sha256(packed).hexdigest(), name)).encode()
+
+	print("%s: %s, %u bytes, %u gzipped" % (chip, os.path.basename(path), len(image), len(packed)))
+
+
+class FirmwareHandler(http.server.BaseHTTPRequestHandler):
+	rate = 0									# Bytes a second, 0 for no limit
+
+	def do_GET(self):
+		body = files.get(self.path.lstrip("/"))
+
+		if body is None:
+			self.send_error(404)
+			return
+
+		self.send_response(200)
+		self.send_header("Content-Type", "application/octet-stream")
+		self.send_header("Content-Length", str(len(body)))
+		self.end_headers()
+
+		start = time.time()
+		step = max(self.rate // 10, 256) if self.rate else len(body)
+
+		try:
+			for i in range(0, len(body), step):
+				self.wfile.write(body[i:i + step])
+
+				if self.rate:
+					time.sleep(step / self.rate)
+
+		except OSError:
+			self.log_message("%s: gave up after %u bytes", self.path, i)
+			return
+
+		if len(body) > 4096:
+			self.log_message("%s: %u bytes in %.1f s", self.path, len(body), time.time() - start)
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Serve clock firmware updates")
+	parser.add_argument("--esp32", help="the ESP32 '.bin' file")
+	parser.add_argument("--esp8266", help="the ESP8266 '.bin' file")
+	parser.add_argument("--port", type=int, default=8080)
+	parser.add_argument("--rate", type=float, default=0, help="download speed limit in K bytes a second")
+	args = parser.parse_args()
+
+	if not args.esp32 and not args.esp8266:
+		sys.exit("Give it an '--esp32' or '--esp8266' file (or both)")
+
+	for chip in ("esp32", "esp8266"):
+		if getattr(args, chip):
+			add_firmware(chip, getattr(args, chip))
+
+	FirmwareHandler.rate = int(args.rate * 1024)
+
+	server = http.server.ThreadingHTTPServer(("", args.port), FirmwareHandler)
+	print("Serving on port %u" % args.port)
+
+	try:
+		server.serve_forever()
+	except KeyboardInterrupt:
+		pass
+
+
+if __name__ == "__main__":
+	main()
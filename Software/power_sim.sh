@@ -0,0 +1,154 @@
+#!/bin/bash
+#
+#	power_sim.sh - Runs a day of the clock's radio and backlight schedule through
+#	the power estimates in 'PowerModel.h' on this computer and prints what the
+#	hourly report would show for each processor; added in Version 3.2.
+#
+#	Time is simulated 'BL_STEP_MS' at a step. The NTP updates and solar data fetches
+#	come at the clock program's own intervals (taken from it, like the refresh
+#	intervals below); each fetch takes the given time and is followed by a
+#	'RadioWake ( WAKE_HOLD_MS )' like 'GetSolarData'. The optional extras add the
+#	other things that wake the radio:
+#
+#		ota		Looking for new firmware once an hour ('OtaGet')
+#		sun		Getting the picture of the sun every 'SUN_REFRESH' ('SunFetch')
+#		con		Getting the contest calendar every 'CON_REFRESH' ('ConStart')
+#		lead	Leading other clocks on the LAN (the radio never sleeps)
+#
+#	The backlight follows 'BL_DAY', 'BL_NIGHT', 'QUIET_START' and 'QUIET_END' from
+#	'UserSettings.h' unless they're given, with the sun rising at 'SUNRISE' and
+#	setting at 'SUNSET' (hours; 6 and 18 if not given) and the room light scaling
+#	it to 'AMBIENT' percent (100 if not given). It steps towards its target like
+#	'Backlight' does.
+#
+#	The estimates are only as good as the 'RADIO_MA_xxx' and 'BL_MA_FULL' figures;
+#	this shows what the report would say for a given schedule, not what a meter
+#	would.
+#
+#	It needs a C++ compiler.
+#
+#	Usage:	./power_sim.sh								Just NTP and the solar data
+#			./power_sim.sh ota sun con					With the extras
+#			FETCH_MS=5000 ./power_sim.sh				Slower fetches (default 2000 ms)
+#			BL_NIGHT=25 QUIET_START=1 QUIET_END=6 ./power_sim.sh
+#
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+SKETCH=$HERE/NTP_Dual_Clock_Solar_V3.1
+BUILD=${TMPDIR:-/tmp}/power_sim
+FETCH_MS=${FETCH_MS:-2000}
+
+Define ()										# A '#define' from the clock program
+{
+	sed -n "s/^#define[ \t]*$1[ \t]*\([0-9]*\).*/\1/p" "$SKETCH/${2:-NTP_Dual_Clock_Solar_V3.1.ino}" | head -1
+}
+
+BL_DAY=${BL_DAY:-$(Define BL_DAY UserSettings.h)}
+BL_NIGHT=${BL_NIGHT:-$(Define BL_NIGHT UserSettings.h)}
+QUIET_START=${QUIET_START:-$(Define QUIET_START UserSettings.h)}
+QUIET_END=${QUIET_END:-$(Define QUIET_END UserSettings.h)}
+SUNRISE=${SUNRISE:-6}
+SUNSET=${SUNSET:-18}
+AMBIENT=${AMBIENT:-100}
+
+DEFS="-DNTP_INTERVAL=$(Define NTP_INTERVAL) -DSUN_REFRESH=$(Define SUN_REFRESH) -DCON_REFRESH=$(Define CON_REFRESH)"
+DEFS="$DEFS -DBL_DAY=$BL_DAY -DBL_NIGHT=$BL_NIGHT -DQUIET_START=$QUIET_START -DQUIET_END=$QUIET_END"
+DEFS="$DEFS -DSUNRISE=$SUNRISE -DSUNSET=$SUNSET -DAMBIENT=$AMBIENT"
+
+mkdir -p "$BUILD"
+
+cat > "$BUILD/sim.cpp" <<'EOF'
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "PowerModel.h"
+
+#define DAY_MS		86400000u						/* Simulated time */
+#define STEP_MS		BL_STEP_MS						/* and the step */
+
+int main ( int argc, char* argv[] )
+{
+	uint32_t	fetchMs = atoi ( argv[1] );
+	bool		ota = false, sun = false, con = false, lead = false;
+	uint32_t	holdUntil = 0, fetchEnd = 0;
+	bool		pending = false;					/* Fetch going on */
+	uint64_t	radioMs[2] = { 0, 0 };				/* Awake, asleep */
+	uint8_t		blTarget = 0, blLevel = 0;
+	uint64_t	blDutyMs = 0;
+	float		radioMa, blMa;
+
+	for ( int i = 2; i < argc; i++ )
+	{
+		ota  |= !strcmp ( argv[i], "ota" );
+		sun  |= !strcmp ( argv[i], "sun" );
+		con  |= !strcmp ( argv[i], "con" );
+		lead |= !strcmp ( argv[i], "lead" );
+	}
+
+	for ( uint32_t ms = 0; ms < DAY_MS; ms += STEP_MS )
+	{
+		uint32_t	s = ms / 1000;
+		bool		second = ( ms % 1000 ) == 0;
+		bool		awake;
+
+		if ( second && ( s % 1800 == 0 ))			/* Solar data fetch */
+		{
+			fetchEnd = ms + fetchMs;
+			pending  = true;
+		}
+
+		if ( pending && ( ms >= fetchEnd ))			/* 'GetSolarData' done */
+		{
+			holdUntil = ms + WAKE_HOLD_MS;
+			pending   = false;
+		}
+
+		if ( second && (( ota && ( s % 3600 == 15 * 60 ))
+					 || ( sun && ( s % SUN_REFRESH == 60 ))
+					 || ( con && ( s % CON_REFRESH == 120 ))))
+			holdUntil = ms + WAKE_HOLD_MS;
+
+		awake = RadioAwake ( NTP_INTERVAL - s % NTP_INTERVAL, 1800 - s % 1800,
+							 pending, false, ( int32_t ) ( holdUntil - ms ), lead );
+
+		radioMs[!awake] += STEP_MS;
+
+		if ( second )								/* Once a second, like 'Backlight' */
+			blTarget = BacklightDuty ( BacklightPercent ( BL_DAY, BL_NIGHT,
+							DaylightFade ( s - SUNRISE * 3600, SUNSET * 3600 - s ), AMBIENT,
+							QuietHour ( s / 3600, QUIET_START, QUIET_END )));
+
+		if ( ms == 0 )								/* Start where it should be */
+			blLevel = blTarget;
+
+		else if ( blLevel != blTarget )
+			blLevel += ( blTarget > blLevel ) ? 1 : -1;
+
+		blDutyMs += ( uint64_t ) blLevel * STEP_MS;
+	}
+
+	radioMa = RadioMa ( radioMs[0], radioMs[1] );
+	blMa    = BacklightMa ( blDutyMs, DAY_MS );
+
+	printf ( "%-8s Radio: awake %.1f%%, est. %.0f mA average (%u mA without sleep), %.0f mWh/day (%.0f)\n",
+		BOARD, 100.0 * radioMs[0] / DAY_MS, radioMa, RADIO_MA_AWAKE,
+		radioMa * BOARD_VOLTS * 24, RADIO_MA_AWAKE * BOARD_VOLTS * 24 );
+	printf ( "%-8s Backlight: average %.0f%%, est. %.0f mWh/day (%.0f mWh/day at full)\n",
+		BOARD, blMa * 100 / BL_MA_FULL, blMa * BOARD_VOLTS * 24, BL_MA_FULL * BOARD_VOLTS * 24 );
+	printf ( "%-8s Total: est. %.0f mWh/day (%.0f without sleep or dimming)\n",
+		BOARD, ( radioMa + blMa ) * BOARD_VOLTS * 24, ( RADIO_MA_AWAKE + BL_MA_FULL ) * BOARD_VOLTS * 24 );
+
+	return 0;
+}
+EOF
+
+echo "Radio: ${*:-NTP and solar data only}, ${FETCH_MS} ms fetches"
+echo "Backlight: $BL_DAY% day, $BL_NIGHT% night, quiet $QUIET_START-$QUIET_END, sun $SUNRISE-$SUNSET, room $AMBIENT%"
+
+for BOARD in ESP32 ESP8266
+do
+	g++ -O2 -Wall -D$BOARD -DBOARD="\"$BOARD:\"" $DEFS -o "$BUILD/sim_$BOARD" \
+		-I "$SKETCH" "$BUILD/sim.cpp" || exit 1
+
+	"$BUILD/sim_$BOARD" "$FETCH_MS" "$@" || exit 1
+done
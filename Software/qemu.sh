@@ -0,0 +1,130 @@
+#!/bin/bash
+#
+#	qemu.sh - Builds the clock for the ESP32 and boots it in Espressif's QEMU
+#	('qemu-system-xtensa' from github.com/espressif/qemu); added in Version 3.2.
+#
+#	This catches the things that only go wrong on the real processor, like code
+#	that needs to be in IRAM and isn't, or a crash before the screen comes up,
+#	without needing a board. The serial output goes to the screen and into
+#	'boot.log' in the build folder.
+#
+#	It passes if the "Timing: screen on" line (see 'Mark' in the clock program)
+#	shows up and there's no crash or restart. The emulator has no WiFi (its only
+#	network is an Ethernet chip the Arduino WiFi code doesn't use) and no display,
+#	so the clock gets as far as "Connecting to:" and waits there; the display
+#	writes just go nowhere. The network side is tested with 'chaos.py' on a real
+#	board, and the "Timing:" lines from a board give the real startup times.
+#
+#	With '--bench' it's built with 'BENCHMARK' on and also fails if any of the
+#	drawing took longer than its budget for the size of screen in the 'TFT_eSPI'
+#	setup file used (see 'RENDER_SECOND_US' in the clock program). Give it a setup
+#	file for a different display to check that one's layout and budgets. The
+#	emulated processor's speed isn't the real one's, so a result close to its
+#	budget should be checked on a board.
+#
+#	It needs 'arduino-cli' with the ESP32 board package and the 'TFT_eSPI' and
+#	'ezTime' libraries, 'esptool.py' if the board package doesn't make a merged
+#	flash image and 'qemu-system-xtensa' on the path.
+#
+#	Usage:	./qemu.sh					Boot it for 30 seconds
+#			./qemu.sh 60				or this many
+#			./qemu.sh --bench my_ILI9488_setup.h
+#
+
+cd "$(dirname "$0")" || exit 1
+
+SKETCH=NTP_Dual_Clock_Solar_V3.1
+SETUP="../User_Setup FIles/ESP32_NTP_Clock_Setup.h"
+FQBN=esp32:esp32:esp32
+BUILD=${TMPDIR:-/tmp}/clock_qemu
+SECONDS_TO_RUN=30
+FLAGS=""
+
+for arg in "$@"
+do
+	case "$arg" in
+		--bench)	FLAGS="-DBENCHMARK=true" ;;
+		*.h)		SETUP="$arg" ;;
+		*)			SECONDS_TO_RUN="$arg" ;;
+	esac
+done
+
+mkdir -p "$BUILD"
+cp "$SETUP" "$BUILD/Setup.h"				# No spaces in the path for the compiler
+
+if ! arduino-cli compile --fqbn "$FQBN" --build-path "$BUILD" \
+		--build-property "compiler.cpp.extra_flags=-DUSER_SETUP_LOADED=1 $FLAGS -include $BUILD/Setup.h" \
+		"$SKETCH" > "$BUILD/build.log" 2>&1
+then
+	echo "Build failed, see $BUILD/build.log"
+	exit 1
+fi
+
+
+#	QEMU wants the whole 4MB flash in one file. Newer board packages make one;
+#	otherwise put the pieces together the way the uploader would.
+
+image="$BUILD/$SKETCH.ino.merged.bin"
+
+if [ ! -f "$image" ]
+then
+	boot_app0=$(find ~/.arduino15/packages/esp32/hardware -name boot_app0.bin | head -n 1)
+	image="$BUILD/flash.bin"
+
+	esptool.py --chip esp32 merge_bin --fill-flash-size 4MB -o "$image" \
+		0x1000 "$BUILD/$SKETCH.ino.bootloader.bin" \
+		0x8000 "$BUILD/$SKETCH.ino.partitions.bin" \
+		0xe000 "$boot_app0" \
+		0x10000 "$BUILD/$SKETCH.ino.bin" > /dev/null || exit 1
+fi
+
+
+#	'-icount' runs the processor at a fixed rate, so the times in the "Timing:"
+#	lines come out the same on every run (but aren't the real board's times).
+
+timeout "$SECONDS_TO_RUN" qemu-system-xtensa -nographic -machine esp32 -icount 3 \
+	-drive file="$image",if=mtd,format=raw \
+	-nic user,model=open_eth | tee "$BUILD/boot.log"
+
+echo
+
+if grep -qE "Guru Meditation|abort\(\)|Backtrace:" "$BUILD/boot.log"
+then
+	echo "FAILED: it crashed"
+	exit 1
+fi
+
+if [ "$(grep -c "^rst:" "$BUILD/boot.log")" -gt 1 ]
+then
+	echo "FAILED: it restarted"
+	exit 1
+fi
+
+if ! grep -q "^Timing: screen on" "$BUILD/boot.log"
+then
+	echo "FAILED: it didn't get as far as the screen"
+	exit 1
+fi
+
+grep "^Timing:" "$BUILD/boot.log"
+
+if [ -n "$FLAGS" ]
+then
+	over=$(sed -n 's/.*"over_budget": \([0-9]*\).*/\1/p' "$BUILD/boot.log")
+
+	if [ -z "$over" ]
+	then
+		echo "FAILED: the benchmark didn't finish"
+		exit 1
+	fi
+
+	grep '"budget": [1-9]' "$BUILD/boot.log"
+
+	if [ "$over" -gt 0 ]
+	then
+		echo "FAILED: $over drawing results over budget"
+		exit 1
+	fi
+fi
+
+echo "Passed"
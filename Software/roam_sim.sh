@@ -0,0 +1,268 @@
+#!/bin/bash
+#
+#	roam_sim.sh - Feeds the WiFi roaming decisions ('Roam.h') made up signal
+#	strengths and scan results on this computer and checks what they do with
+#	them; added in Version 3.2.
+#
+#	The simulated radio is connected to one access point whose signal follows a
+#	script, and can see others on various channels with fixed signal strengths.
+#	A scan of a channel takes 'ROAM_DWELL_MS' and returns the access points on it,
+#	including the one we're connected to. The loop drives 'Roam.h' exactly the way
+#	'WiFiRoam' does, with the idle slices of a real second, 10 ms at a step. It
+#	checks that:
+#
+#		No sweep starts while the averaged signal is above 'ROAM_RSSI'
+#		Nothing less than 'ROAM_MARGIN' dB stronger is moved to
+#		The move goes to the strongest other access point, not our own
+#		Sweeps are at least 'ROAM_SWEEP_MS' apart
+#		A move that doesn't connect is retried without a BSSID after
+#		'ROAM_GRACE_MS', and if that fails too we give up
+#
+#	'ROAM_RSSI' and 'ROAM_MARGIN' are taken from 'UserSettings.h'.
+#
+#	It needs a C++ compiler.
+#
+#	Usage:	./roam_sim.sh
+#
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+SKETCH=$HERE/NTP_Dual_Clock_Solar_V3.1
+BUILD=${TMPDIR:-/tmp}/roam_sim
+
+Define ()										# A '#define' from the user settings
+{
+	sed -n "s/^#define[ \t]*$1[ \t]*\(-*[0-9]*\).*/\1/p" "$SKETCH/UserSettings.h" | head -1
+}
+
+mkdir -p "$BUILD"
+
+cat > "$BUILD/sim.cpp" <<'EOF'
+#include <stdio.h>
+#include <vector>
+#include "Roam.h"
+
+#define STEP_MS		10								/* Simulated time step */
+#define RUN_MS		400000							/* and how long each case runs */
+#define NEVER		-1								/* Doesn't connect */
+
+struct simAp
+{
+	uint8_t		bssid[6];
+	int32_t		channel;
+	int16_t		rssi;								/* 0 = follows the script */
+};
+
+struct simCase
+{
+	const char*	name;
+	int16_t		( *trace ) ( uint32_t ms );			/* Our access point's signal */
+	std::vector <simAp>	aps;						/* What the scans see ([0] is ours) */
+	int32_t		connectMs;							/* How long a move takes */
+	int32_t		fallbackMs;							/* and a move without a BSSID */
+};
+
+struct simResult
+{
+	std::vector <uint32_t>	sweepStart, sweepEnd;
+	int16_t		worstStartRssi = -127;				/* Highest average a sweep started at */
+	int			moves = 0, fallbacks = 0, done = 0, gaveUp = 0;
+	uint8_t		movedTo[6];
+	uint32_t	moveTime = 0, fallbackTime = 0;
+};
+
+int16_t Strong ( uint32_t )		{ return -55; }
+int16_t Weak ( uint32_t )		{ return -76; }
+int16_t Fading ( uint32_t ms )	{ return ms < 30000 ? -60 : ( ms < 60000 ? -60 - ( ms - 30000 ) / 1500 : -80 ); }
+
+bool Idle ( uint32_t ms )
+{
+	return (( ms % 1000 ) > 50 ) && (( ms % 1000 ) < 600 );
+}
+
+simResult Run ( const simCase& c )
+{
+	wifiRoam	roam = {};
+	simResult	res;
+	const simAp* on = &c.aps[0];					/* Connected to (null = not) */
+	const simAp* best = nullptr;					/* What 'ROAM_MOVE' asked for */
+	uint32_t	scanEnd = 0, joinTime = 0;
+	int32_t		joinMs = 0;
+	uint32_t	lastSweep = 0;
+
+	for ( uint32_t ms = 1000; ms < RUN_MS; ms += STEP_MS )
+	{
+		if ( roam.start )							/* Roam in progress? */
+		{
+			if (( joinMs != NEVER ) && (( ms - joinTime ) >= ( uint32_t ) joinMs ))
+			{
+				on = best ? best : &c.aps[0];		/* Without a BSSID, ours */
+				RoamDone ( roam, on->rssi ? on->rssi : c.trace ( ms ), ms );
+				res.done++;
+			}
+
+			else if ( RoamFailed ( roam, ms ))
+			{
+				res.fallbacks++;
+				res.fallbackTime = ms;
+				best    = nullptr;
+				joinTime = ms;
+				joinMs  = c.fallbackMs;
+			}
+
+			else if ( !roam.start )					/* Gave up */
+				res.gaveUp++;
+
+			continue;
+		}
+
+		if ( !on )
+			continue;
+
+		if (( ms - roam.sampleTime ) >= ROAM_SAMPLE_MS )
+			RoamSample ( roam, on->rssi ? on->rssi : c.trace ( ms ), ms );
+
+		if ( roam.scanning )
+		{
+			if ( ms < scanEnd )						/* Not yet */
+				continue;
+
+			for ( const simAp& ap : c.aps )
+				if ( ap.channel == roam.channel )
+					RoamFound ( roam, ap.bssid, ap.channel, ap.rssi ? ap.rssi : c.trace ( ms ),
+								on->bssid );
+
+			RoamScanned ( roam );
+			continue;
+		}
+
+		switch ( RoamNext ( roam, ROAM_RSSI, ROAM_MARGIN, Idle ( ms ), ms ))
+		{
+			case ROAM_SCAN:
+				if ( roam.channel == 1 )			/* New sweep */
+				{
+					res.sweepStart.push_back ( ms );
+					if ( roam.smoothRssi / 16 > res.worstStartRssi )
+						res.worstStartRssi = roam.smoothRssi / 16;
+				}
+				scanEnd = ms + ROAM_DWELL_MS;
+				break;
+
+			case ROAM_MOVE:
+				res.moves++;
+				res.moveTime = ms;
+				memcpy ( res.movedTo, roam.bestBssid, 6 );
+				best = nullptr;
+
+				for ( const simAp& ap : c.aps )
+					if ( !memcmp ( ap.bssid, roam.bestBssid, 6 ))
+						best = &ap;
+
+				on       = nullptr;
+				joinTime = ms;
+				joinMs   = c.connectMs;
+				break;
+		}
+
+		if ( roam.sweepTime != lastSweep )			/* Sweep ended */
+		{
+			lastSweep = roam.sweepTime;
+			res.sweepEnd.push_back ( lastSweep );
+		}
+	}
+
+	return res;
+}
+
+int failed = 0;
+
+void Check ( const char* name, bool ok, const char* what )
+{
+	if ( !ok )
+	{
+		printf ( "FAILED: %s: %s\n", name, what );
+		failed++;
+	}
+}
+
+void CheckBackoff ( const char* name, const simResult& r )
+{
+	for ( size_t i = 1; i < r.sweepStart.size (); i++ )
+		Check ( name, ( r.sweepStart[i] - r.sweepEnd[i - 1] ) >= ROAM_SWEEP_MS,
+				"sweep started inside ROAM_SWEEP_MS" );
+}
+
+void Report ( const char* name, const simResult& r )
+{
+	printf ( "%-10s %2zu sweeps, %d moves, %d fallbacks, %d connected, %d gave up",
+			 name, r.sweepStart.size (), r.moves, r.fallbacks, r.done, r.gaveUp );
+
+	if ( r.sweepStart.size () > 1 )
+		printf ( ", sweeps %u s apart", ( r.sweepStart[1] - r.sweepEnd[0] ) / 1000 );
+
+	printf ( "\n" );
+}
+
+int main ()
+{
+	simAp		ours  = {{ 0x02, 0, 0, 0, 0, 1 },  1,   0 };
+	simAp		ourCh = {{ 0x02, 0, 0, 0, 0, 1 },  1, -40 };		/* Ours, seen strong in a scan */
+	simAp		apA   = {{ 0x02, 0, 0, 0, 0, 2 },  3, -72 };
+	simAp		apB   = {{ 0x02, 0, 0, 0, 0, 3 },  6, -65 };
+	simAp		apC   = {{ 0x02, 0, 0, 0, 0, 4 }, 11, -58 };
+	simAp		close = {{ 0x02, 0, 0, 0, 0, 5 },  6, ( int16_t ) ( -76 + ROAM_MARGIN - 1 ) };
+	simResult	r;
+
+	simCase		strong    = { "strong",    Strong, { ours, apC },				3000, 3000 };
+	simCase		margin    = { "margin",    Weak,   { ours, close },				3000, 3000 };
+	simCase		strongest = { "strongest", Fading, { ours, apA, apB, apC },		3000, 3000 };
+	simCase		own       = { "own",       Weak,   { ours, ourCh, apA, apB },	3000, 3000 };
+	simCase		fallback  = { "fallback",  Fading, { ours, apB },				NEVER, 4000 };
+	simCase		giveUp    = { "give up",   Fading, { ours, apB },				NEVER, NEVER };
+
+	printf ( "ROAM_RSSI %d dBm, ROAM_MARGIN %d dB\n", ROAM_RSSI, ROAM_MARGIN );
+
+	r = Run ( strong );								/* Never below the threshold */
+	Report ( strong.name, r );
+	Check ( strong.name, r.sweepStart.empty () && ( r.moves == 0 ), "swept above ROAM_RSSI" );
+
+	r = Run ( margin );								/* Better, but not by enough */
+	Report ( margin.name, r );
+	Check ( margin.name, r.sweepStart.size () >= 3, "didn't keep sweeping" );
+	Check ( margin.name, r.moves == 0, "moved to an AP inside ROAM_MARGIN" );
+	Check ( margin.name, r.worstStartRssi < ROAM_RSSI, "swept above ROAM_RSSI" );
+	CheckBackoff ( margin.name, r );
+
+	r = Run ( strongest );							/* Fades; C is the best */
+	Report ( strongest.name, r );
+	Check ( strongest.name, r.worstStartRssi < ROAM_RSSI, "swept above ROAM_RSSI" );
+	Check ( strongest.name, ( r.moves == 1 ) && ( r.done == 1 ), "didn't move once" );
+	Check ( strongest.name, !memcmp ( r.movedTo, apC.bssid, 6 ), "didn't move to the strongest AP" );
+	Check ( strongest.name, r.moveTime > 30000 + ROAM_SAMPLE_MS, "moved before the signal faded" );
+	CheckBackoff ( strongest.name, r );
+
+	r = Run ( own );								/* Our own AP in a scan doesn't count */
+	Report ( own.name, r );
+	Check ( own.name, ( r.moves == 1 ) && !memcmp ( r.movedTo, apB.bssid, 6 ), "didn't skip our own AP" );
+
+	r = Run ( fallback );							/* Moves fail, any AP (ours) works */
+	Report ( fallback.name, r );
+	Check ( fallback.name, ( r.moves >= 1 ) && ( r.fallbacks == r.moves ) && ( r.done == r.moves )
+			&& ( r.gaveUp == 0 ), "didn't fall back" );
+	Check ( fallback.name, ( r.fallbackTime - r.moveTime ) > ROAM_GRACE_MS, "fell back inside ROAM_GRACE_MS" );
+	Check ( fallback.name, ( r.fallbackTime - r.moveTime ) <= ROAM_GRACE_MS + 2 * STEP_MS, "fell back late" );
+	CheckBackoff ( fallback.name, r );
+
+	r = Run ( giveUp );								/* Nothing works */
+	Report ( giveUp.name, r );
+	Check ( giveUp.name, ( r.moves == 1 ) && ( r.fallbacks == 1 ) && ( r.gaveUp == 1 ) && ( r.done == 0 ),
+			"didn't give up after one fallback" );
+
+	printf ( failed ? "FAILED\n" : "Passed\n" );
+	return failed ? 1 : 0;
+}
+EOF
+
+g++ -O2 -Wall -DROAM_RSSI="$(Define ROAM_RSSI)" -DROAM_MARGIN="$(Define ROAM_MARGIN)" \
+	-o "$BUILD/sim" -I "$SKETCH" "$BUILD/sim.cpp" || exit 1
+
+"$BUILD/sim"
@@ -0,0 +1,210 @@
+#!/bin/bash
+#
+#	sun_bench.sh - Times the decoding of the picture of the sun on this computer
+#	and measures the memory it takes; added in Version 3.2.
+#
+#	It builds ChaN's 'tjpgd' from the 'TJpg_Decoder' library the clock uses (with
+#	the same 'tjpgdcnf.h' settings) into a small program that does what 'SunFetch'
+#	in the clock program does: gives the decoder the JPEG in the pieces it asks
+#	for, scales it down to fit 'SUN_SIZE' pixels and packs the rows with the
+#	clock's own 'SunPackRow' ('SunPack.h'). It prints the decode time, how much of
+#	its work area the decoder used, the buffer for one row of blocks and the packed
+#	size.
+#
+#	The picture can be a file or a URL. Without one it uses 'sun_256.jpg' (in the
+#	'Software' folder), a made up 256 pixel picture of the sun the size and shape
+#	of the real ones: 4:2:0 colour, a limb darkened disk with a few spots on black.
+#	'chaos.py --sun' serves a file on the local network, so the clock on the bench
+#	and this can be given the same one.
+#	The times here are a lot shorter than an ESP's; the clock prints its own time
+#	and memory use in its "Sun:" line after each fetch. The memory use is the same.
+#
+#	It needs a C compiler, 'curl' for a URL and the 'TJpg_Decoder' library in the
+#	Arduino libraries folder (or set 'ARDUINO_LIBRARIES').
+#
+#	Usage:	./sun_bench.sh								'sun_256.jpg' scaled to 32 pixels
+#			./sun_bench.sh latest_256_0193.jpg
+#			./sun_bench.sh https://localhost:8443/sun.jpg 43 500
+#
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+PICTURE=${1:-$HERE/sun_256.jpg}
+SIZE=${2:-32}									# 'SUN_SIZE'
+RUNS=${3:-100}									# Decodes to average
+LIBRARY=${ARDUINO_LIBRARIES:-$HOME/Arduino/libraries}/TJpg_Decoder/src
+BUILD=${TMPDIR:-/tmp}/sun_bench
+
+if [ "$SIZE" -gt 256 ]
+then
+	echo "Usage: $0 [picture.jpg|URL [size (up to 256) [runs]]]"
+	exit 1
+fi
+
+if [ ! -f "$LIBRARY/tjpgd.c" ]
+then
+	echo "Can't find 'tjpgd.c' in $LIBRARY"
+	echo "Install 'TJpg_Decoder' (https://github.com/Bodmer/TJpg_Decoder) with the"
+	echo "Arduino library manager, or set 'ARDUINO_LIBRARIES' to where it is"
+	exit 1
+fi
+
+mkdir -p "$BUILD"
+
+case "$PICTURE" in
+	http*)	curl -skf -o "$BUILD/sun.jpg" "$PICTURE" || { echo "Can't get $PICTURE"; exit 1; }
+			PICTURE="$BUILD/sun.jpg" ;;
+esac
+
+
+#	'tjpgd.c' may reach for the Arduino flash memory macros; on this computer
+#	they're just ordinary memory.
+
+cat > "$BUILD/Arduino.h" <<'EOF'
+#define PROGMEM
+#define pgm_read_byte(p)	(*(const unsigned char*)(p))
+#define pgm_read_word(p)	(*(const unsigned short*)(p))
+#define pgm_read_dword(p)	(*(const unsigned int*)(p))
+EOF
+cp "$BUILD/Arduino.h" "$BUILD/pgmspace.h"
+
+cat > "$BUILD/bench.c" <<'EOF'
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tjpgd.h"
+#include "SunPack.h"
+
+#define POOL	16384							/* More than it could want */
+
+typedef struct
+{
+	FILE*		f;								/* The JPEG */
+	uint16_t*	rows;							/* One row of blocks */
+	uint16_t	w, h;							/* Size after scaling */
+	uint16_t	rowTop, rowsH;
+	uint32_t	bytes;							/* Read */
+	uint32_t	packed;							/* and packed */
+} job_t;
+
+static size_t input ( JDEC* jd, uint8_t* buf, size_t len )
+{
+	job_t*	job = ( job_t* ) jd->device;
+	size_t	n;
+
+	if ( buf )
+		n = fread ( buf, 1, len, job->f );
+	else
+		n = fseek ( job->f, len, SEEK_CUR ) ? 0 : len;
+
+	job->bytes += n;
+	return n;
+}
+
+static void pack ( job_t* job, const uint16_t* px )		/* As 'SunPack' */
+{
+	uint8_t		packed[SUN_PACKED ( 256 )];
+
+	job->packed += SunPackRow ( px, job->w, packed );
+}
+
+static int output ( JDEC* jd, void* bitmap, JRECT* rect )	/* As 'SunOutput' */
+{
+	job_t*		job = ( job_t* ) jd->device;
+	uint16_t*	px = ( uint16_t* ) bitmap;
+	uint16_t	w = rect->right - rect->left + 1;
+	uint16_t	h = rect->bottom - rect->top + 1;
+
+	if (( rect->right >= job->w ) || ( rect->top < job->rowTop )
+			|| ( rect->bottom >= job->rowTop + job->rowsH ))
+		return 0;
+
+	for ( uint16_t r = 0; r < h; r++ )
+		memcpy ( job->rows + ( rect->top - job->rowTop + r ) * job->w + rect->left,
+				 px + r * w, w * 2 );
+
+	if ( rect->right == job->w - 1 )
+	{
+		for ( uint16_t r = job->rowTop; r <= rect->bottom; r++ )
+			pack ( job, job->rows + ( r - job->rowTop ) * job->w );
+
+		job->rowTop = rect->bottom + 1;
+	}
+
+	return 1;
+}
+
+int main ( int argc, char** argv )
+{
+	static uint8_t	pool[POOL];
+	JDEC			jd;
+	job_t			job;
+	JRESULT			result;
+	struct timespec	start, end;
+	double			us = 0;
+	int				size = atoi ( argv[2] ), runs = atoi ( argv[3] );
+	uint8_t			scale = 0;
+	size_t			used = 0;
+
+	for ( int run = 0; run < runs; run++ )
+	{
+		memset ( &job, 0, sizeof ( job ));
+
+		if ( !( job.f = fopen ( argv[1], "rb" )))
+		{
+			perror ( argv[1] );
+			return 1;
+		}
+
+		clock_gettime ( CLOCK_MONOTONIC, &start );
+
+		if (( result = jd_prepare ( &jd, input, pool, POOL, &job )) != JDR_OK )
+		{
+			printf ( "FAILED: jd_prepare gave %d\n", result );
+			return 1;
+		}
+
+		for ( scale = 0; ( scale < 3 ) && ((( jd.width >> scale ) > size ) || (( jd.height >> scale ) > size )); )
+			scale++;
+
+		job.w = jd.width >> scale;
+		job.h = jd.height >> scale;
+		job.rowsH = ( jd.msy * 8 ) >> scale ? ( jd.msy * 8 ) >> scale : 1;
+		job.rows = malloc ( job.w * job.rowsH * 2 );
+		used = POOL - jd.sz_pool;
+
+		if ( job.w > size || job.h > size )
+		{
+			printf ( "FAILED: %u x %u doesn't fit in %d pixels\n", jd.width, jd.height, size );
+			return 1;
+		}
+
+		if (( result = jd_decomp ( &jd, output, scale )) != JDR_OK || job.rowTop != job.h )
+		{
+			printf ( "FAILED: jd_decomp gave %d after %u bytes\n", result, job.bytes );
+			return 1;
+		}
+
+		clock_gettime ( CLOCK_MONOTONIC, &end );
+		us += ( end.tv_sec - start.tv_sec ) * 1e6 + ( end.tv_nsec - start.tv_nsec ) / 1e3;
+
+		free ( job.rows );
+		fclose ( job.f );
+	}
+
+	printf ( "Picture:      %u x %u, %u bytes\n", jd.width, jd.height, job.bytes );
+	printf ( "Scaled:       1/%u to %u x %u\n", 1 << scale, job.w, job.h );
+	printf ( "Decode:       %.0f us (average of %d)\n", us / runs, runs );
+	printf ( "Work area:    %zu bytes\n", used );
+	printf ( "Row buffer:   %u bytes\n", job.w * job.rowsH * 2 );
+	printf ( "Peak memory:  %zu bytes\n", used + job.w * job.rowsH * 2 + sizeof ( jd ) + sizeof ( job ));
+	printf ( "Packed:       %u bytes (%u%% of unpacked)\n", job.packed + 12,
+			 ( job.packed + 12 ) * 100 / ( job.w * job.h * 2 ));
+
+	return 0;
+}
+EOF
+
+cc -O2 -o "$BUILD/bench" -I "$BUILD" -I "$LIBRARY" -I "$HERE/NTP_Dual_Clock_Solar_V3.1" "$BUILD/bench.c" "$LIBRARY/tjpgd.c" || exit 1
+
+"$BUILD/bench" "$PICTURE" "$SIZE" "$RUNS"
@@ -0,0 +1,302 @@
+#!/bin/bash
+#
+#	sync_sim.sh - Runs several clocks' LAN synchronization ('LanSync.h') against
+#	each other on this computer, over the loopback network with jitter added, and
+#	checks how closely their seconds flip together; added in Version 3.2.
+#
+#	Each simulated clock has its own UDP socket on 127.0.0.1, its own time (up to
+#	two seconds out) and its own drift (up to 100 ppm either way). A "broadcast"
+#	goes to every clock's socket. Every packet is held back by a random delay of
+#	up to the jitter given, and one in twenty by up to five times that, before it's
+#	sent. Time is simulated a millisecond at a step so a few minutes of it take a
+#	few seconds.
+#
+#	Half way through, the leader is switched off; the clock with the next lowest
+#	ID must take over and the others follow it.
+#
+#	The skew is the spread of the clocks' corrected times (what 'SyncedNow' shows)
+#	measured every millisecond, ignoring the first 'SETTLE' seconds after the start
+#	and after the leader goes. It prints the worst and average true skew along with
+#	the skew the clocks measured themselves (what "Clock sync:" shows on the serial
+#	monitor) and fails if the worst is over the limit.
+#
+#	It needs a C++ compiler.
+#
+#	Usage:	./sync_sim.sh								4 clocks, 20 ms jitter
+#			./sync_sim.sh 8 50 40						8 clocks, 50 ms jitter, 40 ms limit
+#
+
+HERE=$(dirname "$0")
+CLOCKS=${1:-4}
+JITTER=${2:-20}									# Most a packet is held up (ms)
+LIMIT=${3:-25}									# Worst skew allowed (ms)
+BUILD=${TMPDIR:-/tmp}/sync_sim
+
+mkdir -p "$BUILD"
+
+cat > "$BUILD/sim.cpp" <<'EOF'
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <vector>
+#include "LanSync.h"
+
+#define PORT		41230							/* First clock's port */
+#define RUN_MS		360000							/* Simulated time */
+#define SETTLE		60000							/* Not counted after a change */
+
+struct simClock
+{
+	lanSync		lan;
+	int			sock;
+	bool		on;
+	double		start;								/* Its time at 0 (ms since 1970) */
+	double		drift;								/* and how fast it goes */
+	uint32_t	helloTime, pollTime;
+};
+
+struct inFlight
+{
+	uint32_t	due;								/* When it gets sent */
+	int			from, to;
+	lanPacket	pkt;
+};
+
+static std::vector<simClock>	clocks;
+static std::vector<inFlight>	flying;
+static uint32_t					jitter;
+
+static int64_t EpochMs ( const simClock& c, uint32_t ms )
+{
+	return ( int64_t ) ( c.start + ms * c.drift );
+}
+
+static void Send ( int from, int to, const lanPacket& pkt, uint32_t ms )
+{
+	uint32_t	delay = 1 + rand () % ( jitter + 1 );
+
+	if ( rand () % 20 == 0 )						/* A bad one */
+		delay += rand () % ( 5 * jitter + 1 );
+
+	if ( to < 0 )									/* Broadcast */
+	{
+		for ( int i = 0; i < ( int ) clocks.size (); i++ )
+			if ( i != from )
+				Send ( from, i, pkt, ms );
+
+		return;
+	}
+
+	flying.push_back ({ ms + delay, from, to, pkt });
+}
+
+int main ( int argc, char** argv )
+{
+	int			n = atoi ( argv[1] );
+	uint32_t	limit = atoi ( argv[3] ), worst = 0, measured = 0, counted = 0;
+	uint32_t	off = RUN_MS / 2;
+	double		total = 0;
+	int			failed = 0;
+
+	jitter = atoi ( argv[2] );
+	srand ( 1 );
+
+	for ( int i = 0; i < n; i++ )
+	{
+		simClock	c = {};
+		sockaddr_in	a = {};
+
+		LanBegin ( c.lan, 0x1000 + i * 7 );			/* Clock 0 has the lowest ID */
+		c.on    = true;
+		c.start = 1.8e12 + ( rand () % 4001 ) - 2000;
+		c.drift = 1 + (( rand () % 201 ) - 100 ) * 1e-6;
+		c.helloTime = rand () % LAN_HELLO_MS;
+		c.pollTime  = rand () % LAN_POLL_MS;
+
+		a.sin_family = AF_INET;
+		a.sin_port = htons ( PORT + i );
+		a.sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+		c.sock = socket ( AF_INET, SOCK_DGRAM, 0 );
+
+		if ( bind ( c.sock, ( sockaddr* ) &a, sizeof ( a )))
+		{
+			perror ( "bind" );
+			return 1;
+		}
+
+		clocks.push_back ( c );
+	}
+
+	for ( uint32_t ms = 1; ms <= RUN_MS; ms++ )
+	{
+		if ( ms == off )							/* Switch the leader off */
+			clocks[0].on = false;
+
+
+/*
+ *	Send what's due over the loopback network and wait for it to come in.
+ */
+
+		int		sent = 0;
+
+		for ( size_t i = 0; i < flying.size (); )
+		{
+			inFlight&	f = flying[i];
+
+			if ( f.due > ms )
+			{
+				i++;
+				continue;
+			}
+
+			if ( clocks[f.to].on && clocks[f.from].on )
+			{
+				sockaddr_in	a = {};
+
+				a.sin_family = AF_INET;
+				a.sin_port = htons ( PORT + f.to );
+				a.sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+				sendto ( clocks[f.from].sock, &f.pkt, sizeof ( f.pkt ), 0, ( sockaddr* ) &a, sizeof ( a ));
+				sent++;
+			}
+
+			flying[i] = flying.back ();
+			flying.pop_back ();
+		}
+
+		while ( sent > 0 )
+		{
+			std::vector<pollfd>	fds;
+
+			for ( simClock& c : clocks )
+				fds.push_back ({ c.sock, POLLIN, 0 });
+
+			if ( poll ( fds.data (), fds.size (), 1000 ) <= 0 )
+			{
+				printf ( "FAILED: packets lost on the loopback network\n" );
+				return 1;
+			}
+
+			for ( int i = 0; i < n; i++ )
+			{
+				lanPacket	pkt;
+				sockaddr_in	a;
+				socklen_t	len = sizeof ( a );
+
+				if ( !( fds[i].revents & POLLIN ))
+					continue;
+
+				if ( recvfrom ( clocks[i].sock, &pkt, sizeof ( pkt ), 0, ( sockaddr* ) &a, &len ) != sizeof ( pkt ))
+					continue;
+
+				sent--;
+
+				int		from = ntohs ( a.sin_port ) - PORT;
+				int64_t	arrival = EpochMs ( clocks[i], ms );
+
+				if ( LanReceive ( clocks[i].lan, pkt, arrival, from, ms ))
+				{
+					pkt.t3 = arrival;
+					Send ( i, from, pkt, ms );
+				}
+			}
+		}
+
+
+/*
+ *	What each clock does every time around its loop.
+ */
+
+		for ( int i = 0; i < n; i++ )
+		{
+			simClock&	c = clocks[i];
+			lanPacket	pkt;
+
+			if ( !c.on )
+				continue;
+
+			LanLeaderLost ( c.lan, ms );
+
+			if (( ms - c.helloTime ) >= LAN_HELLO_MS )
+			{
+				c.helloTime = ms;
+				memset ( &pkt, 0, sizeof ( pkt ));
+				LanStamp ( c.lan, pkt, LAN_HELLO );
+				Send ( i, -1, pkt, ms );
+			}
+
+			if (( c.lan.leaderId != c.lan.myId ) && (( ms - c.pollTime ) >= LAN_POLL_MS ))
+			{
+				c.pollTime = ms;
+				LanRequest ( c.lan, pkt, EpochMs ( c, ms ));
+				Send ( i, c.lan.leaderAddr, pkt, ms );
+			}
+		}
+
+
+/*
+ *	How far apart are they?
+ */
+
+		lanSync&	leader = clocks[ms < off ? 0 : 1].lan;
+		bool		settling = ( ms <= SETTLE ) || (( ms >= off ) && ( ms <= off + SETTLE ));
+
+		if ( settling )
+		{
+			if ( ms % 60000 == 0 )					/* Starts over, as 'ClockSync' does */
+				leader.skew = 0;
+
+			continue;
+		}
+
+		int64_t	lo = INT64_MAX, hi = INT64_MIN;
+
+		for ( simClock& c : clocks )
+			if ( c.on )
+			{
+				int64_t	shown = EpochMs ( c, ms ) + c.lan.offset;
+
+				lo = shown < lo ? shown : lo;
+				hi = shown > hi ? shown : hi;
+
+				if ( c.lan.leaderId != leader.myId )
+				{
+					printf ( "FAILED: clock %04X follows %04X at %u ms\n", c.lan.myId, c.lan.leaderId, ms );
+					return 1;
+				}
+			}
+
+		worst = ( hi - lo > worst ) ? hi - lo : worst;
+		total += hi - lo;
+		counted++;
+
+		if ( ms % 60000 == 0 )						/* What the leader says */
+		{
+			measured = leader.skew > ( int32_t ) measured ? leader.skew : measured;
+			printf ( "%3u s: skew %lld ms, leader measures %d ms\n", ms / 1000, ( long long ) ( hi - lo ), leader.skew );
+			leader.skew = 0;
+		}
+	}
+
+	printf ( "Clocks:     %d, jitter up to %u ms (one in twenty up to %u ms)\n", n, jitter, 6 * jitter );
+	printf ( "Skew:       %u ms worst, %.1f ms average\n", worst, total / counted );
+	printf ( "Measured:   %u ms worst (by the leaders)\n", measured );
+
+	if ( worst > limit )
+	{
+		printf ( "FAILED: over %u ms\n", limit );
+		failed++;
+	}
+
+	printf ( failed ? "FAILED\n" : "Passed\n" );
+	return failed ? 1 : 0;
+}
+EOF
+
+g++ -O2 -Wall -o "$BUILD/sim" -I "$HERE/NTP_Dual_Clock_Solar_V3.1" "$BUILD/sim.cpp" || exit 1
+
+"$BUILD/sim" "$CLOCKS" "$JITTER" "$LIMIT"
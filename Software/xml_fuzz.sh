@@ -0,0 +1,221 @@
+#!/bin/bash
+#
+#	xml_fuzz.sh - Throws damaged and random solar data at the clock's XML parser
+#	('SolarXml.h') on this computer with the address and undefined behaviour
+#	checkers turned on; added in Version 3.2.
+#
+#	Every input is copied into a buffer of exactly its size with nothing after it,
+#	so reading one byte past the end is caught. For each one it checks:
+#
+#		The work 'ParseSolarData' did (words and tags looked at) is no more than
+#		'LINEAR' (9) times the size plus a little, whatever the input looks like.
+#
+#		If it was accepted (and has no zero bytes in it), the values are exactly
+#		what 'ParseSolarDataRef' gets.
+#
+#	With 'clang' it builds a libFuzzer target and runs it for the given number of
+#	inputs, starting from the sample reply ('SolarSample.h'). Without it, 'g++'
+#	builds the same target with a driver that makes 200,000 damaged copies of the
+#	sample (characters changed to ones that matter in XML, bits cut out, copies cut
+#	short, tags repeated) and 100,000 random buffers up to a bit over 'XML_MAX'.
+#
+#	It needs a C++ compiler.
+#
+#	Usage:	./xml_fuzz.sh									Default number of inputs
+#			./xml_fuzz.sh 1000000							libFuzzer runs (with clang)
+#
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+RUNS=${1:-300000}
+BUILD=${TMPDIR:-/tmp}/xml_fuzz
+
+mkdir -p "$BUILD/corpus"
+
+cat > "$BUILD/target.cpp" <<'EOF'
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint64_t		work;								/* Counted by 'ParseSolarData' */
+#define XML_COUNT(n)	( work += ( n ))
+#define PROGMEM
+
+#include "SolarXml.h"
+#include "SolarSample.h"
+
+#define LINEAR		( XML_FIELDS + 1 )					/* Most work per byte */
+
+static uint64_t		worstWork;
+static uint32_t		inputs, accepted;
+static size_t		worstSize;
+
+static void Fail ( const char* why, const uint8_t* data, size_t size )
+{
+	FILE*	f = fopen ( "crash.xml", "wb" );
+
+	fwrite ( data, 1, size, f );
+	fclose ( f );
+	printf ( "FAILED: %s (%zu bytes, saved in crash.xml)\n", why, size );
+	fflush ( stdout );
+	abort ();
+}
+
+extern "C" int LLVMFuzzerTestOneInput ( const uint8_t* data, size_t size )
+{
+	char*			xml = ( char* ) malloc ( size ? size : 1 );	/* Nothing after it */
+	char*			text = ( char* ) malloc ( size + 1 );		/* With a zero after it */
+	solarSnapshot	a, b;
+	bool			ok;
+
+	memcpy ( xml, data, size );
+	memcpy ( text, data, size );
+	text[size] = 0;
+	memset ( &a, 'x', sizeof ( a ));					/* So we can tell if it's touched */
+	memset ( &b, 'x', sizeof ( b ));
+
+	work = 0;
+	ok = ParseSolarData ( xml, size, a );
+	inputs++;
+
+	if ( work > LINEAR * size + 16 )
+		Fail ( "too much work", data, size );
+
+	if ( work > worstWork )
+	{
+		worstWork = work;
+		worstSize = size;
+	}
+
+	if ( ok )
+	{
+		accepted++;
+
+		if ( strlen ( text ) == size )					/* 'strstr' stops at a zero */
+		{
+			ParseSolarDataRef ( text, b );
+
+			if ( memcmp ( &a, &b, sizeof ( a )))
+				Fail ( "accepted but different from 'ParseSolarDataRef'", data, size );
+		}
+	}
+
+	else
+	{
+		for ( size_t i = 0; i < sizeof ( a ); i++ )		/* Must be left alone */
+			if ((( char* ) &a )[i] != 'x' )
+				Fail ( "rejected but changed the values", data, size );
+	}
+
+	free ( xml );
+	free ( text );
+	return 0;
+}
+
+#ifndef LIBFUZZER
+
+static uint32_t		seed = 12345;						/* Always the same tests */
+
+static uint32_t Random ()
+{
+	seed ^= seed << 13;									/* Xorshift random numbers */
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+int main ( int argc, char** argv )
+{
+	const char*		chars = "<>/ \tsunpotlar1";			/* What we change things to */
+	const size_t	sampleLen = sizeof ( solarSample ) - 1;
+	static uint8_t	buf[XML_MAX * 2];
+	uint32_t		mutations = atoi ( argv[1] ), randoms = atoi ( argv[2] );
+	uint32_t		mutated, sampleAccepted;
+	size_t			len, at, cut;
+
+	for ( uint32_t run = 0; run < mutations; run++ )
+	{
+		memcpy ( buf, solarSample, sampleLen );
+		len = sampleLen;
+
+		for ( uint32_t k = 0; k < 1 + run % 8; k++ )
+		{
+			at = Random () % len;
+
+			switch ( Random () % 4 )
+			{
+				case 0:									/* Change a character */
+					buf[at] = chars[Random () % strlen ( chars )];
+					break;
+
+				case 1:									/* Cut out up to 16 */
+					cut = Random () % 16 + 1;
+					cut = cut < len - at ? cut : len - at;
+					memmove ( buf + at, buf + at + cut, len - at - cut );
+					len -= cut;
+					break;
+
+				case 2:									/* Cut it short */
+					len = at;
+					break;
+
+				case 3:									/* Repeat up to 64 */
+					cut = Random () % 64 + 1;
+					cut = cut < len - at ? cut : len - at;
+
+					if ( len + cut <= sizeof ( buf ))
+					{
+						memmove ( buf + at + cut, buf + at, len - at );
+						len += cut;
+					}
+					break;
+			}
+
+			if ( len == 0 )
+				break;
+		}
+
+		LLVMFuzzerTestOneInput ( buf, len );
+	}
+
+	mutated = inputs;
+	sampleAccepted = accepted;
+
+	for ( uint32_t run = 0; run < randoms; run++ )
+	{
+		len = Random () % ( XML_MAX + 256 );
+
+		for ( size_t i = 0; i < len; i++ )				/* Mostly tag characters */
+			buf[i] = ( Random () % 4 ) ? chars[Random () % strlen ( chars )] : Random ();
+
+		LLVMFuzzerTestOneInput ( buf, len );
+	}
+
+	printf ( "Mutations:  %u, %u accepted, all the same as 'ParseSolarDataRef'\n", mutated, sampleAccepted );
+	printf ( "Random:     %u, %u accepted\n", inputs - mutated, accepted - sampleAccepted );
+	printf ( "Work:       %llu at most (%zu bytes), limit %zu a byte\n", ( unsigned long long ) worstWork, worstSize, LINEAR );
+	printf ( "Passed\n" );
+	return 0;
+}
+
+#endif
+EOF
+
+sed -n '/R"XML(/,/^)XML";/p' "$HERE/NTP_Dual_Clock_Solar_V3.1/SolarSample.h" \
+	| sed -e '1s/.*R"XML(//' -e '$d' | tr -d '\r' > "$BUILD/corpus/sample.xml"
+
+cd "$BUILD"
+
+if command -v clang++ > /dev/null && clang++ -fsanitize=fuzzer -x c++ /dev/null -o /dev/null 2> /dev/null
+then
+	clang++ -O1 -g -DLIBFUZZER -fsanitize=fuzzer,address,undefined -fno-sanitize-recover=all \
+		-I "$HERE/NTP_Dual_Clock_Solar_V3.1" -o fuzz target.cpp || exit 1
+
+	./fuzz -runs="$RUNS" -max_len=$(( 8192 + 256 )) corpus && echo "Passed"
+else
+	echo "No libFuzzer (clang) here; using the built in inputs"
+
+	g++ -O1 -g -Wall -fsanitize=address,undefined -fno-sanitize-recover=all \
+		-I "$HERE/NTP_Dual_Clock_Solar_V3.1" -o fuzz target.cpp || exit 1
+
+	./fuzz $(( RUNS * 2 / 3 )) $(( RUNS / 3 ))
+fi